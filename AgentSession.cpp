@@ -0,0 +1,312 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "AgentSession.h"
+
+AgentSession::AgentSession(int sessionId, DBConnector& dbConnector, int numThreads)
+    : sessionId(sessionId) {
+    // All components are created once up front, before any handler or the audio thread can use them
+    generatedTrajectory = make_unique<TrajectoryBuffer>(2, MAX_TRAJECTORY_SAMPLES);
+    analyser = make_unique<Analyser>(dbConnector);
+    // Usable right away, prepare() switches to the sample rate of the audio device
+    analyser->initialise(44100.0);
+    traverser = make_unique<Traverser>(dbConnector, *analyser, *generatedTrajectory, generatedGrains);
+    grainStream = make_unique<GrainStream>(*traverser, 2);
+    recordingWorker = make_unique<RecordingWorker>(dbConnector, GRAINS_IN_TRAJECTORY * GRAIN_LENGTH);
+    recordingWorker->prepare(44100.0);
+    playbackEngine = make_unique<PlaybackEngine>(*generatedTrajectory, *grainStream, *recordingWorker);
+
+    trajectoryWorker = make_unique<TrajectoryWorker>(*traverser);
+    trajectoryWorker->onRequestFinished = [this] (int requestId) {
+        // Notify RL agent that we are ready to receive the next trajectory, echoing the id of its request
+        OSCMessage msgOut = OSCMessage("/juce_ready_for_next");
+        if(requestId >= 0){
+            msgOut.addInt32(requestId);
+        }
+        sendToAgent(msgOut);
+    };
+
+    batchEvaluator = make_unique<BatchEvaluator>(dbConnector, numThreads);
+    batchEvaluator->onBatchEvaluated = [this] (const BatchEvaluator::Result& result) {
+        sendToAgent(BatchEvaluator::createResultMessage(result));
+    };
+
+    recordingWorker->onRecordingAnalysed = [this] (const vector<Grain>& grains, const vector<float>& timbre) {
+        // Send to RL first, the grains are already analysed so this goes out right after the recording stopped
+        primeTrajectory(grains);
+        // Generate trajectory from audio, matching the timbre of the recording (in the background, the first search by
+        // timbre builds the index)
+        trajectoryWorker->submitGrains(grains, timbre);
+    };
+
+    // Uploaded audio primes the agent, just like a local recording. Replies to uploaders that gave no reply address are
+    // relayed through the agent
+    audioUpload.sendReply = [this] (const OSCMessage& message) { sendToAgent(message); };
+    audioUpload.onUploadComplete = [this] (AudioBuffer<float>& audio) {
+        log("Audio upload complete: " + String(audio.getNumSamples()) + " samples");
+        // Analysed on the recording worker, which then reports it like a recording
+        recordingWorker->analyseUpload(audio);
+    };
+
+    registerOSCHandlers();
+
+    // Messages over shared memory go through the same handlers (dispatched on the transport's reader thread)
+    sharedMemory.onMessage = [this] (const OSCMessage& message) { oscDispatcher.dispatch(message); };
+}
+
+AgentSession::~AgentSession() {
+    sharedMemory.close();
+    oscDispatcher.disconnect();
+    sender.disconnect();
+}
+
+bool AgentSession::connect(int oscListeningPort, int oscSenderPort) {
+    // Messages are received on the dispatcher's own thread and routed by address
+    connected = oscDispatcher.connect(oscListeningPort) && sender.connect("127.0.0.1", oscSenderPort);
+    if(!connected){
+        fprintf(stderr, "Error: session %d could not connect to UDP ports %d / %d\n", sessionId, oscListeningPort, oscSenderPort);
+    }
+    return connected;
+}
+
+OSCDispatcher& AgentSession::getDispatcher() {
+    return oscDispatcher;
+}
+
+void AgentSession::prepare(double sampleRate) {
+    analyser->initialise(sampleRate);
+    recordingWorker->prepare(sampleRate);
+}
+
+void AgentSession::process(AudioBuffer<float>& buffer, int numSamples) {
+    playbackEngine->process(buffer, numSamples);
+}
+
+bool AgentSession::isConnected() const {
+    return connected;
+}
+
+bool AgentSession::openSharedMemory(const String& name) {
+    return sharedMemory.open(name);
+}
+
+int AgentSession::getSessionId() const {
+    return sessionId;
+}
+
+Analyser& AgentSession::getAnalyser() {
+    return *analyser;
+}
+
+Traverser& AgentSession::getTraverser() {
+    return *traverser;
+}
+
+GrainStream& AgentSession::getGrainStream() {
+    return *grainStream;
+}
+
+PlaybackEngine& AgentSession::getPlaybackEngine() {
+    return *playbackEngine;
+}
+
+RecordingWorker& AgentSession::getRecordingWorker() {
+    return *recordingWorker;
+}
+
+void AgentSession::registerOSCHandlers() {
+    using Context = OSCDispatcher::Context;
+
+    // Receiver thread: Thread-safe handlers
+    oscDispatcher.addHandler("/params", Context::receiverThread, [this] (const OSCMessage& message) {
+        // Handle new set of grain parameters
+        // Either a single feature blob or per-argument: An optional leading int argument sets the grain length in
+        // samples, the trajectory length is given by the number of floats (NUM_FEATURES per grain). An optional
+        // trailing int is the request id, echoed in the reply
+        int grainLength = GRAIN_LENGTH;
+        vector<float> params;
+        const FeatureBlob::Format format = FeatureBlob::read(message, params, grainLength);
+        const int requestId = FeatureBlob::readRequestId(message);
+        if(format == FeatureBlob::Format::malformed){
+            // Nothing is generated, the error is the reply the agent waits for (sent from the message thread)
+            OSCMessage rejected = OSCMessage("/params_malformed");
+            rejected.addInt32(requestId);
+            oscDispatcher.dispatch(rejected);
+            return;
+        }
+        if(format == FeatureBlob::Format::blob){
+            // The agent speaks blobs, so reply in kind
+            useBlobTransport = true;
+        }
+        // Generate new grain trajectory from RL parameters in the background.
+        // The worker replies with "/juce_ready_for_next" once the trajectory is ready, malformed parameters are
+        // answered with "/params_error" instead.
+        trajectoryWorker->submit(std::move(params), grainLength, requestId);
+    });
+    oscDispatcher.addHandler("/osc_from_js", Context::receiverThread, [this] (const OSCMessage& message) {
+        // Scrub position along the trajectory (in the range of [0...1]) from the mobile interface, the audio thread
+        // crossfades between the two grains around it. This is the highest-rate address: The position is an atomic
+        // target, so bursts coalesce to the latest value without going through the message thread
+        playbackEngine->setScrubPosition(message[0].getFloat32());
+    });
+    oscDispatcher.addHandler("/search_mode", Context::receiverThread, [this] (const OSCMessage& message) {
+        // 0 for greedy matching, 1 for Viterbi unit selection
+        traverser->setSearchMode(message[0].getInt32() == 1 ? Traverser::SearchMode::viterbi : Traverser::SearchMode::greedy);
+    });
+    oscDispatcher.addHandler("/timbre_search", Context::receiverThread, [this] (const OSCMessage& message) {
+        // 0 exact, 1 inverted file, 2 HNSW graph, 3 automatic, 4 compressed (product quantisation); optional latency
+        // budget (ms per trajectory) for automatic
+        static const Traverser::TimbreSearch modes[] = { Traverser::TimbreSearch::exact, Traverser::TimbreSearch::ivf,
+                                                         Traverser::TimbreSearch::hnsw, Traverser::TimbreSearch::automatic,
+                                                         Traverser::TimbreSearch::pq };
+        traverser->setTimbreSearch(modes[jlimit(0, 4, message[0].getInt32())],
+                                   message.size() > 1 ? message[1].getFloat32() : 5.0f);
+    });
+    oscDispatcher.addHandler("/silence_gate", Context::receiverThread, [this] (const OSCMessage& message) {
+        // Files loaded from now on leave out grains below this RMS level (dBFS); optional noise gate flatness (0 to 1)
+        analyser->setSilenceGate(message[0].getFloat32(), message.size() > 1 ? message[1].getFloat32() : 0.0f);
+    });
+    oscDispatcher.addHandler("/blob_transport", Context::receiverThread, [this] (const OSCMessage& message) {
+        // Send feature vectors to the agent as packed blobs (1) or one float argument per value (0)
+        useBlobTransport = message[0].getInt32() != 0;
+    });
+
+    // Coalesced: Continuous controls, only the latest value matters
+    oscDispatcher.addHandler("/grain_density", Context::coalesced, [this] (const OSCMessage& message) {
+        PlaybackEngine::Command command;
+        command.type = PlaybackEngine::Command::Type::setDensity;
+        command.value = message[0].getFloat32();
+        playbackEngine->post(command);
+    });
+
+    // Message thread: Commands to the playback engine (single producer), the grain stream and the transports
+    oscDispatcher.addHandler("/play", Context::messageThread, [this] (const OSCMessage& message) {
+        // Replaces the play button: 0 stops, 1 plays the current trajectory once, 2 loops it
+        int playMode = message[0].getInt32();
+        playbackEngine->post(playMode == 2 ? PlaybackEngine::Command::Type::loop
+                             : playMode == 1 ? PlaybackEngine::Command::Type::playOnce
+                             : PlaybackEngine::Command::Type::stop);
+    });
+    oscDispatcher.addHandler("/osc_from_js_is_looping", Context::messageThread, [this] (const OSCMessage& message) {
+        playbackEngine->post(message[0].getInt32() != 0 ? PlaybackEngine::Command::Type::scrub : PlaybackEngine::Command::Type::stop);
+    });
+    // Streaming mode: "/stream" and "/stream_params"
+    grainStream->registerOSCHandlers(oscDispatcher);
+    oscDispatcher.addHandler("/granular", Context::messageThread, [this] (const OSCMessage& message) {
+        // Start (1) or stop (0) granular playback, an optional second argument sets the grain density. Stopping goes
+        // back to looping the current trajectory
+        if(message.size() > 1){
+            PlaybackEngine::Command command;
+            command.type = PlaybackEngine::Command::Type::setDensity;
+            command.value = message[1].getFloat32();
+            playbackEngine->post(command);
+        }
+        const bool shouldBeGranular = message[0].getInt32() != 0;
+        playbackEngine->post(shouldBeGranular ? PlaybackEngine::Command::Type::granular : PlaybackEngine::Command::Type::loop);
+    });
+    oscDispatcher.addHandler("/evaluate_batch", Context::messageThread, [this] (const OSCMessage& message) {
+        // Match a batch of candidate trajectories without rendering, the evaluator replies with "/batch_result"
+        BatchEvaluator::Batch batch;
+        if(!BatchEvaluator::readBatch(message, batch)){
+            // Reply anyway so the agent does not wait for it
+            fprintf(stderr, "Session %d: Malformed batch %d\n", sessionId, batch.batchId);
+            BatchEvaluator::Result empty;
+            empty.batchId = batch.batchId;
+            sendToAgent(BatchEvaluator::createResultMessage(empty));
+        } else if(!BatchEvaluator::fitsReply(batch)){
+            // Rejected before any work is done: The result could not be sent in one message
+            const int numGrains = batch.numTrajectories * BatchEvaluator::getGrainsPerTrajectory(batch);
+            OSCMessage msgOut = OSCMessage("/batch_error");
+            msgOut.addInt32(batch.batchId);
+            msgOut.addString("Batch too large: The result of " + String(numGrains) + " grains does not fit into one "
+                             "message, split it into smaller batches");
+            sendToAgent(msgOut);
+        } else {
+            batch.searchMode = traverser->getSearchMode();
+            batchEvaluator->submit(std::move(batch));
+        }
+    });
+    oscDispatcher.addHandler("/shared_memory", Context::messageThread, [this] (const OSCMessage& message) {
+        // Switch to the shared-memory transport (string argument: segment name) or back to OSC (no argument or 0).
+        // The answer always goes out over OSC, the agent maps the segment once it is ready
+        const bool shouldOpen = message.size() > 0 && message[0].isString();
+        const bool isOpen = shouldOpen ? sharedMemory.open(message[0].getString()) : false;
+        if(!shouldOpen){
+            sharedMemory.close();
+        }
+        OSCMessage msgOut = OSCMessage("/shared_memory_ready");
+        msgOut.addInt32(isOpen);
+        sender.send(msgOut);
+        log(isOpen ? "Agent transport: shared memory" : "Agent transport: OSC");
+    });
+    oscDispatcher.addHandler("/params_malformed", Context::messageThread, [this] (const OSCMessage& message) {
+        // Fed in by the "/params" handler when it rejects a message, with the request id of the rejected message
+        OSCMessage msgOut = OSCMessage("/params_error");
+        msgOut.addString("Malformed parameters: expected a feature blob, or an optional int32 grain length and "
+                         + String(NUM_FEATURES) + " float32 features per grain");
+        if(message.size() > 0 && message[0].getInt32() >= 0){
+            msgOut.addInt32(message[0].getInt32());
+        }
+        sendToAgent(msgOut);
+    });
+    oscDispatcher.addHandler("/session", Context::messageThread, [this] (const OSCMessage&) {
+        // Which session this port belongs to
+        OSCMessage msgOut = OSCMessage("/session");
+        msgOut.addInt32(sessionId);
+        sendToAgent(msgOut);
+    });
+
+    // Chunked audio upload from remote devices (see AudioUploadReceiver.h): Chunks are written straight from the
+    // receiver thread, everything that replies goes through the message thread
+    oscDispatcher.addHandler("/upload_begin", Context::messageThread, [this] (const OSCMessage& message) {
+        audioUpload.begin(message);
+    });
+    oscDispatcher.addHandler("/upload_chunk", Context::receiverThread, [this] (const OSCMessage& message) {
+        audioUpload.receiveChunk(message);
+    });
+    oscDispatcher.addHandler("/upload_end", Context::messageThread, [this] (const OSCMessage& message) {
+        audioUpload.end(message);
+    });
+}
+
+void AgentSession::sendToAgent(const OSCMessage& message) {
+    if(sharedMemory.isOpen()){
+        sharedMemory.send(message);
+    } else {
+        sender.send(message);
+    }
+}
+
+void AgentSession::sendMetrics(const AudioCallbackMetrics::Snapshot& metrics) {
+    // Callbacks, overruns, max duration (ms), max and mean budget ratio, histogram bins
+    OSCMessage message = OSCMessage("/metrics");
+    message.addInt32(static_cast<int32>(metrics.numCallbacks));
+    message.addInt32(static_cast<int32>(metrics.numOverruns));
+    message.addFloat32(static_cast<float>(metrics.maxDurationMs));
+    message.addFloat32(static_cast<float>(metrics.maxBudgetRatio));
+    message.addFloat32(static_cast<float>(metrics.meanBudgetRatio));
+    for(auto count : metrics.histogram){
+        message.addInt32(static_cast<int32>(count));
+    }
+    sendToAgent(message);
+}
+
+void AgentSession::primeTrajectory(const vector<Grain>& grains) {
+    OSCMessage message = OSCMessage("/prime_trajectory");
+
+    // Convert grains to RL parameters
+    vector<float> data = traverser->convertGrainsToRLFormat(grains);
+    // Shared-memory slots only hold a few arguments, so always send a blob there
+    FeatureBlob::write(message, data, useBlobTransport || sharedMemory.isOpen());
+
+    sendToAgent(message);
+}
+
+void AgentSession::log(const String& message) {
+    if(onLogMessage){
+        onLogMessage(message);
+    } else {
+        fprintf(stdout, "Session %d: %s\n", sessionId, message.toRawUTF8());
+    }
+}
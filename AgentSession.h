@@ -0,0 +1,166 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_AGENTSESSION_H
+#define DMLAP_BACKEND_AGENTSESSION_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_osc/juce_osc.h>
+#include "DBConnector.h"
+#include "Analyser.h"
+#include "Traverser.h"
+#include "TrajectoryBuffer.h"
+#include "TrajectoryWorker.h"
+#include "BatchEvaluator.h"
+#include "GrainStream.h"
+#include "PlaybackEngine.h"
+#include "RecordingWorker.h"
+#include "FeatureBlob.h"
+#include "SharedMemoryTransport.h"
+#include "OSCDispatcher.h"
+#include "AudioUploadReceiver.h"
+#include "AudioCallbackMetrics.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Everything one RL agent talks to: Its own OSC ports (or shared-memory segment), analyser, traverser, trajectory
+ * buffers, trajectory worker, batch evaluator, recording worker, audio upload and playback engine, together with the
+ * handlers of the agent protocol. The headless server runs one session per agent, the GUI application owns a single
+ * one and only adds the handlers of its buttons. Only the grain database is shared between sessions, so the corpus is
+ * held once per process no matter how many agents are served.
+ * The owner adds its own handlers to getDispatcher() before calling connect(), and pulls the rendered audio from the
+ * audio thread with process().
+ */
+class AgentSession {
+public:
+    /**
+     * @param sessionId Index of the session, used in log messages
+     * @param dbConnector The shared grain database
+     * @param numThreads Worker budget: Number of trajectories of a batch matched in parallel
+     */
+    AgentSession(int sessionId, DBConnector& dbConnector, int numThreads);
+    ~AgentSession();
+
+    /**
+     * Start receiving and sending OSC (message thread, after the owner added its handlers)
+     * @param oscListeningPort Port to receive this agent's messages on
+     * @param oscSenderPort Port this agent listens on
+     * @return True if both the receiver and the sender could be connected
+     */
+    bool connect(int oscListeningPort, int oscSenderPort);
+
+    /**
+     * The dispatcher routing this agent's messages, for the owner to add handlers before connect()
+     * @return The dispatcher
+     */
+    OSCDispatcher& getDispatcher();
+
+    /**
+     * Prepare for playback (message thread, before the audio starts)
+     * @param sampleRate
+     */
+    void prepare(double sampleRate);
+
+    /**
+     * Audio thread: Render the next block of this session
+     * @param buffer Stereo buffer, at least numSamples long
+     * @param numSamples
+     */
+    void process(AudioBuffer<float>& buffer, int numSamples);
+
+    /**
+     * Whether the OSC receiver and sender could be connected
+     * @return True if connected
+     */
+    bool isConnected() const;
+
+    /**
+     * Talk to the agent over shared memory instead of OSC (see SharedMemoryProtocol.h)
+     * @param name Name of the shared-memory segment
+     * @return False if the segment could not be created
+     */
+    bool openSharedMemory(const String& name);
+
+    /**
+     * Send a message to the agent, over shared memory if it is open, otherwise over OSC
+     * @param message
+     */
+    void sendToAgent(const OSCMessage& message);
+
+    /**
+     * Send the audio callback metrics to the agent as "/metrics" (message thread)
+     * @param metrics
+     */
+    void sendMetrics(const AudioCallbackMetrics::Snapshot& metrics);
+
+    /**
+     * Prime the agent with already analysed grains ("/prime_trajectory", message thread)
+     * @param grains
+     */
+    void primeTrajectory(const vector<Grain>& grains);
+
+    int getSessionId() const;
+    Analyser& getAnalyser();
+    Traverser& getTraverser();
+    GrainStream& getGrainStream();
+    PlaybackEngine& getPlaybackEngine();
+    RecordingWorker& getRecordingWorker();
+
+    // Called on the message thread with status messages for the user, printed to stdout if not set
+    std::function<void(const String&)> onLogMessage;
+
+private:
+    /**
+     * Register the handler of every OSC address with the dispatcher, together with the thread it runs on
+     */
+    void registerOSCHandlers();
+
+    /**
+     * Hand a status message to onLogMessage (message thread)
+     * @param message
+     */
+    void log(const String& message);
+
+    int sessionId;
+
+    // Feature analysis (not thread-safe, so one per session)
+    unique_ptr<Analyser> analyser;
+
+    // Trajectory generation
+    unique_ptr<TrajectoryBuffer> generatedTrajectory;
+    vector<Grain> generatedGrains;
+    unique_ptr<Traverser> traverser;
+    unique_ptr<TrajectoryWorker> trajectoryWorker;
+    unique_ptr<GrainStream> grainStream;
+    // Matches batches of candidate trajectories for the agent without rendering them
+    unique_ptr<BatchEvaluator> batchEvaluator;
+
+    // Analyses recorded audio while recording, and keeps the last recording
+    unique_ptr<RecordingWorker> recordingWorker;
+    // Playback state machine run by the audio thread (must be destroyed before the buffers it plays from)
+    unique_ptr<PlaybackEngine> playbackEngine;
+    // Chunked audio upload from remote devices, e.g. the mobile interface
+    AudioUploadReceiver audioUpload { GRAINS_IN_TRAJECTORY * GRAIN_LENGTH };
+
+    // OSC
+    OSCSender sender;
+    bool connected = false;
+    // Send feature vectors to the agent as packed blobs instead of one argument per value (set from the receiver thread)
+    atomic<bool> useBlobTransport { false };
+    // Optional shared-memory transport, replaces OSC in both directions once opened
+    SharedMemoryTransport sharedMemory;
+    // Receives OSC on its own thread and routes messages to the handlers
+    OSCDispatcher oscDispatcher;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AgentSession)
+};
+
+
+#endif //DMLAP_BACKEND_AGENTSESSION_H
@@ -0,0 +1,89 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <juce_events/juce_events.h>
+#include "AgentSimulator.h"
+
+/**
+ * Agent simulator: Drives a running backend (GUI or headless) like the RL agent would and reports round-trip
+ * latencies and drop rates, then exits.
+ *
+ * Options:
+ *   --mode <closed|open|batch>  Wait for every reply, send at a fixed rate, or send "/evaluate_batch" (default closed)
+ *   --host <address>            Host of the backend (default 127.0.0.1)
+ *   --port <port>               Port the backend listens on (default 12000)
+ *   --reply-port <port>         Port the backend replies to (default 5005)
+ *   --requests <n>              Number of requests, batches in batch mode (default 100)
+ *   --rate <n>                  Requests per second, 0 for as fast as possible (default 0)
+ *   --concurrency <n>           Batch mode: Batches in flight (default 4)
+ *   --batch-size <n>            Batch mode: Trajectories per batch (default 16)
+ *   --grains <n>                Grains per random trajectory (default GRAINS_IN_TRAJECTORY)
+ *   --no-blobs                  Send one float argument per value instead of feature blobs
+ *   --timeout <ms>              A request without reply after this long counts as dropped (default 2000)
+ *   --replay <params.txt>       Replay a recorded stream, one trajectory per line (same format as --render)
+ *   --record <params.txt>       Write the parameters that were sent, for replaying them later
+ *   --seed <n>                  Seed of the random parameter stream (default 1)
+ */
+class DMLAP_AgentSimApplication : public juce::JUCEApplicationBase
+{
+public:
+    const juce::String getApplicationName() override       { return "DMLAP Agent Simulator"; }
+    const juce::String getApplicationVersion() override    { return "0.0.1"; }
+    bool moreThanOneInstanceAllowed() override             { return true; }
+
+    void initialise (const juce::String& commandLine) override
+    {
+        ArgumentList arguments ("DMLAP_AgentSim", commandLine);
+        AgentSimulator::Options options;
+
+        String mode = arguments.containsOption("--mode") ? arguments.getValueForOption("--mode") : "closed";
+        if(mode == "open"){
+            options.mode = AgentSimulator::Mode::openLoop;
+        } else if(mode == "batch"){
+            options.mode = AgentSimulator::Mode::batch;
+        } else if(mode != "closed"){
+            fprintf(stderr, "Error: unknown mode %s\n", mode.toRawUTF8());
+            setApplicationReturnValue(1);
+            quit();
+            return;
+        }
+
+        if(arguments.containsOption("--host")) options.host = arguments.getValueForOption("--host");
+        if(arguments.containsOption("--port")) options.backendPort = arguments.getValueForOption("--port").getIntValue();
+        if(arguments.containsOption("--reply-port")) options.replyPort = arguments.getValueForOption("--reply-port").getIntValue();
+        if(arguments.containsOption("--requests")) options.numRequests = arguments.getValueForOption("--requests").getIntValue();
+        if(arguments.containsOption("--rate")) options.rate = arguments.getValueForOption("--rate").getDoubleValue();
+        if(arguments.containsOption("--concurrency")) options.concurrency = jmax(1, arguments.getValueForOption("--concurrency").getIntValue());
+        if(arguments.containsOption("--batch-size")) options.batchSize = jmax(1, arguments.getValueForOption("--batch-size").getIntValue());
+        if(arguments.containsOption("--grains")) options.grainsPerTrajectory = jmax(1, arguments.getValueForOption("--grains").getIntValue());
+        if(arguments.containsOption("--timeout")) options.timeoutMs = arguments.getValueForOption("--timeout").getIntValue();
+        if(arguments.containsOption("--replay")) options.replayFile = arguments.getFileForOption("--replay");
+        if(arguments.containsOption("--record")) options.recordFile = arguments.getFileForOption("--record");
+        if(arguments.containsOption("--seed")) options.seed = arguments.getValueForOption("--seed").getLargeIntValue();
+        options.useBlobs = !arguments.containsOption("--no-blobs");
+
+        if(options.replayFile != File() && !options.replayFile.existsAsFile()){
+            fprintf(stderr, "Error: %s does not exist\n", options.replayFile.getFullPathName().toRawUTF8());
+            setApplicationReturnValue(1);
+            quit();
+            return;
+        }
+
+        // The replies arrive on the receiver's thread, so the benchmark can block this one
+        AgentSimulator simulator (options);
+        AgentSimulator::Report report = simulator.run();
+        fprintf(stdout, "%s\n", report.toString().toRawUTF8());
+        setApplicationReturnValue(report.numSent > 0 ? 0 : 1);
+        quit();
+    }
+
+    void shutdown() override                                    {}
+    void systemRequestedQuit() override                         { quit(); }
+    void anotherInstanceStarted (const juce::String&) override  {}
+    void suspended() override                                   {}
+    void resumed() override                                     {}
+    void unhandledException (const std::exception*, const juce::String&, int) override { jassertfalse; }
+};
+
+START_JUCE_APPLICATION (DMLAP_AgentSimApplication)
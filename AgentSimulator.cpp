@@ -0,0 +1,337 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "AgentSimulator.h"
+
+String AgentSimulator::Report::toString() const {
+    String text = "Sent " + String(numSent) + ", replies " + String(numReplies) + ", rejected " + String(numRejected)
+                  + ", dropped " + String(numDropped)
+                  + " (" + String(dropRate * 100.0, 1) + " %) in " + String(seconds, 2) + " s\n"
+                  + (numLateReplies > 0 ? String(numLateReplies) + " late replies ignored\n" : String())
+                  + "Round trip (ms): p50 " + String(p50, 2) + ", p90 " + String(p90, 2) + ", p99 " + String(p99, 2)
+                  + ", max " + String(max, 2) + "\n"
+                  + "From the backend: " + String(numPrimed) + " primed trajectories, " + String(numRewards) + " rewards, "
+                  + String(numPauses) + " pauses";
+    if(backendOverruns >= 0){
+        text += "\nBackend audio callback overruns " + String(backendOverruns) + ", max budget " + String(backendMaxBudgetRatio * 100.0f, 1) + " %";
+    }
+    return text;
+}
+
+AgentSimulator::AgentSimulator(const Options& options) : options(options), random(options.seed) {
+    if(options.replayFile != File()){
+        replayStream = readStream(options.replayFile);
+    }
+    if(options.recordFile != File()){
+        options.recordFile.deleteFile();
+        recordStream = options.recordFile.createOutputStream();
+    }
+    addListener(this);
+}
+
+AgentSimulator::~AgentSimulator() {
+    disconnect();
+    removeListener(this);
+    sender.disconnect();
+}
+
+AgentSimulator::Report AgentSimulator::run() {
+    Report report;
+    if(!connect(options.replyPort) || !sender.connect(options.host, options.backendPort)){
+        fprintf(stderr, "Error: could not connect to UDP ports %d / %d\n", options.replyPort, options.backendPort);
+        return report;
+    }
+
+    const double startTime = Time::getMillisecondCounterHiRes();
+    switch(options.mode){
+        case Mode::closedLoop: runClosedLoop(report); break;
+        case Mode::openLoop: runOpenLoop(report); break;
+        case Mode::batch: runBatch(report); break;
+    }
+    report.seconds = (Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    disconnect();
+    finishReport(report);
+    return report;
+}
+
+vector<vector<float>> AgentSimulator::readStream(const File& file) {
+    vector<vector<float>> stream;
+    StringArray lines;
+    file.readLines(lines);
+    for(const auto& line : lines){
+        StringArray tokens;
+        tokens.addTokens(line, " \t,", "");
+        tokens.removeEmptyStrings();
+        if(tokens.isEmpty()){
+            continue;
+        }
+        vector<float> params;
+        params.reserve(static_cast<size_t>(tokens.size()));
+        for(const auto& token : tokens){
+            params.emplace_back(token.getFloatValue());
+        }
+        stream.emplace_back(std::move(params));
+    }
+    return stream;
+}
+
+void AgentSimulator::oscMessageReceived(const OSCMessage& message) {
+    // Receiver thread
+    const double now = Time::getMillisecondCounterHiRes();
+    const String address = message.getAddressPattern().toString();
+
+    if(address == "/juce_ready_for_next" || address == "/params_error"){
+        // Both end a request: Rejected requests are answered, but not counted as a round trip. The reply echoes the
+        // id of its request, replies without one are credited to the newest request
+        const bool isRejected = address == "/params_error";
+        const int requestId = message.size() > 0 && message[message.size() - 1].isInt32() ? message[message.size() - 1].getInt32() : -1;
+        const ScopedLock sl (stateLock);
+        auto it = requestId >= 0 ? outstandingSends.find(requestId)
+                                 : (outstandingSends.empty() ? outstandingSends.end() : prev(outstandingSends.end()));
+        if(it == outstandingSends.end()){
+            // Late reply to a request that already timed out
+            numLateReplies++;
+            return;
+        }
+        if(isRejected){
+            numRejected++;
+        } else {
+            latencies.emplace_back(now - it->second);
+            numReplies++;
+        }
+        // The backend answers its newest request, older ones were superseded
+        numSuperseded += static_cast<int>(distance(outstandingSends.begin(), it));
+        outstandingSends.erase(outstandingSends.begin(), next(it));
+        replyEvent.signal();
+    }
+    if((address == "/batch_result" || address == "/batch_error") && message.size() > 0 && message[0].isInt32()){
+        const ScopedLock sl (stateLock);
+        auto it = outstandingBatches.find(message[0].getInt32());
+        if(it != outstandingBatches.end()){
+            if(address == "/batch_error"){
+                numRejected++;
+            } else {
+                latencies.emplace_back(now - it->second);
+                numReplies++;
+            }
+            outstandingBatches.erase(it);
+        }
+        replyEvent.signal();
+    }
+    if(address == "/prime_trajectory"){
+        // Like the agent: The primed trajectory is where the next one starts from
+        int grainLength = GRAIN_LENGTH;
+        vector<float> params;
+        if(FeatureBlob::read(message, params, grainLength) == FeatureBlob::Format::malformed){
+            return;
+        }
+        const ScopedLock sl (stateLock);
+        primedParams = std::move(params);
+        numPrimed++;
+    }
+    if(address == "/reward" || address == "/super_like"){
+        numRewards++;
+    }
+    if(address == "/pause" && message.size() > 0){
+        isPaused = message[0].getInt32() != 0;
+        numPauses++;
+    }
+    if(address == "/metrics" && message.size() > 3){
+        // Callbacks, overruns, max duration (ms), max budget ratio, ...
+        backendOverruns = message[1].getInt32();
+        backendMaxBudgetRatio = message[3].getFloat32();
+    }
+}
+
+vector<float> AgentSimulator::nextParams() {
+    {
+        const ScopedLock sl (stateLock);
+        if(!primedParams.empty()){
+            vector<float> params;
+            params.swap(primedParams);
+            return params;
+        }
+    }
+    if(!replayStream.empty()){
+        const vector<float>& params = replayStream[replayIdx];
+        replayIdx = (replayIdx + 1) % replayStream.size();
+        return params;
+    }
+
+    // Random walk through the normalised feature space, like an untrained policy exploring
+    vector<float> params (static_cast<size_t>(options.grainsPerTrajectory * NUM_FEATURES));
+    for(int feature = 0; feature < NUM_FEATURES; feature++){
+        float value = random.nextFloat();
+        for(int grain = 0; grain < options.grainsPerTrajectory; grain++){
+            value = jlimit(0.0f, 1.0f, value + (random.nextFloat() - 0.5f) * 0.2f);
+            params[static_cast<size_t>(grain * NUM_FEATURES + feature)] = value;
+        }
+    }
+    return params;
+}
+
+void AgentSimulator::sendParams(const vector<float>& params, int requestId) {
+    OSCMessage message ("/params");
+    FeatureBlob::write(message, params, options.useBlobs);
+    message.addInt32(requestId);
+    sender.send(message);
+
+    if(recordStream != nullptr){
+        String line;
+        for(size_t i = 0; i < params.size(); i++){
+            line += (i == 0 ? "" : " ") + String(params[i], 6);
+        }
+        recordStream->writeText(line + "\n", false, false, nullptr);
+    }
+}
+
+void AgentSimulator::pace(double& nextSendTime) {
+    while(isPaused){
+        Thread::sleep(10);
+        nextSendTime = Time::getMillisecondCounterHiRes();
+    }
+    if(options.rate <= 0.0){
+        return;
+    }
+    const double waitMs = nextSendTime - Time::getMillisecondCounterHiRes();
+    if(waitMs > 0.0){
+        Thread::sleep(static_cast<int>(waitMs));
+    }
+    nextSendTime = jmax(nextSendTime + 1000.0 / options.rate, Time::getMillisecondCounterHiRes() - 1000.0 / options.rate);
+}
+
+void AgentSimulator::runClosedLoop(Report& report) {
+    double nextSendTime = Time::getMillisecondCounterHiRes();
+    for(int i = 0; i < options.numRequests; i++){
+        pace(nextSendTime);
+        vector<float> params = nextParams();
+        {
+            const ScopedLock sl (stateLock);
+            outstandingSends.clear();
+            outstandingSends[i] = Time::getMillisecondCounterHiRes();
+        }
+        replyEvent.reset();
+        sendParams(params, i);
+        report.numSent++;
+
+        if(!replyEvent.wait(options.timeoutMs)){
+            // No reply: Count it as dropped and go on like the agent would after a timeout. A reply that still comes
+            // carries this request's id, so it is not mistaken for the reply to the next one
+            const ScopedLock sl (stateLock);
+            if(outstandingSends.erase(i) > 0){
+                report.numDropped++;
+            }
+        }
+    }
+}
+
+void AgentSimulator::runOpenLoop(Report& report) {
+    double nextSendTime = Time::getMillisecondCounterHiRes();
+    for(int i = 0; i < options.numRequests; i++){
+        pace(nextSendTime);
+        vector<float> params = nextParams();
+        {
+            const ScopedLock sl (stateLock);
+            outstandingSends[i] = Time::getMillisecondCounterHiRes();
+        }
+        sendParams(params, i);
+        report.numSent++;
+    }
+
+    // Give the last request time to come back
+    const double deadline = Time::getMillisecondCounterHiRes() + options.timeoutMs;
+    while(Time::getMillisecondCounterHiRes() < deadline){
+        {
+            const ScopedLock sl (stateLock);
+            if(outstandingSends.empty()){
+                break;
+            }
+        }
+        replyEvent.wait(10);
+    }
+
+    const ScopedLock sl (stateLock);
+    report.numDropped = numSuperseded + static_cast<int>(outstandingSends.size());
+}
+
+void AgentSimulator::runBatch(Report& report) {
+    double nextSendTime = Time::getMillisecondCounterHiRes();
+    int nextBatchId = 0;
+    while(true){
+        // Expire batches without reply
+        int numOutstanding;
+        {
+            const ScopedLock sl (stateLock);
+            const double expiry = Time::getMillisecondCounterHiRes() - options.timeoutMs;
+            for(auto it = outstandingBatches.begin(); it != outstandingBatches.end();){
+                if(it->second < expiry){
+                    it = outstandingBatches.erase(it);
+                    report.numDropped++;
+                } else {
+                    ++it;
+                }
+            }
+            numOutstanding = static_cast<int>(outstandingBatches.size());
+        }
+        if(report.numSent >= options.numRequests && numOutstanding == 0){
+            break;
+        }
+        if(report.numSent >= options.numRequests || numOutstanding >= options.concurrency){
+            // Wait for a reply to free a slot
+            replyEvent.wait(10);
+            continue;
+        }
+
+        pace(nextSendTime);
+        // All trajectories of a batch must be equally long: Cut or pad them to the first one
+        vector<float> params = nextParams();
+        const size_t trajectorySize = params.size();
+        params.reserve(trajectorySize * static_cast<size_t>(options.batchSize));
+        for(int i = 1; i < options.batchSize; i++){
+            vector<float> trajectory = nextParams();
+            trajectory.resize(trajectorySize, 0.5f);
+            params.insert(params.end(), trajectory.begin(), trajectory.end());
+        }
+
+        const int batchId = nextBatchId++;
+        OSCMessage message ("/evaluate_batch");
+        message.addInt32(batchId);
+        message.addInt32(options.batchSize);
+        FeatureBlob::write(message, params, options.useBlobs);
+        {
+            const ScopedLock sl (stateLock);
+            outstandingBatches[batchId] = Time::getMillisecondCounterHiRes();
+        }
+        replyEvent.reset();
+        sender.send(message);
+        report.numSent++;
+    }
+}
+
+void AgentSimulator::finishReport(Report& report) {
+    const ScopedLock sl (stateLock);
+    report.numReplies = numReplies;
+    report.numRejected = numRejected;
+    report.numLateReplies = numLateReplies;
+    report.numPrimed = numPrimed;
+    report.numRewards = numRewards;
+    report.numPauses = numPauses;
+    report.backendOverruns = backendOverruns;
+    report.backendMaxBudgetRatio = backendMaxBudgetRatio;
+    report.dropRate = report.numSent > 0 ? static_cast<double>(report.numDropped) / report.numSent : 0.0;
+
+    if(latencies.empty()){
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [this] (double p) {
+        const auto idx = static_cast<size_t>(p * static_cast<double>(latencies.size() - 1) + 0.5);
+        return latencies[idx];
+    };
+    report.p50 = percentile(0.5);
+    report.p90 = percentile(0.9);
+    report.p99 = percentile(0.99);
+    report.max = latencies.back();
+}
@@ -0,0 +1,172 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_AGENTSIMULATOR_H
+#define DMLAP_BACKEND_AGENTSIMULATOR_H
+
+#include <atomic>
+#include <map>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+#include "FeatureBlob.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Stand-in for the Python RL agent for benchmarks: Speaks the agent's side of the OSC protocol and drives the backend
+ * (GUI or headless) with recorded or random parameter streams, then reports round-trip latencies and drop rates.
+ *
+ * Modes:
+ *   closedLoop: Like the real agent, send "/params" and wait for "/juce_ready_for_next" (or "/params_error" if the
+ *               backend rejected them) before sending the next one
+ *   openLoop:   Send "/params" at a fixed rate regardless of replies. The backend only keeps the latest request, so
+ *               older requests without reply when a newer one is answered count as dropped (superseded).
+ * Every "/params" carries a sequence number as request id, which the backend echoes in its reply, so a late reply to a
+ * request that already timed out is ignored instead of being credited to the request in flight.
+ *   batch:      Keep up to "concurrency" "/evaluate_batch" requests in flight, replies are matched by batch id
+ * Messages the backend sends to the agent ("/prime_trajectory", "/reward", "/super_like", "/pause", "/metrics") are
+ * counted; "/pause" suspends sending and a primed trajectory becomes the next set of parameters, like the agent does.
+ */
+class AgentSimulator : private OSCReceiver,
+                       private OSCReceiver::Listener<OSCReceiver::RealtimeCallback> {
+public:
+    enum class Mode { closedLoop, openLoop, batch };
+
+    struct Options {
+        Mode mode = Mode::closedLoop;
+        String host = "127.0.0.1";
+        // Port the backend listens on
+        int backendPort = 12000;
+        // Port the backend sends its replies to
+        int replyPort = 5005;
+        // Number of requests to send
+        int numRequests = 100;
+        // Requests per second, 0 for as fast as the mode allows
+        double rate = 0.0;
+        // Batch mode: Requests in flight and trajectories per batch
+        int concurrency = 4;
+        int batchSize = 16;
+        // Grains per random trajectory (replayed trajectories keep their length)
+        int grainsPerTrajectory = GRAINS_IN_TRAJECTORY;
+        // Send feature vectors as blobs instead of one float argument per value
+        bool useBlobs = true;
+        // A request without reply after this long counts as dropped (milliseconds)
+        int timeoutMs = 2000;
+        // Recorded parameter stream (one trajectory per line, like the offline renderer), empty for random parameters
+        File replayFile;
+        // Write the parameters that were sent to this file, for replaying the same stream later
+        File recordFile;
+        // Seed of the random parameter stream
+        int64 seed = 1;
+    };
+
+    struct Report {
+        int numSent = 0;
+        int numReplies = 0;
+        // Requests the backend answered with "/params_error" or "/batch_error"
+        int numRejected = 0;
+        // Replies to requests that had already timed out
+        int numLateReplies = 0;
+        int numDropped = 0;
+        double dropRate = 0.0;
+        // Round-trip latencies (milliseconds)
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double seconds = 0.0;
+        // Messages the backend sent on its own
+        int numPrimed = 0;
+        int numRewards = 0;
+        int numPauses = 0;
+        // Last "/metrics" of the backend: Audio callback overruns and worst budget ratio
+        int backendOverruns = -1;
+        float backendMaxBudgetRatio = 0.0f;
+
+        String toString() const;
+    };
+
+    explicit AgentSimulator(const Options& options);
+    ~AgentSimulator() override;
+
+    /**
+     * Connect to the backend and run the benchmark (blocks until it is done)
+     * @return The report, with nothing sent if the ports could not be opened
+     */
+    Report run();
+
+    /**
+     * Read a recorded parameter stream: One trajectory per line, the values separated by whitespace or commas
+     * @param file
+     * @return The trajectories, empty lines are skipped
+     */
+    static vector<vector<float>> readStream(const File& file);
+
+private:
+    void oscMessageReceived(const OSCMessage& message) override;
+
+    /**
+     * The parameters of the next request: From the primed trajectory if there is one, else replayed or random
+     */
+    vector<float> nextParams();
+
+    void runClosedLoop(Report& report);
+    void runOpenLoop(Report& report);
+    void runBatch(Report& report);
+
+    /**
+     * Send parameters, recording them if asked to
+     * @param params
+     * @param requestId Sequence number of the request, echoed by the backend
+     */
+    void sendParams(const vector<float>& params, int requestId);
+
+    /**
+     * Sleep until it is time for the next request at the configured rate, and while the backend paused the agent
+     * @param nextSendTime Time of the next request (Time::getMillisecondCounterHiRes), advanced by one period
+     */
+    void pace(double& nextSendTime);
+
+    /**
+     * Fill in latency percentiles and the drop rate
+     */
+    void finishReport(Report& report);
+
+    Options options;
+    OSCSender sender;
+    Random random;
+    vector<vector<float>> replayStream;
+    size_t replayIdx = 0;
+    unique_ptr<FileOutputStream> recordStream;
+
+    // Shared with the receiver thread, guarded by stateLock
+    CriticalSection stateLock;
+    vector<double> latencies;
+    // Closed and open loop: Send time per request id of the requests without reply yet
+    map<int, double> outstandingSends;
+    int numSuperseded = 0;
+    // Batch mode: Send time per batch id
+    map<int, double> outstandingBatches;
+    vector<float> primedParams;
+
+    // Replies and backend-initiated messages
+    WaitableEvent replyEvent;
+    atomic<int> numReplies { 0 };
+    atomic<int> numRejected { 0 };
+    atomic<int> numLateReplies { 0 };
+    atomic<int> numPrimed { 0 };
+    atomic<int> numRewards { 0 };
+    atomic<int> numPauses { 0 };
+    atomic<bool> isPaused { false };
+    atomic<int> backendOverruns { -1 };
+    atomic<float> backendMaxBudgetRatio { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AgentSimulator)
+};
+
+
+#endif //DMLAP_BACKEND_AGENTSIMULATOR_H
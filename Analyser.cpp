@@ -9,10 +9,12 @@ Analyser::Analyser(DBConnector& connector)
 
 }
 
-void Analyser::analyseAndSaveToDB(AudioBuffer<float>& buffer, const string& filename, const string& path){
+int Analyser::analyseAndSaveToDB(AudioBuffer<float>& buffer, const string& path){
     int index = 0;
-    int counter = 1;
+    int numPruned = 0;
+    const int fileId = dbConnector.registerFile(path);
     vector<Grain> grains;
+    vector<float> timbre;
     while(index + GRAIN_LENGTH < buffer.getNumSamples()){
         // Clear essentia audiobuffer
         eAudioBuffer.clear();
@@ -23,47 +25,94 @@ void Analyser::analyseAndSaveToDB(AudioBuffer<float>& buffer, const string& file
         }
 
         computeFeatures();
-        grains.emplace_back(Grain(filename + to_string(counter),
-                                  path,
-                                  index,
-                                  eLoudness,
-                                  eSpectralCentroid,
-                                  eSpectralFlux,
-                                  ePitch
-        ));
+        if(passesSilenceGate()){
+            grains.emplace_back(createGrain(fileId, index));
+            timbre.insert(timbre.end(), eMFCC.begin(), eMFCC.end());
+        } else {
+            numPruned++;
+        }
 
         // Update index -> start of next grain
         index += GRAIN_LENGTH;
-        counter++;
     }
     // Save grains to database
-    dbConnector.insertGrains(grains);
+    dbConnector.insertGrains(grains, timbre);
+    return numPruned;
 }
 
 vector<Grain> Analyser::audioBufferToGrains(AudioBuffer<float>& buffer){
-    int index = 0;
-    int counter = 1;
     vector<Grain> grains;
-    while(index + GRAIN_LENGTH < buffer.getNumSamples()){
-        // Clear essentia audiobuffer
-        eAudioBuffer.clear();
+    audioBufferToGrains(buffer, grains);
+    return grains;
+}
 
-        auto* reader = buffer.getReadPointer(0);
-        for (int i = index; i < index + GRAIN_LENGTH; i++){
-            eAudioBuffer.push_back(reader[i]);
-        }
+void Analyser::audioBufferToGrains(AudioBuffer<float>& buffer, vector<Grain>& grains){
+    int index = 0;
+    grains.clear();
+    auto* reader = buffer.getReadPointer(0);
+    while(index + GRAIN_LENGTH < buffer.getNumSamples()){
+        grains.emplace_back(analyseGrain(reader + index));
 
-        computeFeatures();
+        // Update index -> start of next grain
+        index += GRAIN_LENGTH;
+    }
+}
 
-        Grain* grain = new Grain(eLoudness, eSpectralCentroid, eSpectralFlux, ePitch);
-        grains.emplace_back(*grain);
+void Analyser::audioBufferToGrains(AudioBuffer<float>& buffer, vector<Grain>& grains, vector<float>& timbre){
+    int index = 0;
+    grains.clear();
+    timbre.clear();
+    auto* reader = buffer.getReadPointer(0);
+    while(index + GRAIN_LENGTH < buffer.getNumSamples()){
+        grains.emplace_back(analyseGrain(reader + index));
+        timbre.insert(timbre.end(), eMFCC.begin(), eMFCC.end());
 
         // Update index -> start of next grain
         index += GRAIN_LENGTH;
-        counter++;
     }
+}
 
-    return grains;
+Grain Analyser::analyseGrain(const float* samples){
+    // Fill essentia audiobuffer (the algorithms are bound to this vector, so it is refilled rather than replaced)
+    eAudioBuffer.assign(samples, samples + GRAIN_LENGTH);
+
+    computeFeatures();
+
+    return createGrain(-1, -1);
+}
+
+const vector<Real>& Analyser::getTimbre() const {
+    return eMFCC;
+}
+
+void Analyser::setSilenceGate(float thresholdDb, float flatness) {
+    silenceThresholdDb = thresholdDb;
+    noiseFlatness = jlimit(0.0f, 1.0f, flatness);
+}
+
+float Analyser::getSilenceThresholdDb() const {
+    return silenceThresholdDb;
+}
+
+float Analyser::getNoiseFlatness() const {
+    return noiseFlatness;
+}
+
+bool Analyser::passesSilenceGate() {
+    return SilenceGate::passes(static_cast<float>(eRMS), silenceThresholdDb, noiseFlatness, [this] {
+        aFlatness->compute();
+        return static_cast<float>(eFlatness);
+    });
+}
+
+Grain Analyser::createGrain(int fileId, int idx) const {
+    // Map the algorithm outputs to the features of the schema
+    float features[NUM_FEATURES];
+    features[FeatureSchema::loudness] = eLoudness;
+    features[FeatureSchema::spectralCentroid] = eSpectralCentroid;
+    features[FeatureSchema::spectralFlux] = eSpectralFlux;
+    features[FeatureSchema::pitch] = ePitch;
+    return Grain(fileId, idx, features);
 }
 
 void Analyser::computeFeatures(){
@@ -74,6 +123,8 @@ void Analyser::computeFeatures(){
     aLoudness->compute();
     aSpectralFlux->compute();
     aPitchYINFFT->compute();
+    aMFCC->compute();
+    aRMS->compute();
 }
 
 void Analyser::initialise(double sr) {
@@ -85,12 +136,16 @@ void Analyser::initialise(double sr) {
     // Initialise essentia algorithms
     aWindowing.reset(factory.create("Windowing", "type", "blackmanharris62"));
     aSpectrum.reset(factory.create("Spectrum"));
-    aMFCC.reset(factory.create("MFCC"));
+    aMFCC.reset(factory.create("MFCC",
+                               "inputSize", GRAIN_LENGTH / 2 + 1,
+                               "sampleRate", sr,
+                               "numberCoefficients", TIMBRE_DIMENSIONS));
     aSpectralCentroid.reset(factory.create("SpectralCentroidTime", "sampleRate", sr));
     aLoudness.reset(factory.create("Loudness"));
     aSpectralFlux.reset(factory.create("Flux"));
     aPitchYINFFT.reset(factory.create("PitchYinFFT"));
     aRMS.reset(factory.create("RMS"));
+    aFlatness.reset(factory.create("Flatness"));
 
     // Connect algorithms
     aWindowing->input("frame").set(eAudioBuffer);
@@ -115,9 +170,18 @@ void Analyser::initialise(double sr) {
     aPitchYINFFT->output("pitch").set(ePitch);
     aPitchYINFFT->output("pitchConfidence").set(ePitchConfidence);
 
+    // MFCCs (timbre)
+    aMFCC->input("spectrum").set(eSpectrumData);
+    aMFCC->output("bands").set(eMelBands);
+    aMFCC->output("mfcc").set(eMFCC);
+
     // RMS
     aRMS->input("array").set(eAudioBuffer);
     aRMS->output("rms").set(eRMS);
+
+    // Spectral flatness (noise gate)
+    aFlatness->input("array").set(eSpectrumData);
+    aFlatness->output("flatness").set(eFlatness);
 }
 
 Analyser::~Analyser() = default;
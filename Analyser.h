@@ -5,11 +5,13 @@
 #ifndef DMLAP_BACKEND_ANALYSER_H
 #define DMLAP_BACKEND_ANALYSER_H
 
+#include <atomic>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 #include "external_libraries/essentia/include/algorithmfactory.h"
 #include "Grain.h"
 #include "DBConnector.h"
+#include "SilenceGate.h"
 #include "Constants.h"
 
 using namespace juce;
@@ -28,10 +30,33 @@ public:
     // Initialise all fields - sets up essentia algorithms
     void initialise(double sr);
 
-    // This method stores grain audio feature data in database -> used when initially reading grains from files into corpus
-    void analyseAndSaveToDB(AudioBuffer<float>& buffer, const string& filename, const string& path);
+    // This method stores grain audio feature data in database -> used when initially reading grains from files into corpus.
+    // Grains that don't pass the silence gate are left out, returns their number
+    int analyseAndSaveToDB(AudioBuffer<float>& buffer, const string& path);
     // This method creates grains in memory -> used when recording audio to prime the agent
     vector<Grain> audioBufferToGrains(AudioBuffer<float>& buffer);
+    // Same as above, but fills a vector owned by the caller (no allocation once it has grown to size)
+    void audioBufferToGrains(AudioBuffer<float>& buffer, vector<Grain>& grains);
+    // Same as above, also filling the timbre vector of every grain (TIMBRE_DIMENSIONS MFCCs per grain, one after another)
+    void audioBufferToGrains(AudioBuffer<float>& buffer, vector<Grain>& grains, vector<float>& timbre);
+    // Computes the audio features of a single grain of GRAIN_LENGTH samples -> used when analysing a recording while it is running
+    Grain analyseGrain(const float* samples);
+    // The timbre vector (TIMBRE_DIMENSIONS MFCCs) of the grain analysed last
+    const vector<Real>& getTimbre() const;
+
+    /**
+     * Set the silence gate of the corpus: Grains quieter than the threshold (silent tails, gaps between samples) are not
+     * saved to the database, so they are never matched and don't skew the feature statistics. Recordings are analysed
+     * in full, since every grain of a trajectory has its place.
+     * @param thresholdDb Minimum RMS level of a grain in dBFS (-100 or less to keep every grain)
+     * @param noiseFlatness Noise gate: Grains up to SilenceGate::noiseGateRangeDb above the threshold whose spectral flatness is at
+     * least this value (0 to 1, 1 being white noise) are left out as well, e.g. hiss or hum between takes. 0 disables it.
+     */
+    void setSilenceGate(float thresholdDb, float noiseFlatness = 0.0f);
+
+    float getSilenceThresholdDb() const;
+
+    float getNoiseFlatness() const;
 
 private:
     // Connection to the grain database
@@ -59,6 +84,12 @@ private:
     Real ePitchConfidence = 0.0f;
     // The root mean square of the audio data of a grain
     Real eRMS = 0.0f;
+    // The spectral flatness of the grain (only computed for the noise gate)
+    Real eFlatness = 0.0f;
+    // Energy in the mel bands of the grain (input of the MFCCs)
+    vector<Real> eMelBands;
+    // The MFCCs of the grain: Its timbre vector
+    vector<Real> eMFCC;
 
     // Essentia algorithms are marked by an "a" prefix
     unique_ptr<Algorithm> aWindowing;
@@ -69,9 +100,18 @@ private:
     unique_ptr<Algorithm> aSpectralFlux;
     unique_ptr<Algorithm> aPitchYINFFT;
     unique_ptr<Algorithm> aRMS;
+    unique_ptr<Algorithm> aFlatness;
+
+    // Silence gate of the corpus (see setSilenceGate), set from any thread
+    atomic<float> silenceThresholdDb { SilenceGate::defaultThresholdDb };
+    atomic<float> noiseFlatness { 0.0f };
 
     // Computes audio features for the current audio buffer
     void computeFeatures();
+    // Whether the grain analysed last passes the silence gate (computes its spectral flatness if the noise gate is on)
+    bool passesSilenceGate();
+    // Creates a grain from the features computed last (every feature of FeatureSchema.h is filled in here)
+    Grain createGrain(int fileId, int idx) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Analyser)
 };
@@ -0,0 +1,83 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "AudioCallbackMetrics.h"
+
+AudioCallbackMetrics::ScopedMeasurement::ScopedMeasurement(AudioCallbackMetrics& metrics, int numSamples)
+: metrics(metrics), numSamples(numSamples), startTicks(Time::getHighResolutionTicks()) {
+}
+
+AudioCallbackMetrics::ScopedMeasurement::~ScopedMeasurement() {
+    metrics.record(Time::getHighResolutionTicks() - startTicks, numSamples);
+}
+
+void AudioCallbackMetrics::prepare(double sampleRate) {
+    ticksPerSample = sampleRate > 0.0 ? static_cast<double>(Time::getHighResolutionTicksPerSecond()) / sampleRate : 0.0;
+    reset();
+}
+
+void AudioCallbackMetrics::record(int64 durationTicks, int numSamples) {
+    const auto budgetTicks = static_cast<int64>(ticksPerSample.load(memory_order_relaxed) * numSamples);
+    if(budgetTicks <= 0){
+        return;
+    }
+    const double ratio = static_cast<double>(durationTicks) / static_cast<double>(budgetTicks);
+
+    numCallbacks.fetch_add(1, memory_order_relaxed);
+    totalDurationTicks.fetch_add(durationTicks, memory_order_relaxed);
+    totalBudgetTicks.fetch_add(budgetTicks, memory_order_relaxed);
+    // One comparison decides both: A callback that uses exactly its budget is on time and goes into the 90-100% bin
+    const bool isOverrun = ratio > 1.0;
+    if(isOverrun){
+        numOverruns.fetch_add(1, memory_order_relaxed);
+    }
+    const int bin = isOverrun ? numBins - 1 : jmin(numBins - 2, static_cast<int>(ratio * (numBins - 1)));
+    histogram[static_cast<size_t>(bin)].fetch_add(1, memory_order_relaxed);
+
+    // Only the audio thread writes the maxima, so no compare-exchange loop is needed
+    if(durationTicks > maxDurationTicks.load(memory_order_relaxed)){
+        maxDurationTicks.store(durationTicks, memory_order_relaxed);
+    }
+    if(ratio > maxBudgetRatio.load(memory_order_relaxed)){
+        maxBudgetRatio.store(ratio, memory_order_relaxed);
+    }
+}
+
+AudioCallbackMetrics::Snapshot AudioCallbackMetrics::getSnapshot() const {
+    Snapshot snapshot;
+    snapshot.numCallbacks = numCallbacks.load(memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load(memory_order_relaxed);
+    snapshot.maxDurationMs = Time::highResolutionTicksToSeconds(maxDurationTicks.load(memory_order_relaxed)) * 1000.0;
+    snapshot.maxBudgetRatio = maxBudgetRatio.load(memory_order_relaxed);
+    const int64 budget = totalBudgetTicks.load(memory_order_relaxed);
+    snapshot.meanBudgetRatio = budget > 0 ? static_cast<double>(totalDurationTicks.load(memory_order_relaxed)) / static_cast<double>(budget) : 0.0;
+    for(size_t i = 0; i < histogram.size(); i++){
+        snapshot.histogram[i] = histogram[i].load(memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void AudioCallbackMetrics::reset() {
+    numCallbacks = 0;
+    numOverruns = 0;
+    maxDurationTicks = 0;
+    maxBudgetRatio = 0.0;
+    totalDurationTicks = 0;
+    totalBudgetTicks = 0;
+    for(auto& bin : histogram){
+        bin = 0;
+    }
+}
+
+String AudioCallbackMetrics::Snapshot::toString() const {
+    String summary = "Audio callbacks: " + String(numCallbacks) + ", overruns: " + String(numOverruns)
+                     + ", max: " + String(maxDurationMs, 3) + " ms (" + String(maxBudgetRatio * 100.0, 1) + "% of block)"
+                     + ", mean: " + String(meanBudgetRatio * 100.0, 1) + "% of block\n";
+    summary += "Budget histogram:";
+    for(int i = 0; i < numBins; i++){
+        summary += (i < numBins - 2 ? " <" + String((i + 1) * 10) + "%: " : i < numBins - 1 ? String(" <=100%: ") : String(" >100%: "))
+                   + String(histogram[static_cast<size_t>(i)]);
+    }
+    return summary;
+}
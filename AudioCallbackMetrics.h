@@ -0,0 +1,104 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_AUDIOCALLBACKMETRICS_H
+#define DMLAP_BACKEND_AUDIOCALLBACKMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Lock-free performance counters for the audio callback.
+ * The audio thread measures each callback and records its duration relative to the real-time budget (the duration of
+ * the block at the current sample rate). Recording only touches preallocated atomics, so it never blocks or allocates.
+ * Any other thread can take a snapshot at any time, e.g. to show it in the diagnostics box or send it to the agent.
+ */
+class AudioCallbackMetrics {
+public:
+    // Histogram bins: Budget ratio in steps of 10% (the tenth one up to and including 100%), the last bin holds all
+    // callbacks that ran over the budget, i.e. exactly the ones counted in numOverruns
+    static constexpr int numBins = 11;
+
+    // Counters at one point in time
+    struct Snapshot {
+        int64 numCallbacks = 0;
+        // Number of callbacks that took longer than their block period
+        int64 numOverruns = 0;
+        double maxDurationMs = 0.0;
+        // Largest and mean ratio of callback duration to block period
+        double maxBudgetRatio = 0.0;
+        double meanBudgetRatio = 0.0;
+        array<int64, numBins> histogram {};
+
+        /**
+         * Human readable summary for the diagnostics box
+         * @return The summary
+         */
+        String toString() const;
+    };
+
+    /**
+     * Measures the callback it is created in (RAII)
+     */
+    class ScopedMeasurement {
+    public:
+        ScopedMeasurement(AudioCallbackMetrics& metrics, int numSamples);
+        ~ScopedMeasurement();
+
+    private:
+        AudioCallbackMetrics& metrics;
+        int numSamples;
+        int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedMeasurement)
+    };
+
+    AudioCallbackMetrics() = default;
+
+    /**
+     * Set the sample rate used to compute the block period. Resets all counters.
+     * @param sampleRate
+     */
+    void prepare(double sampleRate);
+
+    /**
+     * Audio thread: Record one callback
+     * @param durationTicks Duration of the callback in high resolution ticks
+     * @param numSamples Number of samples in the block
+     */
+    void record(int64 durationTicks, int numSamples);
+
+    /**
+     * Any thread: Take a snapshot of all counters
+     * @return The snapshot
+     */
+    Snapshot getSnapshot() const;
+
+    /**
+     * Reset all counters. Callbacks recorded concurrently may be partially lost.
+     */
+    void reset();
+
+private:
+    // Budget per sample in high resolution ticks
+    atomic<double> ticksPerSample { 0.0 };
+
+    atomic<int64> numCallbacks { 0 };
+    atomic<int64> numOverruns { 0 };
+    atomic<int64> maxDurationTicks { 0 };
+    atomic<double> maxBudgetRatio { 0.0 };
+    // Sums of durations and budgets, their ratio is the mean budget ratio
+    atomic<int64> totalDurationTicks { 0 };
+    atomic<int64> totalBudgetTicks { 0 };
+    array<atomic<int64>, numBins> histogram {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioCallbackMetrics)
+};
+
+
+#endif //DMLAP_BACKEND_AUDIOCALLBACKMETRICS_H
@@ -0,0 +1,202 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "AudioUploadReceiver.h"
+
+AudioUploadReceiver::AudioUploadReceiver(int maxNumSamples)
+: maxNumSamples(maxNumSamples),
+  staging(make_unique<AudioBuffer<float>>(2, maxNumSamples)),
+  completed(make_unique<AudioBuffer<float>>(2, maxNumSamples)) {
+    staging->clear();
+    completed->clear();
+}
+
+AudioUploadReceiver::~AudioUploadReceiver() {
+    stopTimer();
+    replySender.disconnect();
+}
+
+void AudioUploadReceiver::begin(const OSCMessage& message) {
+    if(message.size() < 4){
+        return;
+    }
+    const int newUploadId = message[0].getInt32();
+    const int newNumChannels = message[1].getInt32();
+    const int newNumSamples = message[2].getInt32();
+    const int newChunkSize = message[3].getInt32();
+
+    // Replies go straight back to the uploader if it said where, even if the upload is rejected
+    replySender.disconnect();
+    hasReplyAddress = message.size() >= 6 && message[4].isString() && message[5].isInt32()
+                      && replySender.connect(message[4].getString(), message[5].getInt32());
+    if(newNumChannels < 1 || newNumChannels > 2 || newNumSamples <= 0 || newNumSamples > maxNumSamples || newChunkSize <= 0){
+        fprintf(stderr, "Rejected audio upload %d (%d channels, %d samples, chunks of %d)\n", newUploadId, newNumChannels, newNumSamples, newChunkSize);
+        fail(newUploadId);
+        return;
+    }
+
+    {
+        const ScopedLock sl (uploadLock);
+        uploadId = newUploadId;
+        numChannels = newNumChannels;
+        numSamples = newNumSamples;
+        chunkSize = newChunkSize;
+        chunksPerChannel = (numSamples + chunkSize - 1) / chunkSize;
+        receivedChunks.assign(static_cast<size_t>(numChannels * chunksPerChannel), 0);
+        numReceivedChunks = 0;
+        isActive = true;
+        hasEnded = false;
+        staging->clear();
+    }
+    numChunksSinceNack = 0;
+    numNackRounds = 0;
+    stopTimer();
+}
+
+void AudioUploadReceiver::receiveChunk(const OSCMessage& message) {
+    if(message.size() < 5 || !message[4].isBlob()){
+        return;
+    }
+    const int chunkUploadId = message[0].getInt32();
+    const int sequence = message[1].getInt32();
+    const int channel = message[2].getInt32();
+    const int offset = message[3].getInt32();
+    const MemoryBlock& blob = message[4].getBlob();
+
+    const ScopedLock sl (uploadLock);
+    if(!isActive || chunkUploadId != uploadId || sequence < 0 || sequence >= static_cast<int>(receivedChunks.size())
+       || receivedChunks[static_cast<size_t>(sequence)] != 0){
+        // Stale, unknown or duplicate (a retransmission that crossed the original)
+        return;
+    }
+    // The position must agree with the sequence number
+    const int numChunkSamples = jmin(chunkSize, numSamples - offset);
+    if(channel != sequence / chunksPerChannel || offset != (sequence % chunksPerChannel) * chunkSize
+       || blob.getSize() != static_cast<size_t>(numChunkSamples) * sizeof(float)){
+        return;
+    }
+
+#if JUCE_LITTLE_ENDIAN
+    // The payload already is an array of floats, write it in one go
+    staging->copyFrom(channel, offset, static_cast<const float*>(blob.getData()), numChunkSamples);
+#else
+    const auto* data = static_cast<const uint8_t*>(blob.getData());
+    float* dest = staging->getWritePointer(channel, offset);
+    for(int i = 0; i < numChunkSamples; i++){
+        const uint32 bits = ByteOrder::littleEndianInt(data + i * sizeof(float));
+        memcpy(dest + i, &bits, sizeof(float));
+    }
+#endif
+    receivedChunks[static_cast<size_t>(sequence)] = 1;
+    numReceivedChunks++;
+    numChunksSinceNack++;
+}
+
+void AudioUploadReceiver::end(const OSCMessage& message) {
+    if(message.size() < 1){
+        return;
+    }
+    {
+        const ScopedLock sl (uploadLock);
+        if(!isActive || message[0].getInt32() != uploadId){
+            return;
+        }
+        hasEnded = true;
+    }
+    numNackRounds = 0;
+    completeOrRequestMissing();
+}
+
+void AudioUploadReceiver::completeOrRequestMissing() {
+    OSCMessage message ("/upload_nack");
+    int completedSamples = 0;
+    {
+        const ScopedLock sl (uploadLock);
+        if(!isActive || !hasEnded){
+            return;
+        }
+        message.addInt32(uploadId);
+
+        if(numReceivedChunks == static_cast<int>(receivedChunks.size())){
+            // Complete: Duplicate mono uploads and swap the staging buffer in as a whole
+            if(numChannels == 1){
+                staging->copyFrom(1, 0, *staging, 0, 0, numSamples);
+            }
+            swap(staging, completed);
+            completedSamples = numSamples;
+            isActive = false;
+            message = OSCMessage("/upload_complete");
+            message.addInt32(uploadId);
+            message.addInt32(numSamples);
+        } else {
+            // Request the missing chunks, the sender answers with the chunks and another "/upload_end"
+            int numMissing = 0;
+            for(size_t i = 0; i < receivedChunks.size() && numMissing < maxSequencesPerNack; i++){
+                if(receivedChunks[i] == 0){
+                    message.addInt32(static_cast<int32>(i));
+                    numMissing++;
+                }
+            }
+        }
+    }
+    numChunksSinceNack = 0;
+
+    reply(message);
+    if(completedSamples > 0){
+        stopTimer();
+        if(onUploadComplete != nullptr){
+            // Refers to the completed buffer, trimmed to the length of the upload
+            AudioBuffer<float> audio (completed->getArrayOfWritePointers(), 2, completedSamples);
+            onUploadComplete(audio);
+        }
+    } else if(!isTimerRunning()){
+        startTimer(nackInterval);
+    }
+}
+
+void AudioUploadReceiver::fail(int failedUploadId) {
+    {
+        const ScopedLock sl (uploadLock);
+        if(failedUploadId == uploadId){
+            isActive = false;
+        }
+    }
+    stopTimer();
+    OSCMessage message ("/upload_failed");
+    message.addInt32(failedUploadId);
+    reply(message);
+}
+
+void AudioUploadReceiver::reply(const OSCMessage& message) {
+    if(hasReplyAddress){
+        replySender.send(message);
+    } else if(sendReply != nullptr){
+        sendReply(message);
+    }
+}
+
+void AudioUploadReceiver::timerCallback() {
+    int currentUploadId;
+    {
+        const ScopedLock sl (uploadLock);
+        if(!isActive || !hasEnded){
+            stopTimer();
+            return;
+        }
+        currentUploadId = uploadId;
+    }
+
+    if(numChunksSinceNack.exchange(0) > 0){
+        // Retransmissions are still coming in, give the sender time
+        numNackRounds = 0;
+        return;
+    }
+    if(++numNackRounds > maxNackRounds){
+        fprintf(stderr, "Audio upload %d did not complete\n", currentUploadId);
+        fail(currentUploadId);
+        return;
+    }
+    // Nothing arrived for a while: Complete if the last chunks came in without an "/upload_end", else NACK again
+    completeOrRequestMissing();
+}
@@ -0,0 +1,129 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_AUDIOUPLOADRECEIVER_H
+#define DMLAP_BACKEND_AUDIOUPLOADRECEIVER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_events/juce_events.h>
+#include <juce_osc/juce_osc.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Reliable audio upload over OSC, e.g. from the mobile interface, to prime the agent with remote audio.
+ * The audio is sent in chunks of little endian float32 blobs. Every chunk carries a sequence number and its position,
+ * so chunks may arrive in any order. Lost chunks are requested again with NACKs until the upload is complete.
+ * Chunks are written in bulk into a staging buffer, which is swapped with the completed buffer once every chunk is
+ * there, so a half-received upload is never visible.
+ *
+ * Protocol (sender -> backend):
+ *   "/upload_begin" int32 uploadId, int32 numChannels (1 or 2), int32 numSamples, int32 chunkSize (samples per chunk),
+ *                   optionally string replyHost, int32 replyPort
+ *   "/upload_chunk" int32 uploadId, int32 sequence, int32 channel, int32 offset, blob samples
+ *                   with sequence = channel * ceil(numSamples / chunkSize) + offset / chunkSize
+ *   "/upload_end"   int32 uploadId, sent after every chunk was sent once and again after each retransmission
+ * Replies (backend -> sender): OSC does not tell the receiver where a message came from, so the replies go to the
+ * address given in "/upload_begin". Without one they are relayed through sendReply, i.e. to the RL agent, which then
+ * has to forward them to the uploading device.
+ *   "/upload_nack"     int32 uploadId, int32 sequence... (missing chunks, at most maxSequencesPerNack per message)
+ *   "/upload_complete" int32 uploadId, int32 numSamples
+ *   "/upload_failed"   int32 uploadId (the upload was rejected or did not complete after maxNackRounds NACKs)
+ * NACKs are repeated if no chunk arrives for nackInterval milliseconds after "/upload_end".
+ */
+class AudioUploadReceiver : private Timer {
+public:
+    /**
+     * @param maxNumSamples Longest accepted upload per channel, buffers are allocated up front
+     */
+    explicit AudioUploadReceiver(int maxNumSamples);
+    ~AudioUploadReceiver() override;
+
+    /**
+     * Handle "/upload_begin" (message thread). Replaces an upload in progress. Chunks that arrive before their upload
+     * began are dropped and requested again later.
+     * @param message
+     */
+    void begin(const OSCMessage& message);
+
+    /**
+     * Handle "/upload_chunk" (any thread, e.g. straight from the OSC receiver thread)
+     * @param message
+     */
+    void receiveChunk(const OSCMessage& message);
+
+    /**
+     * Handle "/upload_end" (message thread): Completes the upload or requests the missing chunks
+     * @param message
+     */
+    void end(const OSCMessage& message);
+
+    // Called on the message thread with every reply to a sender that gave no reply address
+    std::function<void(const OSCMessage&)> sendReply;
+
+    // Called on the message thread once an upload is complete. The audio (2 channels, as long as the upload) stays
+    // untouched until the next upload completes.
+    std::function<void(AudioBuffer<float>& audio)> onUploadComplete;
+
+private:
+    void timerCallback() override;
+
+    /**
+     * Complete the upload if every chunk is there, otherwise send NACKs (message thread)
+     */
+    void completeOrRequestMissing();
+
+    /**
+     * Give up on the upload in progress and tell the sender (message thread)
+     */
+    void fail(int failedUploadId);
+
+    /**
+     * Send a reply to the sender of the current upload (message thread)
+     */
+    void reply(const OSCMessage& message);
+
+    // Maximum number of sequence numbers in one NACK message
+    static constexpr int maxSequencesPerNack = 256;
+    // Time without progress after which the missing chunks are requested again (milliseconds)
+    static constexpr int nackInterval = 200;
+    // NACK rounds without any progress before the upload is given up
+    static constexpr int maxNackRounds = 10;
+
+    int maxNumSamples;
+
+    // The upload in progress, guarded by uploadLock
+    CriticalSection uploadLock;
+    unique_ptr<AudioBuffer<float>> staging;
+    vector<uint8_t> receivedChunks;
+    int uploadId = -1;
+    int numChannels = 0;
+    int numSamples = 0;
+    int chunkSize = 0;
+    int chunksPerChannel = 0;
+    int numReceivedChunks = 0;
+    bool isActive = false;
+    bool hasEnded = false;
+
+    // Where the replies of the current upload go, if the sender gave an address (message thread)
+    OSCSender replySender;
+    bool hasReplyAddress = false;
+
+    // Last completed upload (message thread)
+    unique_ptr<AudioBuffer<float>> completed;
+
+    // Retransmission state (message thread), progress is counted by the chunk handler
+    atomic<int> numChunksSinceNack { 0 };
+    int numNackRounds = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioUploadReceiver)
+};
+
+
+#endif //DMLAP_BACKEND_AUDIOUPLOADRECEIVER_H
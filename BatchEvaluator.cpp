@@ -0,0 +1,219 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "BatchEvaluator.h"
+
+class BatchEvaluator::Worker : public ThreadPoolJob {
+public:
+    explicit Worker(DBConnector& dbConnector)
+    : ThreadPoolJob("Batch evaluation worker"), dbConnector(dbConnector), analyser(dbConnector), trajectory(2, GRAIN_LENGTH),
+      traverser(dbConnector, analyser, trajectory, target) {
+    }
+
+    /**
+     * Point the worker at the next batch, before it is added to the pool
+     */
+    void setBatch(const Batch& newBatch, atomic<int>& newNextTrajectory, Result& newResult) {
+        batch = &newBatch;
+        nextTrajectory = &newNextTrajectory;
+        result = &newResult;
+        // The corpus may have been empty when the worker was created, or grown since the statistics were calculated.
+        // The revision is read first: Grains inserted while calculating trigger another calculation next time
+        const uint64_t revision = dbConnector.getRevision();
+        if(!traverser.isMinMaxInitialised() || revision != statisticsRevision){
+            traverser.calculateFeatureStatistics();
+            statisticsRevision = revision;
+        }
+        traverser.setSearchMode(batch->searchMode);
+    }
+
+    JobStatus runJob() override {
+        // Take trajectories until all are taken, so that fast and slow ones balance out across the threads
+        const int grainsPerTrajectory = result->grainsPerTrajectory;
+        // Trajectories longer than the result are cut: Their parameters are further apart than their results
+        const size_t paramsPerTrajectory = batch->params.size() / static_cast<size_t>(batch->numTrajectories);
+        for(int idx = (*nextTrajectory)++; idx < batch->numTrajectories; idx = (*nextTrajectory)++){
+            if(shouldExit()){
+                break;
+            }
+            const size_t offset = static_cast<size_t>(idx) * static_cast<size_t>(grainsPerTrajectory);
+            const float* params = &batch->params[static_cast<size_t>(idx) * paramsPerTrajectory];
+            if(!traverser.matchParams(params, grainsPerTrajectory, batch->grainLength, matched, distances)){
+                // No statistics: Leave the trajectory as unmatched
+                continue;
+            }
+            // Every trajectory owns its slice of the result
+            vector<float> features = traverser.convertGrainsToRLFormat(matched);
+            copy(features.begin(), features.end(), result->achievedFeatures.begin() + static_cast<long>(offset * NUM_FEATURES));
+            copy(distances.begin(), distances.end(), result->distances.begin() + static_cast<long>(offset));
+        }
+        return jobHasFinished;
+    }
+
+private:
+    // The batch in progress
+    const Batch* batch = nullptr;
+    atomic<int>* nextTrajectory = nullptr;
+    Result* result = nullptr;
+
+    DBConnector& dbConnector;
+    // Corpus revision the statistics of the traverser were calculated at
+    uint64_t statisticsRevision = 0;
+
+    // Private matching context, reused for every trajectory of this worker (the trajectory buffer is never rendered to)
+    Analyser analyser;
+    TrajectoryBuffer trajectory;
+    vector<Grain> target;
+    Traverser traverser;
+    vector<Grain> matched;
+    vector<float> distances;
+};
+
+BatchEvaluator::BatchEvaluator(DBConnector& dbConnector, int numThreads)
+: Thread("Batch evaluator"), pool(jmax(1, numThreads)) {
+    for(int i = 0; i < jmax(1, numThreads); i++){
+        workers.emplace_back(make_unique<Worker>(dbConnector));
+    }
+    startThread();
+}
+
+BatchEvaluator::~BatchEvaluator() {
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    notify();
+    // Interrupt the batch in flight, the evaluator thread is waiting for it
+    pool.removeAllJobs(true, 4000);
+    stopThread(4000);
+}
+
+void BatchEvaluator::submit(Batch batch) {
+    {
+        const ScopedLock sl (queueLock);
+        pendingBatches.emplace_back(std::move(batch));
+    }
+    notify();
+}
+
+void BatchEvaluator::run() {
+    while(!threadShouldExit()){
+        Batch batch;
+        {
+            const ScopedLock sl (queueLock);
+            if(!pendingBatches.empty()){
+                batch = std::move(pendingBatches.front());
+                pendingBatches.pop_front();
+            }
+        }
+        if(batch.numTrajectories <= 0){
+            // Sleep until the next batch comes in
+            wait(-1);
+            continue;
+        }
+
+        Result result = evaluate(batch);
+        {
+            const ScopedLock sl (queueLock);
+            finishedResults.emplace_back(std::move(result));
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+BatchEvaluator::Result BatchEvaluator::evaluate(const Batch& batch) {
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    Result result;
+    result.batchId = batch.batchId;
+    result.numTrajectories = batch.numTrajectories;
+    result.grainsPerTrajectory = getGrainsPerTrajectory(batch);
+    const size_t numGrains = static_cast<size_t>(result.numTrajectories) * static_cast<size_t>(result.grainsPerTrajectory);
+    result.achievedFeatures.assign(numGrains * NUM_FEATURES, 0.0f);
+    result.distances.assign(numGrains, -1.0f);
+
+    if(numGrains > 0 && !threadShouldExit()){
+        atomic<int> nextTrajectory { 0 };
+        const int numWorkers = jmin(static_cast<int>(workers.size()), batch.numTrajectories);
+        for(int i = 0; i < numWorkers; i++){
+            workers[static_cast<size_t>(i)]->setBatch(batch, nextTrajectory, result);
+            pool.addJob(workers[static_cast<size_t>(i)].get(), false);
+        }
+        for(int i = 0; i < numWorkers; i++){
+            pool.waitForJobToFinish(workers[static_cast<size_t>(i)].get(), -1);
+        }
+    }
+
+    result.seconds = (Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    return result;
+}
+
+void BatchEvaluator::handleAsyncUpdate() {
+    // Several batches may have finished before the message thread got here
+    deque<Result> results;
+    {
+        const ScopedLock sl (queueLock);
+        results.swap(finishedResults);
+    }
+    for(const auto& result : results){
+        if(onBatchEvaluated != nullptr){
+            onBatchEvaluated(result);
+        }
+    }
+}
+
+bool BatchEvaluator::readBatch(const OSCMessage& message, Batch& batch) {
+    if(message.size() < 3 || !message[0].isInt32() || !message[1].isInt32()){
+        return false;
+    }
+    batch.batchId = message[0].getInt32();
+    batch.numTrajectories = message[1].getInt32();
+    batch.params.clear();
+    batch.grainLength = GRAIN_LENGTH;
+
+    if(message.size() == 3 && message[2].isBlob()){
+        if(!FeatureBlob::decode(message[2].getBlob(), batch.params, batch.grainLength)){
+            return false;
+        }
+    } else {
+        batch.params.reserve(static_cast<size_t>(message.size() - 2));
+        for(int i = 2; i < message.size(); i++){
+            if(message[i].isFloat32()){
+                batch.params.emplace_back(message[i].getFloat32());
+            }
+        }
+    }
+
+    const auto numGrains = static_cast<int>(batch.params.size()) / NUM_FEATURES;
+    return batch.numTrajectories > 0 && numGrains > 0 && numGrains % batch.numTrajectories == 0;
+}
+
+int BatchEvaluator::getGrainsPerTrajectory(const Batch& batch) {
+    if(batch.numTrajectories <= 0){
+        return 0;
+    }
+    // Bounded like a rendered trajectory: The traverser is sized for that many grains
+    return jmin(static_cast<int>(batch.params.size()) / NUM_FEATURES / batch.numTrajectories, MAX_GRAINS_IN_TRAJECTORY);
+}
+
+bool BatchEvaluator::fitsReply(const Batch& batch) {
+    // Measured on a result of the same size, so this stays right if the result message changes
+    Result result;
+    result.batchId = batch.batchId;
+    result.numTrajectories = batch.numTrajectories;
+    result.grainsPerTrajectory = getGrainsPerTrajectory(batch);
+    const size_t numGrains = static_cast<size_t>(jmax(0, result.numTrajectories)) * static_cast<size_t>(result.grainsPerTrajectory);
+    result.achievedFeatures.assign(numGrains * NUM_FEATURES, 0.0f);
+    result.distances.assign(numGrains, 0.0f);
+    return SharedMemoryTransport::fits(createResultMessage(result));
+}
+
+OSCMessage BatchEvaluator::createResultMessage(const Result& result) {
+    OSCMessage message = OSCMessage("/batch_result");
+    message.addInt32(result.batchId);
+    message.addInt32(result.numTrajectories);
+    message.addInt32(result.grainsPerTrajectory);
+    message.addBlob(FeatureBlob::encode(result.achievedFeatures));
+    message.addBlob(FeatureBlob::encodeValues(result.distances));
+    message.addFloat32(static_cast<float>(result.seconds));
+    return message;
+}
@@ -0,0 +1,143 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_BATCHEVALUATOR_H
+#define DMLAP_BACKEND_BATCHEVALUATOR_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_osc/juce_osc.h>
+#include "DBConnector.h"
+#include "Analyser.h"
+#include "Traverser.h"
+#include "TrajectoryBuffer.h"
+#include "FeatureBlob.h"
+#include "SharedMemoryTransport.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Evaluates batches of candidate trajectories for the RL agent: Every trajectory is matched against the corpus, but
+ * nothing is rendered. The agent gets back the features the matched grains actually have and their distances to the
+ * targets, for rollouts and exploration without one full render per step.
+ * The trajectories of a batch are matched in parallel on a thread pool, every pool job has its own traverser (created
+ * once and reused), only the grain database is shared. Batches are evaluated in the order they arrive, none is
+ * dropped. Results are reported on the message thread via "onBatchEvaluated".
+ *
+ * OSC protocol:
+ *   "/evaluate_batch" int32 batchId, int32 numTrajectories, then the parameters of all trajectories back to back,
+ *   either as one feature blob (see FeatureBlob.h) or as one float argument per value
+ *   "/batch_result" int32 batchId, int32 numTrajectories, int32 grainsPerTrajectory, blob achieved features (feature
+ *   blob), blob distances (one little endian float32 per grain), float32 seconds
+ *   "/batch_error" int32 batchId, string reason: The batch was not evaluated because its result would not fit into one
+ *   message (see fitsReply()). The agent splits it into smaller batches.
+ * Trajectories longer than MAX_GRAINS_IN_TRAJECTORY grains are matched up to that length, grainsPerTrajectory of the
+ * result tells how many grains were matched. The feature statistics are recalculated whenever the corpus changed.
+ */
+class BatchEvaluator : private Thread, private AsyncUpdater {
+public:
+    // A batch of equally long trajectories
+    struct Batch {
+        // Chosen by the agent, returned with the result
+        int batchId = 0;
+        int numTrajectories = 0;
+        // Parameters of all trajectories back to back, in the same layout as "/params" (NUM_FEATURES floats per grain)
+        vector<float> params;
+        // Grain length the trajectories would be rendered with (samples)
+        int grainLength = GRAIN_LENGTH;
+        Traverser::SearchMode searchMode = Traverser::SearchMode::greedy;
+    };
+
+    struct Result {
+        int batchId = 0;
+        int numTrajectories = 0;
+        int grainsPerTrajectory = 0;
+        // Features of the matched grains in the "/params" layout and range, trajectories back to back
+        vector<float> achievedFeatures;
+        // Target distance per grain, -1 where nothing was found
+        vector<float> distances;
+        // Time it took to evaluate the batch
+        double seconds = 0.0;
+    };
+
+    /**
+     * @param dbConnector The grain database
+     * @param numThreads Number of trajectories matched in parallel
+     */
+    BatchEvaluator(DBConnector& dbConnector, int numThreads);
+    ~BatchEvaluator() override;
+
+    /**
+     * Queue a batch for evaluation. Returns immediately.
+     * @param batch
+     */
+    void submit(Batch batch);
+
+    /**
+     * Parse an "/evaluate_batch" message
+     * @param message
+     * @param batch Receives the batch id, trajectory count and parameters (search mode is left untouched)
+     * @return False if the message is malformed or the parameters don't split into equally long trajectories
+     */
+    static bool readBatch(const OSCMessage& message, Batch& batch);
+
+    /**
+     * Check whether the "/batch_result" of a batch fits into one message: One shared-memory slot, which is also within
+     * a UDP datagram (see SharedMemoryProtocol.h). Batches that don't fit are rejected before they are evaluated.
+     * @param batch A batch read with readBatch()
+     * @return False if the result would be too large
+     */
+    static bool fitsReply(const Batch& batch);
+
+    /**
+     * Number of grains matched per trajectory of a batch
+     * @param batch A batch read with readBatch()
+     * @return The trajectory length, at most MAX_GRAINS_IN_TRAJECTORY
+     */
+    static int getGrainsPerTrajectory(const Batch& batch);
+
+    /**
+     * Create the "/batch_result" reply
+     * @param result
+     * @return The message
+     */
+    static OSCMessage createResultMessage(const Result& result);
+
+    // Called on the message thread for every evaluated batch
+    std::function<void(const Result&)> onBatchEvaluated;
+
+private:
+    // Pool job matching trajectories of the current batch until there are none left
+    class Worker;
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    /**
+     * Match all trajectories of a batch on the pool and block until they are done
+     * @param batch
+     * @return The result
+     */
+    Result evaluate(const Batch& batch);
+
+    ThreadPool pool;
+    vector<unique_ptr<Worker>> workers;
+
+    // Batches waiting for evaluation and results waiting for the message thread, guarded by queueLock
+    CriticalSection queueLock;
+    deque<Batch> pendingBatches;
+    deque<Result> finishedResults;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchEvaluator)
+};
+
+
+#endif //DMLAP_BACKEND_BATCHEVALUATOR_H
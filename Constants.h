@@ -5,6 +5,8 @@
 #ifndef DMLAP_BACKEND_CONSTANTS_H
 #define DMLAP_BACKEND_CONSTANTS_H
 
+#include "FeatureSchema.h"
+
 /**
  * System-wide constants: These must be the same here and in the python agent!
  */
@@ -13,7 +15,24 @@
 static int GRAINS_IN_TRAJECTORY = 33;
 // Grain length in samples
 static int GRAIN_LENGTH = 4096;
-// The number of audio features used to calculate distances
-static int NUM_FEATURES = 4;
+// The number of audio features used to calculate distances (see FeatureSchema.h)
+static constexpr int NUM_FEATURES = FeatureSchema::numFeatures;
+// Number of MFCCs in the timbre vector of a grain (13 to 40, see TimbreIndex.h)
+static constexpr int TIMBRE_DIMENSIONS = 13;
+
+/**
+ * Limits for trajectories requested at runtime: The values above are the defaults, but the agent can request a
+ * different trajectory length and grain length per trajectory.
+ */
+
+// Maximum number of grains in a trajectory
+static int MAX_GRAINS_IN_TRAJECTORY = 256;
+// Maximum length of a trajectory in samples - trajectory buffers are preallocated to this size
+static int MAX_TRAJECTORY_SAMPLES = 128 * 4096;
+// Grain lengths in samples that can be requested (each one has a precomputed window table)
+static const int SUPPORTED_GRAIN_LENGTHS[] = { 1024, 2048, 4096, 8192 };
+static const int NUM_SUPPORTED_GRAIN_LENGTHS = 4;
+// Size of the grain voice pool, i.e. the maximum number of simultaneously playing grains
+static const int MAX_GRAIN_VOICES = 512;
 
 #endif //DMLAP_BACKEND_CONSTANTS_H
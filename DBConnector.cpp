@@ -3,6 +3,7 @@
 //
 
 #include "DBConnector.h"
+#include "VectorKernels.h"
 
 DBConnector::DBConnector() {
     int rc;
@@ -21,47 +22,322 @@ DBConnector::DBConnector() {
         fprintf(stdout, "Opened database successfully\n");
     }
 
-    // Create new table
+    // Create new table: One column per feature of the schema
+    string featureColumns;
+    string featureDefinitions;
+    for(const auto& descriptor : FeatureSchema::descriptors){
+        featureColumns += string(", ") + descriptor.column;
+        featureDefinitions += string(", ") + descriptor.column + " REAL NOT NULL";
+    }
     sql = "CREATE TABLE IF NOT EXISTS GRAIN("
-      "ID INT PRIMARY KEY," \
+      "ID INT PRIMARY KEY,"
       "NAME           TEXT    NOT NULL,"
       "PATH           TEXT    NOT NULL,"
-      "IDX            INT     NOT NULL,"
-      "LOUDNESS       REAL    NOT NULL,"
-      "SPECTRAL_CENTROID         REAL NOT NULL,"
-      "SPECTRAL_FLUX REAL NOT NULL,"
-      "PITCH REAL NOT NULL"
-      ");";
+      "IDX            INT     NOT NULL"
+      + featureDefinitions +
+      ", TIMBRE BLOB);";
 
     sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+
+    // Databases from before a feature was added get the column (fails harmlessly if it exists). The values stay 0
+    // until the corpus is analysed again.
+    for(const auto& descriptor : FeatureSchema::descriptors){
+        sql = string("ALTER TABLE GRAIN ADD COLUMN ") + descriptor.column + " REAL NOT NULL DEFAULT 0;";
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+    sqlite3_exec(db, "ALTER TABLE GRAIN ADD COLUMN TIMBRE BLOB;", nullptr, nullptr, nullptr);
+
+    // Prepare the statements used while generating trajectories: Parameters are bound per query instead of building
+    // and parsing SQL text every time. Closest grain: Two parameters (range) per feature, then the sort target and limit
+    sql = "SELECT PATH, IDX" + featureColumns + " FROM GRAIN WHERE";
+    for(int i = 0; i < NUM_FEATURES; i++){
+        sql += string(i == 0 ? " " : " AND ") + FeatureSchema::descriptors[i].column
+               + " BETWEEN ?" + to_string(2 * i + 1) + " AND ?" + to_string(2 * i + 2);
+    }
+    sql += string(" ORDER BY ABS(") + FeatureSchema::descriptors[FeatureSchema::sortFeature].column
+           + " - ?" + to_string(2 * NUM_FEATURES + 1) + ") LIMIT ?" + to_string(2 * NUM_FEATURES + 2) + ";";
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &closestGrainStatement, nullptr);
+    sql = "SELECT PATH, IDX" + featureColumns + " FROM GRAIN ORDER BY RANDOM() LIMIT ?1;";
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &randomTrajectoryStatement, nullptr);
+    sql = "INSERT INTO GRAIN (NAME, PATH, IDX" + featureColumns + ", TIMBRE) VALUES (?1, ?2, ?3";
+    for(int i = 0; i < NUM_FEATURES; i++){
+        sql += ", ?" + to_string(4 + i);
+    }
+    sql += ", ?" + to_string(4 + NUM_FEATURES) + ");";
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &insertGrainStatement, nullptr);
+    sql = "SELECT PATH, IDX" + featureColumns + ", TIMBRE FROM GRAIN WHERE rowid = ?1;";
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &timbreRowStatement, nullptr);
 }
 
-void DBConnector::insertGrains(vector<Grain>& grains) {
-    std::string sql;
+void DBConnector::insertGrains(vector<Grain>& grains, const vector<float>& timbre) {
+    const bool hasTimbre = timbre.size() == grains.size() * static_cast<size_t>(TIMBRE_DIMENSIONS);
+    uint32_t timbreBlob[TIMBRE_DIMENSIONS];
+    // Database rows of the grains, for the timbre codes
+    vector<sqlite3_int64> insertedRows;
+    {
+        const juce::ScopedLock sl (statementLock);
+
+        // One transaction for all grains of a file
+        sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        for(size_t g = 0; g < grains.size(); g++){
+            const Grain& grain = grains[g];
+            // Name: File name and number of the grain within the file (starting at 1)
+            const string& path = filePaths.at(static_cast<size_t>(grain.getFileId()));
+            const string name = path.substr(path.find_last_of("/\\") + 1) + to_string(grain.getIdx() / GRAIN_LENGTH + 1);
+
+            sqlite3_bind_text(insertGrainStatement, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(insertGrainStatement, 2, path.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(insertGrainStatement, 3, grain.getIdx());
+            for(int i = 0; i < NUM_FEATURES; i++){
+                sqlite3_bind_double(insertGrainStatement, 4 + i, grain.getFeatures()[i]);
+            }
+            // Timbre: Little endian floats, as their IEEE 754 bit pattern
+            if(hasTimbre){
+                for(int i = 0; i < TIMBRE_DIMENSIONS; i++){
+                    uint32_t bits;
+                    memcpy(&bits, &timbre[g * TIMBRE_DIMENSIONS + static_cast<size_t>(i)], sizeof(bits));
+                    timbreBlob[i] = juce::ByteOrder::swapIfBigEndian(bits);
+                }
+                sqlite3_bind_blob(insertGrainStatement, 4 + NUM_FEATURES, timbreBlob, sizeof(timbreBlob), SQLITE_STATIC);
+            } else {
+                sqlite3_bind_null(insertGrainStatement, 4 + NUM_FEATURES);
+            }
+            sqlite3_step(insertGrainStatement);
+            sqlite3_reset(insertGrainStatement);
+            if(hasTimbre){
+                insertedRows.push_back(sqlite3_last_insert_rowid(db));
+            }
+        }
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+    revision++;
+
+    // The next search builds the index again, the graph grows incrementally, and so do the codes unless they were
+    // trained on the whole (smaller) corpus. Outside statementLock: timbreIndexLock is always taken first
+    const juce::ScopedLock sl (timbreIndexLock);
+    timbreIndex.reset();
+    if(timbreGraph != nullptr && hasTimbre){
+        for(size_t g = 0; g < grains.size(); g++){
+            timbreGraph->add(grains[g], &timbre[g * TIMBRE_DIMENSIONS]);
+        }
+        isTimbreGraphSaved = false;
+    }
+    if(timbreCodes != nullptr && hasTimbre && timbreCodes->getNumTrainingVectors() < timbreTrainingSize){
+        timbreCodes.reset();
+    } else if(timbreCodes != nullptr && hasTimbre){
+        for(size_t g = 0; g < insertedRows.size(); g++){
+            timbreCodes->add(insertedRows[g], &timbre[g * TIMBRE_DIMENSIONS]);
+        }
+    }
+}
 
-    sql = "INSERT INTO GRAIN (NAME, PATH, IDX, LOUDNESS, SPECTRAL_CENTROID, SPECTRAL_FLUX, PITCH) VALUES ";
-
-    for(unsigned long i = 0; i < grains.size(); i++){
-        Grain& grain = grains.at(i);
-        sql += "('"
-                + grain.getName() +  "', '"
-                + grain.getPath() + "', " + to_string(grain.getIdx()) + ", "
-                + to_string(grain.getLoudness()) + ", "
-                + to_string(grain.getSpectralCentroid()) + ", "
-                + to_string(grain.getSpectralFlux()) + ", "
-                + to_string(grain.getPitch())
-                + ")";
-        if(i < grains.size() - 1){
-            sql += ",";
+shared_ptr<const TimbreIndex> DBConnector::getTimbreIndex() {
+    const juce::ScopedLock sl (timbreIndexLock);
+    if(timbreIndex == nullptr){
+        vector<Grain> grains;
+        vector<float> timbre;
+        queryTimbre(grains, timbre);
+
+        auto index = make_shared<TimbreIndex>();
+        index->build(grains, timbre, TIMBRE_DIMENSIONS);
+        fprintf(stdout, "Timbre index: %d grains in %d clusters (%s kernels)\n", index->size(), index->getNumLists(),
+                VectorKernels::isUsingAVX2() ? "AVX2" : "portable");
+        timbreIndex = std::move(index);
+    }
+    return timbreIndex;
+}
+
+shared_ptr<const HNSWIndex> DBConnector::getTimbreGraph() {
+    const juce::ScopedLock sl (timbreIndexLock);
+    if(timbreGraph == nullptr){
+        // A saved graph is used if it was saved with the grains the database has now: Same number of rows and same last
+        // row (rows only ever get added, so a corpus that changed since has a larger last row)
+        HNSWIndex::CorpusStamp savedStamp;
+        unique_ptr<HNSWIndex> loaded = HNSWIndex::load(juce::File(TIMBRE_GRAPH_PATH), TIMBRE_DIMENSIONS,
+                                                       [this] (const string& path) { return registerFile(path); }, savedStamp);
+        const HNSWIndex::CorpusStamp stamp = stampTimbre();
+        if(loaded != nullptr && savedStamp == stamp && loaded->size() == stamp.numRows){
+            timbreGraph = std::move(loaded);
+            isTimbreGraphSaved = true;
+        } else {
+            vector<Grain> grains;
+            vector<float> timbre;
+            queryTimbre(grains, timbre);
+
+            const double start = juce::Time::getMillisecondCounterHiRes();
+            timbreGraph = make_shared<HNSWIndex>(TIMBRE_DIMENSIONS);
+            for(size_t g = 0; g < grains.size(); g++){
+                timbreGraph->add(grains[g], &timbre[g * TIMBRE_DIMENSIONS]);
+            }
+            isTimbreGraphSaved = grains.empty();
+            fprintf(stdout, "Timbre graph: %d grains in %.1f s\n", timbreGraph->size(),
+                    (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0);
         }
     }
-    sql += ";";
+    return timbreGraph;
+}
 
-    /* Execute SQL statement */
-    sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+shared_ptr<const PQIndex> DBConnector::getTimbreCodes() {
+    const juce::ScopedLock sl (timbreIndexLock);
+    if(timbreCodes == nullptr){
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        auto codes = make_shared<PQIndex>(TIMBRE_DIMENSIONS);
+        float values[TIMBRE_DIMENSIONS];
+        sqlite3_stmt* statement = nullptr;
+        {
+            const juce::ScopedLock statementSl (statementLock);
+
+            // Train on a random sample, then encode row by row: The vectors of the corpus are never all in memory
+            vector<float> sample;
+            sqlite3_prepare_v2(db, "SELECT TIMBRE FROM GRAIN WHERE LENGTH(TIMBRE) = ?1 ORDER BY RANDOM() LIMIT ?2;", -1, &statement, nullptr);
+            sqlite3_bind_int(statement, 1, TIMBRE_DIMENSIONS * 4);
+            sqlite3_bind_int(statement, 2, timbreTrainingSize);
+            while(sqlite3_step(statement) == SQLITE_ROW){
+                if(readTimbre(statement, 0, values)){
+                    sample.insert(sample.end(), values, values + TIMBRE_DIMENSIONS);
+                }
+            }
+            sqlite3_finalize(statement);
+            // An empty corpus leaves the codes untrained and empty, the first insert resets them
+            codes->train(sample);
+
+            sqlite3_prepare_v2(db, "SELECT rowid, TIMBRE FROM GRAIN WHERE LENGTH(TIMBRE) = ?1;", -1, &statement, nullptr);
+            sqlite3_bind_int(statement, 1, TIMBRE_DIMENSIONS * 4);
+            while(sqlite3_step(statement) == SQLITE_ROW){
+                if(readTimbre(statement, 1, values)){
+                    codes->add(sqlite3_column_int64(statement, 0), values);
+                }
+            }
+            sqlite3_finalize(statement);
+        }
+        fprintf(stdout, "Timbre codes: %d grains, %d bytes each, %.1f MB in %.1f s\n", codes->size(), codes->getNumSubspaces(),
+                static_cast<double>(codes->getMemoryBytes()) / (1024.0 * 1024.0),
+                (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0);
+        timbreCodes = std::move(codes);
+    }
+    return timbreCodes;
+}
+
+uint64_t DBConnector::getRevision() const {
+    return revision.load();
+}
+
+HNSWIndex::CorpusStamp DBConnector::stampTimbre() {
+    const juce::ScopedLock sl (statementLock);
+    sqlite3_stmt* statement = nullptr;
+    // Same rows as queryTimbre(): Timbre vectors of the current length
+    sqlite3_prepare_v2(db, "SELECT COUNT(*), MAX(rowid) FROM GRAIN WHERE LENGTH(TIMBRE) = ?1;", -1, &statement, nullptr);
+    sqlite3_bind_int(statement, 1, TIMBRE_DIMENSIONS * 4);
+    HNSWIndex::CorpusStamp stamp;
+    if(sqlite3_step(statement) == SQLITE_ROW){
+        stamp.numRows = sqlite3_column_int64(statement, 0);
+        stamp.maxRow = sqlite3_column_int64(statement, 1);
+    }
+    sqlite3_finalize(statement);
+    return stamp;
+}
+
+void DBConnector::queryTimbre(vector<Grain>& grains, vector<float>& timbre) {
+    const juce::ScopedLock sl (statementLock);
+    grains.clear();
+    timbre.clear();
+
+    string featureColumns;
+    for(const auto& descriptor : FeatureSchema::descriptors){
+        featureColumns += string(", ") + descriptor.column;
+    }
+    const string sql = "SELECT PATH, IDX" + featureColumns + ", TIMBRE FROM GRAIN WHERE TIMBRE IS NOT NULL;";
+    sqlite3_stmt* statement = nullptr;
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr);
+    float values[TIMBRE_DIMENSIONS];
+    while(sqlite3_step(statement) == SQLITE_ROW){
+        if(readTimbre(statement, 2 + NUM_FEATURES, values)){
+            timbre.insert(timbre.end(), values, values + TIMBRE_DIMENSIONS);
+            grains.emplace_back(readGrain(statement));
+        }
+    }
+    sqlite3_finalize(statement);
+}
+
+void DBConnector::queryTimbreRows(const vector<PQIndex::Neighbour>& rows, vector<Grain>& grains, vector<float>& timbre) {
+    const juce::ScopedLock sl (statementLock);
+    grains.clear();
+    timbre.assign(rows.size() * TIMBRE_DIMENSIONS, 0.0f);
+
+    for(size_t i = 0; i < rows.size(); i++){
+        sqlite3_bind_int64(timbreRowStatement, 1, rows[i].rowId);
+        if(sqlite3_step(timbreRowStatement) == SQLITE_ROW
+           && readTimbre(timbreRowStatement, 2 + NUM_FEATURES, &timbre[i * TIMBRE_DIMENSIONS])){
+            grains.emplace_back(readGrain(timbreRowStatement));
+        } else {
+            grains.emplace_back();
+        }
+        sqlite3_reset(timbreRowStatement);
+    }
+}
+
+bool DBConnector::readTimbre(sqlite3_stmt* statement, int column, float* timbre) {
+    // Rows analysed with a different number of MFCCs are skipped until the corpus is analysed again
+    const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(statement, column));
+    if(blob == nullptr || sqlite3_column_bytes(statement, column) != TIMBRE_DIMENSIONS * 4){
+        return false;
+    }
+    for(int i = 0; i < TIMBRE_DIMENSIONS; i++){
+        const uint32_t bits = juce::ByteOrder::littleEndianInt(blob + 4 * i);
+        memcpy(&timbre[i], &bits, sizeof(float));
+    }
+    return true;
+}
+
+int DBConnector::registerFile(const string& path) {
+    const juce::ScopedLock sl (statementLock);
+    return findOrAddFile(path);
+}
+
+const string& DBConnector::getFilePath(int fileId) {
+    static const string unknown;
+    const juce::ScopedLock sl (statementLock);
+    if(fileId < 0 || fileId >= static_cast<int>(filePaths.size())){
+        return unknown;
+    }
+    return filePaths[static_cast<size_t>(fileId)];
+}
+
+int DBConnector::findOrAddFile(string_view path) {
+    // Heterogeneous lookup: Known paths are found without creating a string
+    auto it = fileIds.find(path);
+    if(it != fileIds.end()){
+        return it->second;
+    }
+    const int fileId = static_cast<int>(filePaths.size());
+    filePaths.emplace_back(path);
+    fileIds.emplace(filePaths.back(), fileId);
+    return fileId;
+}
+
+Grain DBConnector::readGrain(sqlite3_stmt* statement) {
+    const auto* path = reinterpret_cast<const char*>(sqlite3_column_text(statement, 0));
+    const int pathLength = sqlite3_column_bytes(statement, 0);
+    float features[NUM_FEATURES];
+    for(int i = 0; i < NUM_FEATURES; i++){
+        features[i] = static_cast<float>(sqlite3_column_double(statement, 2 + i));
+    }
+    return Grain(findOrAddFile(string_view(path != nullptr ? path : "", static_cast<size_t>(pathLength))),
+                 sqlite3_column_int(statement, 1),
+                 features);
 }
 
 DBConnector::~DBConnector() {
+    sqlite3_finalize(closestGrainStatement);
+    sqlite3_finalize(randomTrajectoryStatement);
+    sqlite3_finalize(insertGrainStatement);
+    sqlite3_finalize(timbreRowStatement);
+
+    // Save the timbre graph, so it doesn't have to be built again on the next start
+    if(timbreGraph != nullptr && !isTimbreGraphSaved){
+        timbreGraph->save(juce::File(TIMBRE_GRAPH_PATH), [this] (int fileId) { return getFilePath(fileId); }, stampTimbre());
+    }
+
     // Copy from in-memory db to disk
     auto backup = sqlite3_backup_init(dbDisk, "main", db, "main");
     sqlite3_backup_step(backup, -1);
@@ -71,73 +347,31 @@ DBConnector::~DBConnector() {
     sqlite3_close(dbDisk);
 }
 
-static int closestGrainCallback(void *data, int argc, char **argv, char **azColName){
-    vector<Grain>* grains = static_cast<vector<Grain>*>(data);
+void DBConnector::queryClosestGrain(const Grain& grain, float margin, int limit, vector<Grain>& found) {
+    const juce::ScopedLock sl (statementLock);
+    found.clear();
 
-    try{
-        // Parse grain
-        Grain grain;
-
-        string name(argv[1]);
-        string path(argv[2]);
-        int idx = (int)strtod(argv[3], nullptr);
-        float loudness = (float)strtod(argv[4], nullptr);
-        float sc = (float)strtod(argv[5], nullptr);
-        float spectralFlux = (float)strtod(argv[6], nullptr);
-        float pitch = (float)strtod(argv[7], nullptr);
-
-        grain.setIdx(idx);
-        grain.setPath(path);
-        grain.setLoudness(loudness);
-        grain.setSpectralCentroid(sc);
-        grain.setSpectralFlux(spectralFlux);
-        grain.setPitch(pitch);
-
-        grains->emplace_back(grain);
-    } catch (...) {
-        fprintf(stdout, "Exception while parsing grain from database.");
-        return argc;
-    }
-    return argc;
-}
-
-vector<Grain> DBConnector::queryClosestGrain(Grain &grain, float margin) {
-    // Get grain values
-    string marginStr = to_string(margin);
-    string loudness = to_string(grain.getLoudness());
-    string sc = to_string(grain.getSpectralCentroid());
-
-    int numGrainsFound = 0;
-    vector<Grain> found;
-
-    while(numGrainsFound == 0){
-        found.clear();
-        string sql;
-        float loudnessMargin = margin / 10.0f;
-        float pitchMargin = margin;
-        float scMargin = margin * 5.0f;
-        float sfMargin = margin * 0.0001f;
-
-        sql = "SELECT * FROM GRAIN WHERE"
-              " LOUDNESS BETWEEN " + to_string(grain.getLoudness() - loudnessMargin) + " AND " + to_string(grain.getLoudness() + loudnessMargin) +
-              " AND " +
-              " SPECTRAL_CENTROID BETWEEN " + to_string(grain.getSpectralCentroid() - scMargin) + " AND " + to_string(grain.getSpectralCentroid() + scMargin) +
-              " AND " +
-              " SPECTRAL_FLUX BETWEEN " + to_string(grain.getSpectralFlux() - sfMargin) + " AND " + to_string(grain.getSpectralFlux() + sfMargin) +
-              " AND " +
-              " PITCH BETWEEN " + to_string(grain.getPitch() - pitchMargin) + " AND " + to_string(grain.getPitch() + pitchMargin) +
-              " ORDER BY ABS(SPECTRAL_CENTROID - " + to_string(grain.getSpectralCentroid()) + ")" +
-              " LIMIT 20"
-              ";";
-        /* Execute SQL statement */
-        numGrainsFound = sqlite3_exec(db, sql.c_str(), closestGrainCallback, &found, nullptr);
-
-        if(numGrainsFound == 0){
+    while(found.empty()){
+        // Every feature within its share of the margin
+        for(int i = 0; i < NUM_FEATURES; i++){
+            const float featureMargin = margin * FeatureSchema::descriptors[i].marginScale;
+            sqlite3_bind_double(closestGrainStatement, 2 * i + 1, grain.getFeatures()[i] - featureMargin);
+            sqlite3_bind_double(closestGrainStatement, 2 * i + 2, grain.getFeatures()[i] + featureMargin);
+        }
+        sqlite3_bind_double(closestGrainStatement, 2 * NUM_FEATURES + 1, grain.getFeature(FeatureSchema::sortFeature));
+        sqlite3_bind_int(closestGrainStatement, 2 * NUM_FEATURES + 2, limit);
+
+        /* Execute SQL statement: Every row up to the limit is a candidate */
+        while(sqlite3_step(closestGrainStatement) == SQLITE_ROW){
+            found.emplace_back(readGrain(closestGrainStatement));
+        }
+        sqlite3_reset(closestGrainStatement);
+
+        if(found.empty()){
             margin += 500;
             fprintf(stdout, "No grain found, trying with margin %f \n", margin);
         }
     }
-    return found;
 }
 
 static int isPopulatedCallback(void *data, int argc, char **argv, char **azColName){
@@ -210,42 +444,14 @@ float DBConnector::queryStd(const string& field) {
     return std;
 }
 
-static int randomTrajectoryCallback(void *data, int argc, char **argv, char **azColName){
-    vector<Grain>* grains = static_cast<vector<Grain>*>(data);
+void DBConnector::queryRandomTrajectory(vector<Grain>& found){
+    const juce::ScopedLock sl (statementLock);
+    found.clear();
 
-    try{
-        // Parse grain
-        Grain grain;
-
-        string name(argv[1]);
-        string path(argv[2]);
-        int idx = (int)strtod(argv[3], nullptr);
-        float loudness = (float)strtod(argv[4], nullptr);
-        float sc = (float)strtod(argv[5], nullptr);
-        float spectralFlux = (float)strtod(argv[6], nullptr);
-        float pitch = (float)strtod(argv[7], nullptr);
-
-        grain.setIdx(idx);
-        grain.setPath(path);
-        grain.setLoudness(loudness);
-        grain.setSpectralCentroid(sc);
-        grain.setSpectralFlux(spectralFlux);
-        grain.setPitch(pitch);
-
-        grains->emplace_back(grain);
-    } catch (...) {
-        fprintf(stderr, "Exception while parsing grain from database.");
-        return 1;
+    sqlite3_bind_int(randomTrajectoryStatement, 1, GRAINS_IN_TRAJECTORY);
+    /* Execute SQL statement */
+    while(sqlite3_step(randomTrajectoryStatement) == SQLITE_ROW){
+        found.emplace_back(readGrain(randomTrajectoryStatement));
     }
-    return 0;
+    sqlite3_reset(randomTrajectoryStatement);
 }
-
-vector<Grain> DBConnector::queryRandomTrajectory(){
-    string sql;
-    sql = "SELECT * FROM GRAIN ORDER BY RANDOM() LIMIT " + to_string(GRAINS_IN_TRAJECTORY) + ";";
-
-    vector<Grain> found;
-    /* Execute SQL statement */
-    sqlite3_exec(db, sql.c_str(), randomTrajectoryCallback, &found, nullptr);
-    return found;
-}
\ No newline at end of file
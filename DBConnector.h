@@ -5,16 +5,33 @@
 #ifndef DMLAP_BACKEND_DBCONNECTOR_H
 #define DMLAP_BACKEND_DBCONNECTOR_H
 #include <cstdio>
+#include <atomic>
 #include <vector>
 #include <set>
+#include <map>
+#include <deque>
+#include <string_view>
+#include <memory>
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "sqlite3.h"
 #include "Grain.h"
 #include "Constants.h"
+#include "TimbreIndex.h"
+#include "HNSWIndex.h"
+#include "PQIndex.h"
 
 /**
  * Helper class for database management. Creates a /connects to a sqlite database for storing grain information.
  * Database entries contain paths to source audio files, start indices of the grains, as well as audio feature data.
+ * Grains in memory refer to their source file by id: Every path read from or written to the database is given an id in
+ * the file table, which lives as long as the connector.
+ * The queries that run while generating trajectories use prepared statements and write into vectors owned by the
+ * caller, so they don't allocate once those vectors have grown to size. Queries are serialised (the statements and the
+ * file table are shared between all threads).
+ * Grains can carry a timbre vector (TIMBRE_DIMENSIONS MFCCs, stored as a blob of little endian floats). Timbre is
+ * searched with indexes held in memory rather than with SQL: An exact / inverted file index (getTimbreIndex()) and an
+ * approximate graph index for large corpora (getTimbreGraph()), which is saved next to the database, and compressed
+ * codes for hosts with little memory (getTimbreCodes()). Each is only built when it is first used.
  */
 class DBConnector {
 public:
@@ -23,23 +40,71 @@ public:
 
     /**
      * Store a vector of grains in the database
-     * @param grains
+     * @param grains Grains with a file id from registerFile()
+     * @param timbre TIMBRE_DIMENSIONS values per grain, one grain after another (may be empty)
      */
-    void insertGrains(vector<Grain>& grains);
+    void insertGrains(vector<Grain>& grains, const vector<float>& timbre = {});
+
+    /**
+     * Get the id of a source audio file, adding it to the file table if it is new
+     * @param path Absolute path to the source audio file
+     * @return The file id
+     */
+    int registerFile(const string& path);
+
+    /**
+     * Get the path of a source audio file
+     * @param fileId A file id of a grain
+     * @return The absolute path, empty for an unknown id. Stays valid as long as the connector.
+     */
+    const string& getFilePath(int fileId);
 
     /**
      * Query the database for the set of grains closest to the input grain.
      * @param grain The input grain
      * @param margin Margin used for db query: This margin is added to the audio feature data in case no grains are found.
-     * @return A vector of the closest matching grains in the database
+     * @param limit Maximum number of grains to return
+     * @param found Receives the closest matching grains in the database (cleared first, reserve limit to avoid allocating)
      */
-    vector<Grain> queryClosestGrain(Grain& grain, float margin);
+    void queryClosestGrain(const Grain& grain, float margin, int limit, vector<Grain>& found);
 
     /**
      * Get a random vector of grains from the database.
-     * @return The random vector of grains.
+     * @param found Receives GRAINS_IN_TRAJECTORY random grains (cleared first)
+     */
+    void queryRandomTrajectory(vector<Grain>& found);
+
+    /**
+     * Get the index over the timbre vectors of the corpus. It is built on first use and again after grains were
+     * inserted, which takes a moment for a large corpus: Call it once before generating in real time.
+     * @return The index, empty if no grain has a timbre vector. Stays valid as long as the caller holds it.
+     */
+    shared_ptr<const TimbreIndex> getTimbreIndex();
+
+    /**
+     * Get the HNSW graph over the timbre vectors of the corpus. It is loaded from the file next to the database, or
+     * built on first use if that file doesn't match the database (which takes minutes for a million grains). Inserted
+     * grains are added to the graph, and the graph is saved when the connector is destroyed.
+     * @return The graph, empty if no grain has a timbre vector
+     */
+    shared_ptr<const HNSWIndex> getTimbreGraph();
+
+    /**
+     * Get the product quantised codes of the timbre vectors of the corpus. Built on first use: Trained on a random
+     * sample and encoded row by row, so the full vectors of the corpus are never loaded. Inserted grains are added if
+     * the codes were trained on a full sample, otherwise the corpus has outgrown the sample and the next call trains
+     * again (like getTimbreIndex(), which is cheap while the corpus is that small).
+     * @return The codes, empty if no grain has a timbre vector
      */
-    vector<Grain> queryRandomTrajectory();
+    shared_ptr<const PQIndex> getTimbreCodes();
+
+    /**
+     * Read grains and their exact timbre vectors by database row, e.g. to re-rank the matches of getTimbreCodes()
+     * @param rows Matches of getTimbreCodes()
+     * @param grains Receives one grain per row, an invalid grain where the row has no timbre vector (cleared first)
+     * @param timbre Receives TIMBRE_DIMENSIONS values per row
+     */
+    void queryTimbreRows(const vector<PQIndex::Neighbour>& rows, vector<Grain>& grains, vector<float>& timbre);
 
     /**
      * Query the maximum value of a given db field (column).
@@ -69,6 +134,12 @@ public:
      */
     float queryStd(const string& field);
 
+    /**
+     * Count the changes to the corpus, e.g. to notice that feature statistics calculated earlier are out of date
+     * @return The number of insertGrains() calls so far (any thread)
+     */
+    uint64_t getRevision() const;
+
     /**
      * Helper method to check whether the database contains any data.
      * @return True if a minimum of 1 grain exists in the database, false otherwise
@@ -88,6 +159,71 @@ private:
 
     // Path to database for disk (currently db is generated in temp dir)
     string DB_PATH = "/tmp/test.db";
+    // Path to the saved timbre graph
+    string TIMBRE_GRAPH_PATH = DB_PATH + ".hnsw";
+
+    /**
+     * Read the grain in the current row of a statement selecting PATH, IDX and the feature columns (in this order).
+     * Call with statementLock held.
+     * @param statement
+     * @return The grain
+     */
+    Grain readGrain(sqlite3_stmt* statement);
+
+    /**
+     * Look up or add a file id. Call with statementLock held.
+     * @param path
+     * @return The file id
+     */
+    int findOrAddFile(string_view path);
+
+    /**
+     * Read every grain that has a timbre vector
+     * @param grains Receives the grains
+     * @param timbre Receives TIMBRE_DIMENSIONS values per grain
+     */
+    void queryTimbre(vector<Grain>& grains, vector<float>& timbre);
+
+    /**
+     * Read the timbre vector in the current row of a statement. Call with statementLock held.
+     * @param statement
+     * @param column Column of the timbre blob
+     * @param timbre Receives TIMBRE_DIMENSIONS values
+     * @return False if the row has no timbre vector of TIMBRE_DIMENSIONS values
+     */
+    bool readTimbre(sqlite3_stmt* statement, int column, float* timbre);
+
+    /**
+     * Identify the grains that have a timbre vector of TIMBRE_DIMENSIONS values, to check a saved graph against
+     * @return Their largest row id and their number
+     */
+    HNSWIndex::CorpusStamp stampTimbre();
+
+    // Prepared statements, guarded by statementLock
+    juce::CriticalSection statementLock;
+    sqlite3_stmt* closestGrainStatement = nullptr;
+    sqlite3_stmt* randomTrajectoryStatement = nullptr;
+    sqlite3_stmt* insertGrainStatement = nullptr;
+    sqlite3_stmt* timbreRowStatement = nullptr;
+
+    // File table, guarded by statementLock: Path per file id (a deque, so paths never move) and file id per path
+    deque<string> filePaths;
+    map<string, int, less<>> fileIds;
+
+    // Index over the timbre vectors, guarded by timbreIndexLock (taken before statementLock). Reset when grains are
+    // inserted; searches that still hold the old index finish on it.
+    juce::CriticalSection timbreIndexLock;
+    shared_ptr<const TimbreIndex> timbreIndex;
+    // Graph over the timbre vectors, guarded by timbreIndexLock. Grows with inserted grains.
+    shared_ptr<HNSWIndex> timbreGraph;
+    bool isTimbreGraphSaved = true;
+    // Compressed timbre codes, guarded by timbreIndexLock. Grow with inserted grains once trained on a full sample.
+    shared_ptr<PQIndex> timbreCodes;
+    // Incremented after every insert
+    std::atomic<uint64_t> revision { 0 };
+
+    // Number of vectors the codes are trained on
+    int timbreTrainingSize = 65536;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DBConnector)
 };
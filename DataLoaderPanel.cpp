@@ -130,8 +130,10 @@ void DataLoaderPanel::loadSingleFile(const File& file){
         }
 
         // Analyse with essentia
-        analyser.analyseAndSaveToDB(*sampleBuffer, file.getFileName().toStdString(),
-                                    file.getFullPathName().toStdString());
+        const int numPruned = analyser.analyseAndSaveToDB(*sampleBuffer, file.getFullPathName().toStdString());
+        if(numPruned > 0){
+            juce::Logger::outputDebugString("      Left out " + to_string(numPruned) + " silent grains.");
+        }
     }
 }
 
@@ -0,0 +1,125 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "FeatureBlob.h"
+
+// Little endian helpers: Floats travel as their IEEE 754 bit pattern
+static void writeUInt16(uint8_t* dest, uint16_t value) {
+    value = ByteOrder::swapIfBigEndian(value);
+    memcpy(dest, &value, sizeof(value));
+}
+
+static void writeUInt32(uint8_t* dest, uint32_t value) {
+    value = ByteOrder::swapIfBigEndian(value);
+    memcpy(dest, &value, sizeof(value));
+}
+
+static void writeFloats(uint8_t* dest, const float* values, size_t numValues) {
+    for(size_t i = 0; i < numValues; i++){
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        writeUInt32(dest + i * sizeof(float), bits);
+    }
+}
+
+MemoryBlock FeatureBlob::encode(const vector<float>& features, int grainLength) {
+    const auto numGrains = static_cast<uint32_t>(features.size() / static_cast<size_t>(NUM_FEATURES));
+    const size_t numValues = numGrains * static_cast<size_t>(NUM_FEATURES);
+
+    MemoryBlock blob (headerSize + numValues * sizeof(float), false);
+    auto* data = static_cast<uint8_t*>(blob.getData());
+    writeUInt16(data, version);
+    writeUInt16(data + 2, static_cast<uint16_t>(NUM_FEATURES));
+    writeUInt32(data + 4, numGrains);
+    writeUInt32(data + 8, static_cast<uint32_t>(jmax(0, grainLength)));
+
+    writeFloats(data + headerSize, features.data(), numValues);
+    return blob;
+}
+
+MemoryBlock FeatureBlob::encodeValues(const vector<float>& values) {
+    MemoryBlock blob (values.size() * sizeof(float), false);
+    writeFloats(static_cast<uint8_t*>(blob.getData()), values.data(), values.size());
+    return blob;
+}
+
+bool FeatureBlob::decode(const MemoryBlock& blob, vector<float>& features, int& grainLength) {
+    if(blob.getSize() < headerSize){
+        return false;
+    }
+    const auto* data = static_cast<const uint8_t*>(blob.getData());
+    const uint16_t blobVersion = ByteOrder::littleEndianShort(data);
+    const uint16_t numFeatures = ByteOrder::littleEndianShort(data + 2);
+    const uint32_t numGrains = ByteOrder::littleEndianInt(data + 4);
+    const uint32_t blobGrainLength = ByteOrder::littleEndianInt(data + 8);
+
+    const size_t numValues = static_cast<size_t>(numGrains) * numFeatures;
+    if(blobVersion != version || numFeatures != NUM_FEATURES || blob.getSize() != headerSize + numValues * sizeof(float)){
+        return false;
+    }
+
+    features.resize(numValues);
+    const uint8_t* values = data + headerSize;
+    for(size_t i = 0; i < numValues; i++){
+        const uint32_t bits = ByteOrder::littleEndianInt(values + i * sizeof(float));
+        memcpy(&features[i], &bits, sizeof(bits));
+    }
+    if(blobGrainLength > 0){
+        grainLength = static_cast<int>(blobGrainLength);
+    }
+    return true;
+}
+
+FeatureBlob::Format FeatureBlob::read(const OSCMessage& message, vector<float>& features, int& grainLength) {
+    if(!message.isEmpty() && message[0].isBlob()){
+        if((message.size() == 1 || (message.size() == 2 && message[1].isInt32()))
+           && decode(message[0].getBlob(), features, grainLength)){
+            return Format::blob;
+        }
+        features.clear();
+        return Format::malformed;
+    }
+
+    // Fallback: One argument per value. An int before the first float is the grain length, an int after the last
+    // float the request id
+    features.clear();
+    features.reserve(static_cast<size_t>(message.size()));
+    int messageGrainLength = grainLength;
+    for(int i = 0; i < message.size(); i++){
+        const OSCArgument& element = message[i];
+        if(element.isFloat32()){
+            features.emplace_back(element.getFloat32());
+        } else if(element.isInt32() && features.empty()){
+            messageGrainLength = element.getInt32();
+        } else if(!(element.isInt32() && i == message.size() - 1)){
+            features.clear();
+            return Format::malformed;
+        }
+    }
+    if(features.size() % static_cast<size_t>(NUM_FEATURES) != 0 || messageGrainLength < 1){
+        features.clear();
+        return Format::malformed;
+    }
+    grainLength = messageGrainLength;
+    return Format::arguments;
+}
+
+int FeatureBlob::readRequestId(const OSCMessage& message) {
+    const int size = message.size();
+    if(size < 2 || !message[size - 1].isInt32() || !(message[size - 2].isBlob() || message[size - 2].isFloat32())){
+        return -1;
+    }
+    return message[size - 1].getInt32();
+}
+
+void FeatureBlob::write(OSCMessage& message, const vector<float>& features, bool asBlob) {
+    if(asBlob){
+        message.addBlob(encode(features));
+        return;
+    }
+    // Each attribute of each grain is one message argument
+    for(auto& entry : features){
+        message.addFloat32(entry);
+    }
+}
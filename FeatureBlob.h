@@ -0,0 +1,93 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_FEATUREBLOB_H
+#define DMLAP_BACKEND_FEATUREBLOB_H
+
+#include <cstdint>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Packed binary format for grain feature vectors (e.g. "/params" and "/prime_trajectory"), sent as a single OSC blob
+ * instead of one float argument per feature. This halves the packet size and avoids parsing a type tag per value.
+ *
+ * Layout (all values little endian):
+ *   uint16  version       (currently 1)
+ *   uint16  numFeatures   (features per grain, must be NUM_FEATURES)
+ *   uint32  numGrains
+ *   uint32  grainLength   (grain length in samples, 0 for the default)
+ *   float32 features[numGrains * numFeatures]
+ *
+ * The per-argument format (optional int32 grain length followed by float32 features) is still accepted everywhere.
+ * In both formats the features may be followed by an int32 request id, which the backend echoes in its reply so the
+ * agent can tell a late reply to an earlier request from the reply to its current one.
+ */
+class FeatureBlob {
+public:
+    // How a message carried its feature values
+    enum class Format { arguments, blob, malformed };
+
+    static constexpr uint16_t version = 1;
+    static constexpr size_t headerSize = 12;
+
+    /**
+     * Pack feature values into a blob
+     * @param features NUM_FEATURES values per grain
+     * @param grainLength Grain length in samples, 0 for the default
+     * @return The blob
+     */
+    static MemoryBlock encode(const vector<float>& features, int grainLength = 0);
+
+    /**
+     * Pack arbitrary values as a plain array of little endian float32, without a header (e.g. per-grain distances)
+     * @param values
+     * @return The blob
+     */
+    static MemoryBlock encodeValues(const vector<float>& values);
+
+    /**
+     * Unpack a blob
+     * @param blob
+     * @param features Receives the feature values
+     * @param grainLength Receives the grain length, left untouched if the blob uses the default
+     * @return False if the blob is malformed or of an unsupported version
+     */
+    static bool decode(const MemoryBlock& blob, vector<float>& features, int& grainLength);
+
+    /**
+     * Read feature values from a message in either format: A single blob, or per-argument floats with an optional
+     * int32 grain length, each optionally followed by an int32 request id (see readRequestId). A blob that does not
+     * decode, a float count that is not a multiple of NUM_FEATURES, a grain length below 1 or an argument of any other
+     * type make the message malformed, and leave features empty.
+     * @param message
+     * @param features Receives the feature values
+     * @param grainLength Receives the grain length if the message contains one
+     * @return The format of the message, or malformed
+     */
+    static Format read(const OSCMessage& message, vector<float>& features, int& grainLength);
+
+    /**
+     * The request id following the features of a message in either format
+     * @param message
+     * @return The request id, or -1 if the message has none
+     */
+    static int readRequestId(const OSCMessage& message);
+
+    /**
+     * Append feature values to a message, either as a single blob or as one float argument per value
+     * @param message
+     * @param features
+     * @param asBlob
+     */
+    static void write(OSCMessage& message, const vector<float>& features, bool asBlob);
+};
+
+
+#endif //DMLAP_BACKEND_FEATUREBLOB_H
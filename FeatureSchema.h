@@ -0,0 +1,68 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_FEATURESCHEMA_H
+#define DMLAP_BACKEND_FEATURESCHEMA_H
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+/**
+ * The audio features of a grain in one place. The order of the descriptors is the order of the features everywhere:
+ * In grain records, database columns, RL parameters and distance weights. Storage, SQL, statistics, the RL mapping
+ * and the distance kernel are generated from this list, so adding a feature means adding a descriptor and an index
+ * here and computing it in the Analyser. The order must be the same in the python agent.
+ */
+namespace FeatureSchema {
+
+struct Descriptor {
+    // Database column
+    const char* column;
+    // Weight in the target distance
+    float weight;
+    // Closest grain query: The target plus/minus the query margin times this scale
+    float marginScale;
+    // RL parameter that is mapped to the maximum of the feature in the database when matching. Values above 1
+    // compress the parameters into the lower part of the range.
+    float parameterMax;
+};
+
+// Index of each feature in the per-grain arrays
+enum Feature { loudness, spectralCentroid, spectralFlux, pitch };
+
+inline constexpr Descriptor descriptors[] = {
+    //  column                weight  marginScale  parameterMax
+    { "LOUDNESS",             1.0f,   0.1f,        1.0f },
+    { "SPECTRAL_CENTROID",    2.0f,   5.0f,        1.0f },
+    { "SPECTRAL_FLUX",        1.0f,   0.0001f,     1.0f },
+    // Pitch (in Hz): Parameters only cover the lower quarter of the range
+    { "PITCH",                3.0f,   1.0f,        4.0f },
+};
+
+inline constexpr int numFeatures = static_cast<int>(std::size(descriptors));
+static_assert(pitch + 1 == numFeatures, "Every descriptor needs an index");
+
+// Candidates of the closest grain query are sorted by their distance to the target in this feature
+inline constexpr Feature sortFeature = spectralCentroid;
+
+template <size_t... I>
+inline float weightedDistance(const float* a, const float* b, const float* scale, std::index_sequence<I...>) {
+    return (0.0f + ... + (descriptors[I].weight * ((a[I] - b[I]) * scale[I]) * ((a[I] - b[I]) * scale[I])));
+}
+
+/**
+ * Weighted squared euclidean distance, fully unrolled for the number of features
+ * @param a Features of the first grain
+ * @param b Features of the second grain
+ * @param scale Per feature factor normalising the difference (e.g. 1 / max in the database)
+ * @return The sum of weight * ((a - b) * scale)^2 over all features
+ */
+inline float weightedDistance(const float* a, const float* b, const float* scale) {
+    return weightedDistance(a, b, scale, std::make_index_sequence<numFeatures>());
+}
+
+}
+
+#endif //DMLAP_BACKEND_FEATURESCHEMA_H
@@ -3,55 +3,39 @@
 //
 
 #include "Grain.h"
+#include <algorithm>
+#include "Constants.h"
 
-#include <utility>
+Grain::Grain(int fileId, int idx, const float* features):
+    fileId(fileId),
+    idx(idx)
+    {
+        copy(features, features + FeatureSchema::numFeatures, Grain::features);
+    }
 
-Grain::Grain(string name,
-             string path,
-             int idx,
-             float loudness,
-             float spectralCentroid,
-             float spectralFlux,
-             float pitch
-             ):
-    name(std::move(name)),
-    path(std::move(path)),
-    idx(idx),
-    loudness(loudness),
-    spectralCentroid(spectralCentroid),
-    spectralFlux(spectralFlux),
-    pitch(pitch)
-    {}
-
-Grain::Grain(float loudness,
-             float spectralCentroid,
-             float spectralFlux,
-             float pitch
-             ):
-             loudness(loudness),
-             spectralCentroid(spectralCentroid),
-             spectralFlux(spectralFlux),
-             pitch(pitch)
-             {}
+Grain::Grain(const float* features)
+    {
+        copy(features, features + FeatureSchema::numFeatures, Grain::features);
+    }
 
 Grain::Grain() {
 
 }
 
-const string &Grain::getName() const {
-    return name;
+bool Grain::isValid() const {
+    return fileId >= 0;
 }
 
-void Grain::setName(const string &name) {
-    Grain::name = name;
+bool Grain::continues(const Grain& previous, int grainLength) const {
+    return isValid() && fileId == previous.fileId && idx == previous.idx + grainLength;
 }
 
-const string &Grain::getPath() const {
-    return path;
+int Grain::getFileId() const {
+    return fileId;
 }
 
-void Grain::setPath(const string &path) {
-    Grain::path = path;
+void Grain::setFileId(int fileId) {
+    Grain::fileId = fileId;
 }
 
 int Grain::getIdx() const {
@@ -62,34 +46,14 @@ void Grain::setIdx(int idx) {
     Grain::idx = idx;
 }
 
-float Grain::getSpectralCentroid() const {
-    return spectralCentroid;
-}
-
-void Grain::setSpectralCentroid(float spectralCentroid) {
-    Grain::spectralCentroid = spectralCentroid;
-}
-
-float Grain::getLoudness() const {
-    return loudness;
-}
-
-void Grain::setLoudness(float loudness) {
-    Grain::loudness = loudness;
-}
-
-float Grain::getSpectralFlux() const {
-    return spectralFlux;
-}
-
-void Grain::setSpectralFlux(float sf) {
-    Grain::spectralFlux = sf;
+float Grain::getFeature(FeatureSchema::Feature feature) const {
+    return features[feature];
 }
 
-float Grain::getPitch() const {
-    return pitch;
+void Grain::setFeature(FeatureSchema::Feature feature, float value) {
+    features[feature] = value;
 }
 
-void Grain::setPitch(float pitch) {
-    Grain::pitch = pitch;
+const float* Grain::getFeatures() const {
+    return features;
 }
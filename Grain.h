@@ -6,80 +6,80 @@
 #define DMLAP_BACKEND_GRAIN_H
 #include <stdio.h>
 #include <stdlib.h>
-#include <string>
+#include <cstdint>
+#include <type_traits>
+#include "FeatureSchema.h"
 
 using namespace std;
 
 /**
  * Representation of a grain object.
- * In this systems grains are comprised of a path to the source audio file, a start index (of the audio data), and the
- * grain length defined in "Constants.h". The audio data of a grain is given by this triplet. In addition to this,
- * a grain also contains the values of the audio features computed in "Analyser.h".
+ * In this systems grains are comprised of a source audio file, a start index (of the audio data), and the grain length
+ * defined in "Constants.h". The audio data of a grain is given by this triplet. In addition to this, a grain also
+ * contains the values of the audio features computed in "Analyser.h".
+ * The source file is stored as an id into the file table of "DBConnector.h" (see DBConnector::getFilePath), which keeps
+ * a grain small (24 bytes with four features) and trivially copyable: Trajectories are plain arrays that are copied
+ * without any allocation. The features are stored in the order of "FeatureSchema.h".
  */
 class Grain {
 public:
     Grain();
 
-    Grain(string name,
-          string path,
-          int idx,
-          float loudness,
-          float spectralCentroid,
-          float spectralFlux,
-          float pitch
-          );
-    Grain(float loudness,
-          float spectralCentroid,
-          float spectralFlux,
-          float pitch);
+    /**
+     * @param fileId
+     * @param idx
+     * @param features FeatureSchema::numFeatures values
+     */
+    Grain(int fileId, int idx, const float* features);
+
+    /**
+     * A grain that is not in the corpus, e.g. a search target
+     * @param features FeatureSchema::numFeatures values
+     */
+    explicit Grain(const float* features);
 
 private:
-    // The name of the grain (composed of the path of the source audio file and a number)
-    string name;
-    // Absolute path to the source audio file
-    string path;
+    // Id of the source audio file (-1 for grains that don't come from the database)
+    int32_t fileId = -1;
     // Start index of the grain
-    int idx = -1;
-    // Loudness of the grain
-    float loudness = 0.0f;
-    // Spectral centroid ("brightness") of the grain
-    float spectralCentroid = 0.0f;
-    // Spectral flux of the grain
-    float spectralFlux = 0.0f;
-    // Pitch of the grain (in Hz)
-    float pitch = 0.0f;
+    int32_t idx = -1;
+    // Audio features of the grain, indexed by FeatureSchema::Feature
+    float features[FeatureSchema::numFeatures] = {};
 
 public:
 
-    const string &getName() const;
+    /**
+     * Whether the grain refers to audio in the corpus (as opposed to a search target or an empty match)
+     * @return True if the grain has a source file
+     */
+    bool isValid() const;
 
-    void setName(const string &name);
+    /**
+     * Whether this grain starts where "previous" ends in the same source file, so the two join without a seam
+     * @param previous
+     * @param grainLength Length of the rendered grains in samples
+     * @return True if the audio is contiguous
+     */
+    bool continues(const Grain& previous, int grainLength) const;
 
-    const string &getPath() const;
+    int getFileId() const;
 
-    void setPath(const string &path);
+    void setFileId(int fileId);
 
     int getIdx() const;
 
     void setIdx(int idx);
 
-    float getLoudness() const;
-
-    void setLoudness(float loudness);
-
-    float getSpectralCentroid() const;
-
-    void setSpectralCentroid(float spectralCentroid);
+    float getFeature(FeatureSchema::Feature feature) const;
 
-    float getSpectralFlux() const;
+    void setFeature(FeatureSchema::Feature feature, float value);
 
-    void setSpectralFlux(float sf);
-
-    float getPitch() const;
-
-    void setPitch(float pitch);
+    const float* getFeatures() const;
 
 };
 
+static_assert(sizeof(Grain) == 2 * sizeof(int32_t) + FeatureSchema::numFeatures * sizeof(float), "A grain is a packed record");
+static_assert(is_trivially_copyable<Grain>::value, "Grains are copied as plain memory");
+
 
 #endif //DMLAP_BACKEND_GRAIN_H
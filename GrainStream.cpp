@@ -0,0 +1,183 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "GrainStream.h"
+
+GrainStream::GrainStream(Traverser& traverser, int numChannels)
+: Thread("Grain stream"),
+  traverser(traverser),
+  audioFifo((lookaheadGrains + 1) * SUPPORTED_GRAIN_LENGTHS[NUM_SUPPORTED_GRAIN_LENGTHS - 1]) {
+    // Everything is allocated once, streaming itself never allocates
+    targetData.resize(static_cast<size_t>(targetCapacity * NUM_FEATURES));
+    currentTarget.assign(static_cast<size_t>(NUM_FEATURES), 0.5f);
+    ring.setSize(numChannels, audioFifo.getTotalSize());
+    ring.clear();
+    grainBuffer.setSize(numChannels, SUPPORTED_GRAIN_LENGTHS[NUM_SUPPORTED_GRAIN_LENGTHS - 1]);
+    grainBuffer.clear();
+}
+
+GrainStream::~GrainStream() {
+    stop();
+}
+
+void GrainStream::start(int length) {
+    stop();
+
+    // The render thread is stopped, so the target queue can be reset from here. The audio ring belongs to the audio
+    // thread: It drops what is left of the previous stream itself, before anything new is rendered.
+    flushRing = true;
+    targetFifo.reset();
+    grainLength = nearestSupportedGrainLength(length);
+    currentTarget.assign(static_cast<size_t>(NUM_FEATURES), 0.5f);
+    previousGrain = Grain();
+    numUnderruns = 0;
+    hasStartedPlaying = false;
+
+    active = true;
+    startThread();
+}
+
+void GrainStream::stop() {
+    active = false;
+    stopThread(4000);
+}
+
+bool GrainStream::isActive() const {
+    return active;
+}
+
+bool GrainStream::pushTarget(const float* params) {
+    if(targetFifo.getFreeSpace() < 1){
+        return false;
+    }
+    int start1, size1, start2, size2;
+    targetFifo.prepareToWrite(1, start1, size1, start2, size2);
+    std::copy(params, params + NUM_FEATURES, targetData.begin() + start1 * NUM_FEATURES);
+    targetFifo.finishedWrite(1);
+    return true;
+}
+
+bool GrainStream::popTarget(float* params) {
+    if(targetFifo.getNumReady() < 1){
+        return false;
+    }
+    int start1, size1, start2, size2;
+    targetFifo.prepareToRead(1, start1, size1, start2, size2);
+    std::copy(targetData.begin() + start1 * NUM_FEATURES, targetData.begin() + (start1 + 1) * NUM_FEATURES, params);
+    targetFifo.finishedRead(1);
+    return true;
+}
+
+void GrainStream::generateLocalTarget(float* params) {
+    for(int i = 0; i < NUM_FEATURES; i++){
+        float step = (random.nextFloat() * 2.0f - 1.0f) * randomWalkStep;
+        params[i] = jlimit(0.0f, 1.0f, currentTarget[i] + step);
+    }
+}
+
+void GrainStream::writeToRing(int numSamples) {
+    int start1, size1, start2, size2;
+    audioFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    for(int channel = 0; channel < ring.getNumChannels(); channel++){
+        if(size1 > 0){
+            ring.copyFrom(channel, start1, grainBuffer, channel, 0, size1);
+        }
+        if(size2 > 0){
+            ring.copyFrom(channel, start2, grainBuffer, channel, size1, size2);
+        }
+    }
+    audioFifo.finishedWrite(size1 + size2);
+}
+
+void GrainStream::run() {
+    vector<float> target(static_cast<size_t>(NUM_FEATURES));
+    while(!threadShouldExit()){
+        // Stay a few grains ahead of playback, but not further. Nothing is written until the audio thread dropped the
+        // previous stream, otherwise the new grains would be dropped with it.
+        if(flushRing || audioFifo.getNumReady() >= lookaheadGrains * grainLength || audioFifo.getFreeSpace() < grainLength){
+            wait(2);
+            continue;
+        }
+
+        if(!popTarget(target.data())){
+            generateLocalTarget(target.data());
+        }
+        currentTarget = target;
+
+        if(!traverser.renderStreamGrain(target.data(), grainLength, grainBuffer, previousGrain)){
+            // Nothing in the database to stream from
+            wait(50);
+            continue;
+        }
+        writeToRing(grainLength);
+    }
+}
+
+bool GrainStream::read(AudioBuffer<float>& buffer, int startSample, int numSamples) {
+    const bool isRestarted = flushRing;
+    if(!active || isRestarted){
+        // Drop whatever is left of a stopped stream, also when it was restarted before this thread got to see it stop
+        int numLeft = audioFifo.getNumReady();
+        if(numLeft > 0){
+            audioFifo.finishedRead(numLeft);
+        }
+        if(isRestarted){
+            flushRing = false;
+        }
+        return false;
+    }
+
+    int start1, size1, start2, size2;
+    audioFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    for(int channel = 0; channel < buffer.getNumChannels() && channel < ring.getNumChannels(); channel++){
+        if(size1 > 0){
+            buffer.copyFrom(channel, startSample, ring, channel, start1, size1);
+        }
+        if(size2 > 0){
+            buffer.copyFrom(channel, startSample + size1, ring, channel, start2, size2);
+        }
+    }
+    int numRead = size1 + size2;
+    audioFifo.finishedRead(numRead);
+
+    if(numRead > 0){
+        hasStartedPlaying = true;
+    }
+    if(numRead < numSamples){
+        buffer.clear(startSample + numRead, numSamples - numRead);
+        if(hasStartedPlaying){
+            numUnderruns++;
+        }
+    }
+    return true;
+}
+
+int GrainStream::getNumUnderruns() const {
+    return numUnderruns;
+}
+
+void GrainStream::registerOSCHandlers(OSCDispatcher& dispatcher) {
+    using Context = OSCDispatcher::Context;
+    dispatcher.addHandler("/stream", Context::messageThread, [this] (const OSCMessage& message) {
+        if(message.isEmpty()){
+            return;
+        }
+        if(message[0].getInt32() != 0){
+            start(message.size() > 1 ? message[1].getInt32() : GRAIN_LENGTH);
+        } else {
+            stop();
+        }
+    });
+    dispatcher.addHandler("/stream_params", Context::messageThread, [this] (const OSCMessage& message) {
+        int grainLength = GRAIN_LENGTH;
+        vector<float> params;
+        if(FeatureBlob::read(message, params, grainLength) == FeatureBlob::Format::malformed){
+            fprintf(stderr, "Malformed stream parameters\n");
+            return;
+        }
+        for(size_t i = 0; i + NUM_FEATURES <= params.size(); i += NUM_FEATURES){
+            pushTarget(&params[i]);
+        }
+    });
+}
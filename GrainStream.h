@@ -0,0 +1,141 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_GRAINSTREAM_H
+#define DMLAP_BACKEND_GRAINSTREAM_H
+
+#include <atomic>
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "Traverser.h"
+#include "Grain.h"
+#include "FeatureBlob.h"
+#include "OSCDispatcher.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Streaming ("infinite trajectory") mode: Instead of rendering a whole trajectory and looping it, grain targets are
+ * streamed in one at a time and each one is matched and rendered just in time, a few grains ahead of playback.
+ * Targets come from the agent (via pushTarget) or, whenever the agent has not sent anything, from a local random walk
+ * continuing the last target. Rendered grains go into a lock-free ring buffer that the audio thread reads from, so
+ * memory use is constant no matter how long the stream runs and the first grain is audible after one grain's latency.
+ */
+class GrainStream : private Thread {
+public:
+    GrainStream(Traverser& traverser, int numChannels);
+    ~GrainStream() override;
+
+    /**
+     * Start streaming (message thread). Restarts the stream if it is already running.
+     * @param grainLength Length of the streamed grains in samples, snapped to the closest supported grain length
+     */
+    void start(int grainLength = GRAIN_LENGTH);
+
+    /**
+     * Stop streaming (message thread)
+     */
+    void stop();
+
+    /**
+     * Check whether the stream is running
+     * @return True while streaming
+     */
+    bool isActive() const;
+
+    /**
+     * Queue the target of the next grain (message thread)
+     * @param params NUM_FEATURES parameters in the same layout and range as "/params"
+     * @return False if the target queue is full
+     */
+    bool pushTarget(const float* params);
+
+    /**
+     * Audio thread: Read the next block of the stream. Missing samples (underrun) are filled with silence.
+     * Called for every block while the playback engine is streaming. What is left of a previous stream is discarded by
+     * the first read after a restart (which returns false), so the engine can leave streaming without draining the ring.
+     * @param buffer The output buffer
+     * @param startSample Start index in the output buffer
+     * @param numSamples Number of samples to read
+     * @return True if the stream is active and the block was filled, false if the buffer was left untouched
+     */
+    bool read(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    /**
+     * Number of blocks that could not be filled completely since the stream was started
+     * @return The number of underruns
+     */
+    int getNumUnderruns() const;
+
+    /**
+     * Register the OSC handlers controlling this stream (message thread), before the dispatcher connects:
+     *   "/stream" int32 on [int32 grainLength]: Start (1) or stop (0) streaming
+     *   "/stream_params" features: Targets of the next grains, NUM_FEATURES floats per grain or a feature blob
+     * @param dispatcher
+     */
+    void registerOSCHandlers(OSCDispatcher& dispatcher);
+
+private:
+    void run() override;
+
+    /**
+     * Take the next agent target out of the queue (render thread)
+     * @param params Receives NUM_FEATURES parameters
+     * @return True if there was a target
+     */
+    bool popTarget(float* params);
+
+    /**
+     * Local generator: Random walk step from the last target (render thread)
+     * @param params Receives NUM_FEATURES parameters
+     */
+    void generateLocalTarget(float* params);
+
+    /**
+     * Append a rendered grain to the ring buffer (render thread)
+     * @param numSamples Number of samples of grainBuffer to write
+     */
+    void writeToRing(int numSamples);
+
+    // Ref to traverser
+    Traverser& traverser;
+
+    // Number of grains rendered ahead of playback
+    static constexpr int lookaheadGrains = 3;
+    // Capacity of the target queue in grains
+    static constexpr int targetCapacity = 256;
+    // Maximum step of the local random walk per grain (in parameter space)
+    float randomWalkStep = 0.05f;
+
+    // Target queue: Single producer (message thread), single consumer (render thread)
+    AbstractFifo targetFifo { targetCapacity };
+    vector<float> targetData;
+
+    // Audio ring buffer: Single producer (render thread), single consumer (audio thread)
+    AbstractFifo audioFifo;
+    AudioBuffer<float> ring;
+    // Scratch buffer for rendering a single grain
+    AudioBuffer<float> grainBuffer;
+
+    // Render thread state
+    vector<float> currentTarget;
+    Grain previousGrain;
+    Random random;
+    int grainLength = GRAIN_LENGTH;
+
+    atomic<bool> active { false };
+    // Set by start() until the audio thread has dropped the audio of the previous stream from the ring
+    atomic<bool> flushRing { false };
+    // Set once the first grain was played, underruns before that are just the startup latency
+    atomic<bool> hasStartedPlaying { false };
+    atomic<int> numUnderruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrainStream)
+};
+
+
+#endif //DMLAP_BACKEND_GRAINSTREAM_H
@@ -0,0 +1,100 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "GrainVoicePool.h"
+
+GrainVoicePool::GrainVoicePool(int numVoices) {
+    voices.resize(static_cast<size_t>(numVoices));
+    envelope.resize(envelopeChunkSize);
+}
+
+bool GrainVoicePool::startVoice(const float* left, const float* right, int length, float gain, int delay, bool isWindowed) {
+    if(numActiveVoices == static_cast<int>(voices.size()) || length < 2){
+        numDroppedGrains++;
+        return false;
+    }
+    Voice& voice = voices[static_cast<size_t>(numActiveVoices++)];
+    voice.source[0] = left;
+    voice.source[1] = right;
+    voice.length = length;
+    voice.position = -delay;
+    voice.gain = gain;
+    // Hann window: w[n] = sin^2(pi * n / (length - 1)), the sine is advanced by rotating (sin, cos) once per sample.
+    // A windowed source gets a constant 1 instead: The oscillator starts at sin = 1 and doesn't rotate.
+    const double phaseIncrement = isWindowed ? 0.0 : MathConstants<double>::pi / (length - 1);
+    voice.windowSin = isWindowed ? 1.0f : 0.0f;
+    voice.windowCos = isWindowed ? 0.0f : 1.0f;
+    voice.rotationSin = static_cast<float>(std::sin(phaseIncrement));
+    voice.rotationCos = static_cast<float>(std::cos(phaseIncrement));
+    voice.release = 1.0f;
+    voice.releaseStep = 0.0f;
+    return true;
+}
+
+void GrainVoicePool::render(AudioBuffer<float>& output, int startSample, int numSamples) {
+    int i = 0;
+    while(i < numActiveVoices){
+        if(renderVoice(voices[static_cast<size_t>(i)], output, startSample, numSamples)){
+            i++;
+        } else {
+            // Swap the finished voice out of the active range, the swapped in voice is rendered next
+            std::swap(voices[static_cast<size_t>(i)], voices[static_cast<size_t>(--numActiveVoices)]);
+        }
+    }
+}
+
+bool GrainVoicePool::renderVoice(Voice& voice, AudioBuffer<float>& output, int startSample, int numSamples) {
+    // Skip the part of the block before the onset
+    int outputIdx = 0;
+    if(voice.position < 0){
+        outputIdx = jmin(-voice.position, numSamples);
+        voice.position += outputIdx;
+    }
+
+    while(outputIdx < numSamples && voice.position < voice.length && voice.release > 0.0f){
+        const int chunk = jmin(envelopeChunkSize, numSamples - outputIdx, voice.length - voice.position);
+
+        // Window (and fade out) for this chunk. This is a recurrence, the mixing below is vectorised.
+        float s = voice.windowSin;
+        float c = voice.windowCos;
+        float release = voice.release;
+        for(int n = 0; n < chunk; n++){
+            envelope[static_cast<size_t>(n)] = voice.gain * release * s * s;
+            const float nextSin = s * voice.rotationCos + c * voice.rotationSin;
+            c = c * voice.rotationCos - s * voice.rotationSin;
+            s = nextSin;
+            release = jmax(0.0f, release - voice.releaseStep);
+        }
+        voice.windowSin = s;
+        voice.windowCos = c;
+        voice.release = release;
+
+        FloatVectorOperations::addWithMultiply(output.getWritePointer(0, startSample + outputIdx),
+                                               voice.source[0] + voice.position, envelope.data(), chunk);
+        FloatVectorOperations::addWithMultiply(output.getWritePointer(1, startSample + outputIdx),
+                                               voice.source[1] + voice.position, envelope.data(), chunk);
+        voice.position += chunk;
+        outputIdx += chunk;
+    }
+    return voice.position < voice.length && voice.release > 0.0f;
+}
+
+void GrainVoicePool::releaseAll(int fadeSamples) {
+    for(int i = 0; i < numActiveVoices; i++){
+        Voice& voice = voices[static_cast<size_t>(i)];
+        if(voice.position < 0){
+            // Not audible yet, just drop it
+            voice.release = 0.0f;
+        }
+        voice.releaseStep = jmax(voice.releaseStep, 1.0f / static_cast<float>(jmax(1, fadeSamples)));
+    }
+}
+
+int GrainVoicePool::getNumActiveVoices() const {
+    return numActiveVoices;
+}
+
+int GrainVoicePool::getNumDroppedGrains() const {
+    return numDroppedGrains;
+}
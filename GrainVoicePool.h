@@ -0,0 +1,106 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_GRAINVOICEPOOL_H
+#define DMLAP_BACKEND_GRAINVOICEPOOL_H
+
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Fixed-size pool of grain voices for the audio thread.
+ * Each voice plays one grain straight out of a source buffer and shapes it with a Hann window that is computed on the
+ * fly (a recursive sine oscillator, so grains of any length can be windowed without tables), unless the grain in the
+ * source is windowed already, as in rendered trajectories. Voices may start at any
+ * sample within a block and overlap freely. Mixing is done with FloatVectorOperations, one multiply-add per voice and
+ * channel over the whole block. All memory is allocated up front, starting, rendering and releasing voices never
+ * allocates or locks.
+ */
+class GrainVoicePool {
+public:
+    /**
+     * @param numVoices Maximum number of simultaneously playing grains
+     */
+    explicit GrainVoicePool(int numVoices);
+
+    /**
+     * Audio thread: Start a new grain. If all voices are busy the grain is dropped.
+     * @param left Start of the grain in the left channel of the source. Must stay valid while the grain plays.
+     * @param right Start of the grain in the right channel of the source
+     * @param length Length of the grain in samples
+     * @param gain Peak gain of the grain
+     * @param delay Offset of the grain onset from the start of the next rendered block, in samples
+     * @param isWindowed True if the grain in the source is windowed already: The voice only applies gain and release
+     * @return False if the grain was dropped
+     */
+    bool startVoice(const float* left, const float* right, int length, float gain, int delay, bool isWindowed = false);
+
+    /**
+     * Audio thread: Mix all playing grains into the output (added to what is already there)
+     * @param output The output buffer, must have at least two channels
+     * @param startSample Start index in the output buffer
+     * @param numSamples Number of samples to render
+     */
+    void render(AudioBuffer<float>& output, int startSample, int numSamples);
+
+    /**
+     * Audio thread: Fade out all playing grains over the given number of samples, e.g. before their source is reused
+     * @param fadeSamples Length of the fade out
+     */
+    void releaseAll(int fadeSamples);
+
+    /**
+     * Audio thread: Number of grains currently playing
+     * @return The number of active voices
+     */
+    int getNumActiveVoices() const;
+
+    /**
+     * Audio thread: Number of grains dropped since construction because all voices were busy
+     * @return The number of dropped grains
+     */
+    int getNumDroppedGrains() const;
+
+private:
+    struct Voice {
+        // Source channels, already offset to the start of the grain
+        const float* source[2] = { nullptr, nullptr };
+        int length = 0;
+        // Read position within the grain, negative while waiting for the onset
+        int position = 0;
+        float gain = 1.0f;
+        // Window oscillator: sin and cos of the current window phase and the rotation per sample
+        float windowSin = 0.0f;
+        float windowCos = 1.0f;
+        float rotationSin = 0.0f;
+        float rotationCos = 1.0f;
+        // Linear fade out applied on top of the window after releaseAll()
+        float release = 1.0f;
+        float releaseStep = 0.0f;
+    };
+
+    /**
+     * Render a single voice into the output
+     * @return False if the voice has finished
+     */
+    bool renderVoice(Voice& voice, AudioBuffer<float>& output, int startSample, int numSamples);
+
+    // All voices, the first numActiveVoices ones are playing. Finished voices are swapped to the end so that rendering
+    // only ever walks a dense array.
+    vector<Voice> voices;
+    int numActiveVoices = 0;
+    int numDroppedGrains = 0;
+
+    // Scratch buffer holding the envelope of one voice for one chunk of the block
+    static constexpr int envelopeChunkSize = 256;
+    vector<float> envelope;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrainVoicePool)
+};
+
+
+#endif //DMLAP_BACKEND_GRAINVOICEPOOL_H
@@ -0,0 +1,448 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "HNSWIndex.h"
+#include "VectorKernels.h"
+#include "Constants.h"
+#include <cmath>
+#include <map>
+
+namespace {
+
+// File format (version 2 added the corpus stamp)
+constexpr int fileMagic = 0x57534e48; // "HNSW"
+constexpr int fileVersion = 2;
+
+// Highest layer of a node: Reached with a probability of M^-64, so it only bounds what a file may contain
+constexpr int maxNodeLevel = 64;
+// Largest M and efConstruction accepted from a file
+constexpr int maxFileLinks = 1024;
+constexpr int maxFileEfConstruction = 65536;
+
+// Max-heap order: The furthest node on top
+bool isCloser(const HNSWIndex::Neighbour& a, const HNSWIndex::Neighbour& b) {
+    return a.distance < b.distance;
+}
+
+// Min-heap order: The closest node on top
+bool isFurther(const HNSWIndex::Neighbour& a, const HNSWIndex::Neighbour& b) {
+    return a.distance > b.distance;
+}
+
+}
+
+HNSWIndex::HNSWIndex(int dimensions, Metric metric, int M, int efConstruction)
+    : dimensions(dimensions), metric(metric), maxLinks(jmax(2, M)), maxBaseLinks(2 * jmax(2, M)),
+      efConstruction(jmax(efConstruction, M)), levelMultiplier(1.0 / std::log(static_cast<double>(jmax(2, M)))) {
+    insertScratch.query.resize(static_cast<size_t>(dimensions));
+}
+
+float HNSWIndex::distance(const float* a, const float* b) const {
+    if(metric == Metric::l2){
+        return VectorKernels::squaredL2(a, b, dimensions);
+    }
+    return 1.0f - VectorKernels::dot(a, b, dimensions);
+}
+
+const float* HNSWIndex::getVector(int node) const {
+    return vectors.data() + static_cast<long>(node) * dimensions;
+}
+
+int* HNSWIndex::getLinks(int node, int level) {
+    if(level == 0){
+        return baseLinks.data() + static_cast<long>(node) * (1 + maxBaseLinks);
+    }
+    return upperLinks[static_cast<size_t>(node)].data() + (level - 1) * (1 + maxLinks);
+}
+
+const int* HNSWIndex::getLinks(int node, int level) const {
+    return const_cast<HNSWIndex*>(this)->getLinks(node, level);
+}
+
+const float* HNSWIndex::prepareQuery(const float* query, SearchScratch& scratch) const {
+    if(metric == Metric::l2){
+        return query;
+    }
+    scratch.query.assign(query, query + dimensions);
+    const float norm = std::sqrt(VectorKernels::dot(query, query, dimensions));
+    if(norm > 0.0f){
+        for(float& value : scratch.query){
+            value /= norm;
+        }
+    }
+    return scratch.query.data();
+}
+
+void HNSWIndex::add(const Grain& grain, const float* vector) {
+    const ScopedWriteLock sl (lock);
+
+    // Store the node, normalised for the cosine metric
+    const int node = static_cast<int>(grains.size());
+    const float* prepared = prepareQuery(vector, insertScratch);
+    vectors.insert(vectors.end(), prepared, prepared + dimensions);
+    grains.emplace_back(grain);
+
+    // Random top layer: Exponentially fewer nodes on each layer up
+    uniform_real_distribution<double> uniform(numeric_limits<double>::min(), 1.0);
+    const int level = jmin(maxNodeLevel, static_cast<int>(-std::log(uniform(random)) * levelMultiplier));
+    levels.emplace_back(level);
+    baseLinks.resize(baseLinks.size() + static_cast<size_t>(1 + maxBaseLinks), 0);
+    upperLinks.emplace_back(static_cast<size_t>(level * (1 + maxLinks)), 0);
+
+    if(entryPoint < 0){
+        entryPoint = node;
+        maxLevel = level;
+        return;
+    }
+
+    // Descend to the layer of the node, then link it on every layer from there down
+    const float* query = getVector(node);
+    int entry = entryPoint;
+    for(int l = maxLevel; l > level; l--){
+        entry = greedyClosest(query, entry, l);
+    }
+    for(int l = jmin(level, maxLevel); l >= 0; l--){
+        searchLayer(query, entry, efConstruction, l, insertScratch);
+        selectNeighbours(insertScratch.results, l == 0 ? maxBaseLinks : maxLinks, selected);
+        connect(node, l);
+        entry = selected.empty() ? entry : selected.front().row;
+    }
+
+    if(level > maxLevel){
+        entryPoint = node;
+        maxLevel = level;
+    }
+}
+
+int HNSWIndex::greedyClosest(const float* query, int entry, int level) const {
+    float entryDistance = distance(query, getVector(entry));
+    bool changed = true;
+    while(changed){
+        changed = false;
+        const int* links = getLinks(entry, level);
+        for(int i = 1; i <= links[0]; i++){
+            const float linkDistance = distance(query, getVector(links[i]));
+            if(linkDistance < entryDistance){
+                entryDistance = linkDistance;
+                entry = links[i];
+                changed = true;
+            }
+        }
+    }
+    return entry;
+}
+
+void HNSWIndex::searchLayer(const float* query, int entry, int ef, int level, SearchScratch& scratch) const {
+    // Visited nodes carry the current tag, so the marks don't need to be cleared between searches
+    scratch.visited.resize(grains.size(), 0);
+    if(++scratch.visitTag == 0){
+        fill(scratch.visited.begin(), scratch.visited.end(), 0);
+        scratch.visitTag = 1;
+    }
+    scratch.candidates.clear();
+    scratch.results.clear();
+
+    const Neighbour start { distance(query, getVector(entry)), entry };
+    scratch.visited[static_cast<size_t>(entry)] = scratch.visitTag;
+    scratch.candidates.push_back(start);
+    scratch.results.push_back(start);
+
+    while(!scratch.candidates.empty()){
+        const Neighbour closest = scratch.candidates.front();
+        // Every remaining candidate is further away than the furthest result
+        if(closest.distance > scratch.results.front().distance && static_cast<int>(scratch.results.size()) >= ef){
+            break;
+        }
+        pop_heap(scratch.candidates.begin(), scratch.candidates.end(), isFurther);
+        scratch.candidates.pop_back();
+
+        const int* links = getLinks(closest.row, level);
+        for(int i = 1; i <= links[0]; i++){
+            const int link = links[i];
+            if(scratch.visited[static_cast<size_t>(link)] == scratch.visitTag){
+                continue;
+            }
+            scratch.visited[static_cast<size_t>(link)] = scratch.visitTag;
+
+            const float linkDistance = distance(query, getVector(link));
+            if(static_cast<int>(scratch.results.size()) < ef || linkDistance < scratch.results.front().distance){
+                scratch.candidates.push_back({ linkDistance, link });
+                push_heap(scratch.candidates.begin(), scratch.candidates.end(), isFurther);
+                scratch.results.push_back({ linkDistance, link });
+                push_heap(scratch.results.begin(), scratch.results.end(), isCloser);
+                if(static_cast<int>(scratch.results.size()) > ef){
+                    pop_heap(scratch.results.begin(), scratch.results.end(), isCloser);
+                    scratch.results.pop_back();
+                }
+            }
+        }
+    }
+}
+
+void HNSWIndex::selectNeighbours(vector<Neighbour>& candidates, int maxNeighbours, vector<Neighbour>& result) const {
+    sort(candidates.begin(), candidates.end(), isCloser);
+    result.clear();
+    for(const Neighbour& candidate : candidates){
+        if(static_cast<int>(result.size()) >= maxNeighbours){
+            break;
+        }
+        bool isDiverse = true;
+        for(const Neighbour& chosen : result){
+            if(distance(getVector(candidate.row), getVector(chosen.row)) < candidate.distance){
+                isDiverse = false;
+                break;
+            }
+        }
+        if(isDiverse){
+            result.push_back(candidate);
+        }
+    }
+}
+
+void HNSWIndex::connect(int node, int level) {
+    const int levelMaxLinks = level == 0 ? maxBaseLinks : maxLinks;
+
+    int* links = getLinks(node, level);
+    links[0] = static_cast<int>(selected.size());
+    for(size_t i = 0; i < selected.size(); i++){
+        links[i + 1] = selected[i].row;
+    }
+
+    // Link back. A neighbour that is full keeps a diverse selection of its links plus the new node.
+    vector<Neighbour> neighbours = selected;
+    for(const Neighbour& neighbour : neighbours){
+        int* neighbourLinks = getLinks(neighbour.row, level);
+        if(neighbourLinks[0] < levelMaxLinks){
+            neighbourLinks[++neighbourLinks[0]] = node;
+            continue;
+        }
+        const float* base = getVector(neighbour.row);
+        pruneCandidates.clear();
+        pruneCandidates.push_back({ neighbour.distance, node });
+        for(int i = 1; i <= neighbourLinks[0]; i++){
+            pruneCandidates.push_back({ distance(base, getVector(neighbourLinks[i])), neighbourLinks[i] });
+        }
+        selectNeighbours(pruneCandidates, levelMaxLinks, selected);
+        neighbourLinks[0] = static_cast<int>(selected.size());
+        for(size_t i = 0; i < selected.size(); i++){
+            neighbourLinks[i + 1] = selected[i].row;
+        }
+    }
+    selected = std::move(neighbours);
+}
+
+void HNSWIndex::search(const float* query, int k, int efSearch, SearchScratch& scratch, vector<Neighbour>& found) const {
+    const ScopedReadLock sl (lock);
+    found.clear();
+    if(entryPoint < 0 || k <= 0){
+        return;
+    }
+
+    const float* prepared = prepareQuery(query, scratch);
+    int entry = entryPoint;
+    for(int l = maxLevel; l > 0; l--){
+        entry = greedyClosest(prepared, entry, l);
+    }
+    searchLayer(prepared, entry, jmax(efSearch, k), 0, scratch);
+
+    sort_heap(scratch.results.begin(), scratch.results.end(), isCloser);
+    const size_t numFound = jmin(static_cast<size_t>(k), scratch.results.size());
+    found.assign(scratch.results.begin(), scratch.results.begin() + static_cast<long>(numFound));
+}
+
+Grain HNSWIndex::getGrain(int node) const {
+    const ScopedReadLock sl (lock);
+    return grains[static_cast<size_t>(node)];
+}
+
+int HNSWIndex::size() const {
+    const ScopedReadLock sl (lock);
+    return static_cast<int>(grains.size());
+}
+
+bool HNSWIndex::isEmpty() const {
+    return size() == 0;
+}
+
+size_t HNSWIndex::getMemoryBytes() const {
+    const ScopedReadLock sl (lock);
+    size_t bytes = vectors.capacity() * sizeof(float) + grains.capacity() * sizeof(Grain)
+                   + (levels.capacity() + baseLinks.capacity()) * sizeof(int);
+    for(const auto& links : upperLinks){
+        bytes += sizeof(links) + links.capacity() * sizeof(int);
+    }
+    return bytes;
+}
+
+int HNSWIndex::getDimensions() const {
+    return dimensions;
+}
+
+HNSWIndex::Metric HNSWIndex::getMetric() const {
+    return metric;
+}
+
+bool HNSWIndex::save(const File& file, const std::function<string(int)>& getFilePath, const CorpusStamp& stamp) const {
+    const ScopedReadLock sl (lock);
+
+    file.deleteFile();
+    unique_ptr<FileOutputStream> stream = file.createOutputStream();
+    if(stream == nullptr || !stream->openedOk()){
+        return false;
+    }
+
+    // Header
+    stream->writeInt(fileMagic);
+    stream->writeInt(fileVersion);
+    stream->writeInt(dimensions);
+    stream->writeInt(NUM_FEATURES);
+    stream->writeInt64(stamp.maxRow);
+    stream->writeInt64(stamp.numRows);
+    stream->writeInt(metric == Metric::l2 ? 0 : 1);
+    stream->writeInt(maxLinks);
+    stream->writeInt(efConstruction);
+    stream->writeInt(static_cast<int>(grains.size()));
+    stream->writeInt(entryPoint);
+    stream->writeInt(maxLevel);
+
+    // Source files: File ids are only valid while the application runs, so paths are stored instead
+    map<int, int> fileRefs;
+    vector<int> fileIdsInOrder;
+    for(const Grain& grain : grains){
+        if(fileRefs.emplace(grain.getFileId(), static_cast<int>(fileIdsInOrder.size())).second){
+            fileIdsInOrder.push_back(grain.getFileId());
+        }
+    }
+    stream->writeInt(static_cast<int>(fileIdsInOrder.size()));
+    for(int fileId : fileIdsInOrder){
+        stream->writeString(String(getFilePath(fileId)));
+    }
+
+    // Nodes
+    for(size_t node = 0; node < grains.size(); node++){
+        const Grain& grain = grains[node];
+        stream->writeInt(fileRefs[grain.getFileId()]);
+        stream->writeInt(grain.getIdx());
+        for(int i = 0; i < NUM_FEATURES; i++){
+            stream->writeFloat(grain.getFeatures()[i]);
+        }
+        const float* vector = getVector(static_cast<int>(node));
+        for(int i = 0; i < dimensions; i++){
+            stream->writeFloat(vector[i]);
+        }
+        stream->writeInt(levels[node]);
+        for(int level = 0; level <= levels[node]; level++){
+            const int* links = getLinks(static_cast<int>(node), level);
+            stream->writeInt(links[0]);
+            for(int i = 1; i <= links[0]; i++){
+                stream->writeInt(links[i]);
+            }
+        }
+    }
+    stream->flush();
+    return stream->getStatus().wasOk();
+}
+
+unique_ptr<HNSWIndex> HNSWIndex::load(const File& file, int dimensions, const std::function<int(const string&)>& registerFile,
+                                      CorpusStamp& stamp) {
+    unique_ptr<FileInputStream> stream = file.createInputStream();
+    if(stream == nullptr || !stream->openedOk()){
+        return nullptr;
+    }
+
+    // Header: Graphs of another build (different vectors or features) are rebuilt. Every count and index read from the
+    // file is checked before it is used, a damaged file is rejected like a foreign one
+    if(stream->readInt() != fileMagic || stream->readInt() != fileVersion
+       || stream->readInt() != dimensions || stream->readInt() != NUM_FEATURES){
+        return nullptr;
+    }
+    stamp.maxRow = stream->readInt64();
+    stamp.numRows = stream->readInt64();
+    const Metric metric = stream->readInt() == 0 ? Metric::l2 : Metric::cosine;
+    const int M = stream->readInt();
+    const int efConstruction = stream->readInt();
+    const int numNodes = stream->readInt();
+    const int entryPoint = stream->readInt();
+    const int maxLevel = stream->readInt();
+    const int numFiles = stream->readInt();
+    // Smallest possible node: File, index, features, vector, level and the link count of layer 0
+    const int64 minNodeBytes = 4 * (2 + NUM_FEATURES + dimensions + 2);
+    const int64 remainingBytes = stream->getNumBytesRemaining();
+    if(stream->isExhausted() || M < 2 || M > maxFileLinks || efConstruction < 1 || efConstruction > maxFileEfConstruction
+       || numNodes < 0 || numNodes > remainingBytes / minNodeBytes || numFiles < 0 || numFiles > remainingBytes
+       || (numNodes == 0 ? entryPoint != -1 || maxLevel != -1
+                         : entryPoint < 0 || entryPoint >= numNodes || maxLevel < 0 || maxLevel > maxNodeLevel)){
+        return nullptr;
+    }
+    auto index = make_unique<HNSWIndex>(dimensions, metric, M, efConstruction);
+    index->entryPoint = entryPoint;
+    index->maxLevel = maxLevel;
+
+    vector<int> fileIds;
+    for(int i = 0; i < numFiles && !stream->isExhausted(); i++){
+        fileIds.push_back(registerFile(stream->readString().toStdString()));
+    }
+    if(static_cast<int>(fileIds.size()) != numFiles){
+        return nullptr;
+    }
+
+    index->vectors.reserve(static_cast<size_t>(numNodes) * dimensions);
+    index->grains.reserve(static_cast<size_t>(numNodes));
+    index->levels.reserve(static_cast<size_t>(numNodes));
+    index->baseLinks.reserve(static_cast<size_t>(numNodes) * (1 + index->maxBaseLinks));
+    index->upperLinks.reserve(static_cast<size_t>(numNodes));
+    for(int node = 0; node < numNodes; node++){
+        const int fileRef = stream->readInt();
+        const int idx = stream->readInt();
+        float features[NUM_FEATURES];
+        for(float& feature : features){
+            feature = stream->readFloat();
+        }
+        for(int i = 0; i < dimensions; i++){
+            index->vectors.push_back(stream->readFloat());
+        }
+        const int level = stream->readInt();
+        if(stream->isExhausted() || fileRef < 0 || fileRef >= numFiles || level < 0 || level > maxLevel){
+            return nullptr;
+        }
+        index->grains.emplace_back(fileIds[static_cast<size_t>(fileRef)], idx, features);
+        index->levels.push_back(level);
+        index->baseLinks.resize(index->baseLinks.size() + static_cast<size_t>(1 + index->maxBaseLinks), 0);
+        index->upperLinks.emplace_back(static_cast<size_t>(level * (1 + index->maxLinks)), 0);
+        for(int l = 0; l <= level; l++){
+            int* links = index->getLinks(node, l);
+            if(stream->getNumBytesRemaining() < 4){
+                return nullptr;
+            }
+            const int numLinks = stream->readInt();
+            if(numLinks < 0 || numLinks > (l == 0 ? index->maxBaseLinks : index->maxLinks)
+               || stream->getNumBytesRemaining() < 4 * static_cast<int64>(numLinks)){
+                return nullptr;
+            }
+            links[0] = numLinks;
+            for(int i = 1; i <= numLinks; i++){
+                links[i] = stream->readInt();
+                if(links[i] < 0 || links[i] >= numNodes){
+                    return nullptr;
+                }
+            }
+        }
+    }
+    // The search starts at the entry point on maxLevel and follows links on every layer down: The entry point must be on
+    // the top layer, and a link on a layer must lead to a node that is on that layer too
+    if(numNodes > 0 && index->levels[static_cast<size_t>(entryPoint)] != maxLevel){
+        return nullptr;
+    }
+    for(int node = 0; node < numNodes; node++){
+        for(int l = 1; l <= index->levels[static_cast<size_t>(node)]; l++){
+            const int* links = index->getLinks(node, l);
+            for(int i = 1; i <= links[0]; i++){
+                if(index->levels[static_cast<size_t>(links[i])] < l){
+                    return nullptr;
+                }
+            }
+        }
+    }
+    return index;
+}
@@ -0,0 +1,197 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_HNSWINDEX_H
+#define DMLAP_BACKEND_HNSWINDEX_H
+
+#include <functional>
+#include <random>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "Grain.h"
+#include "TimbreIndex.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Approximate nearest neighbour search over timbre vectors with a hierarchical navigable small world graph (HNSW).
+ * Every vector is a node linked to about M close nodes on layer 0, and a few nodes are also on sparser upper layers. A
+ * search walks greedily down from the top layer and then explores the neighbourhood of the query on layer 0, keeping
+ * the efSearch closest nodes seen: Larger efSearch gives better recall at the cost of speed. Search time grows about
+ * logarithmically with the corpus, unlike the exact search and the inverted file of "TimbreIndex.h", which is what
+ * makes it usable with millions of grains.
+ * Unlike a TimbreIndex, the graph grows incrementally (add) and is saved to and loaded from a file, since building it
+ * for a large corpus takes minutes. Searches run concurrently with each other; adding a node waits for searches in
+ * flight.
+ */
+class HNSWIndex {
+public:
+    using Metric = TimbreIndex::Metric;
+    using Neighbour = TimbreIndex::Neighbour;
+
+    /**
+     * Buffers of a search, owned by the caller so repeated searches don't allocate
+     */
+    struct SearchScratch {
+        vector<float> query;
+        vector<uint32_t> visited;
+        uint32_t visitTag = 0;
+        vector<Neighbour> candidates;
+        vector<Neighbour> results;
+    };
+
+    /**
+     * Identifies the corpus a saved graph was built from, so that it is not used once the corpus changed
+     */
+    struct CorpusStamp {
+        // Largest database row with a vector, and the number of rows with one
+        int64 maxRow = 0;
+        int64 numRows = 0;
+
+        bool operator==(const CorpusStamp& other) const { return maxRow == other.maxRow && numRows == other.numRows; }
+        bool operator!=(const CorpusStamp& other) const { return !(*this == other); }
+    };
+
+    // Links per node on the upper layers (twice as many on layer 0)
+    static constexpr int defaultM = 16;
+    // Size of the candidate list while inserting
+    static constexpr int defaultEfConstruction = 200;
+    // Size of the candidate list while searching
+    static constexpr int defaultEfSearch = 64;
+
+    /**
+     * @param dimensions Length of the vectors
+     * @param metric Cosine vectors are normalised when added, so the cosine distance is 1 - dot product
+     * @param M Links per node
+     * @param efConstruction Size of the candidate list while inserting
+     */
+    explicit HNSWIndex(int dimensions, Metric metric = Metric::cosine, int M = defaultM, int efConstruction = defaultEfConstruction);
+
+    /**
+     * Add a node
+     * @param grain The grain of the vector
+     * @param vector dimensions values
+     */
+    void add(const Grain& grain, const float* vector);
+
+    /**
+     * Find the (approximately) k closest nodes to a query
+     * @param query dimensions values
+     * @param k Maximum number of neighbours
+     * @param efSearch Size of the candidate list, at least k
+     * @param scratch Buffers of the search
+     * @param found Receives the neighbours (row = node), closest first (cleared first)
+     */
+    void search(const float* query, int k, int efSearch, SearchScratch& scratch, vector<Neighbour>& found) const;
+
+    Grain getGrain(int node) const;
+
+    int size() const;
+
+    bool isEmpty() const;
+
+    int getDimensions() const;
+
+    /**
+     * Memory held by the index
+     * @return Bytes of vectors, grains and links
+     */
+    size_t getMemoryBytes() const;
+
+    Metric getMetric() const;
+
+    /**
+     * Write the graph to a file. Grains are stored with the path of their source file.
+     * @param file
+     * @param getFilePath Path of a file id
+     * @param stamp The corpus the graph holds, returned by load()
+     * @return False if the file could not be written
+     */
+    bool save(const File& file, const std::function<string(int)>& getFilePath, const CorpusStamp& stamp) const;
+
+    /**
+     * Read a graph written by save()
+     * @param file
+     * @param dimensions Expected length of the vectors
+     * @param registerFile File id of a path
+     * @param stamp Receives the corpus stamp the graph was saved with
+     * @return The graph, nullptr if the file is missing, damaged (counts, layers or links out of range) or doesn't
+     * match the dimensions and features of this build
+     */
+    static unique_ptr<HNSWIndex> load(const File& file, int dimensions, const std::function<int(const string&)>& registerFile,
+                                      CorpusStamp& stamp);
+
+private:
+    int dimensions;
+    Metric metric;
+    // Links per node on the upper layers and on layer 0
+    int maxLinks;
+    int maxBaseLinks;
+    int efConstruction;
+    // Normalisation of the random layer of a node (1 / ln M)
+    double levelMultiplier;
+
+    // Per node: Vector, grain and top layer
+    vector<float> vectors;
+    vector<Grain> grains;
+    vector<int> levels;
+    // Links on layer 0, a block of 1 + maxBaseLinks per node: The count followed by the linked nodes
+    vector<int> baseLinks;
+    // Links on layers 1 and up, a block of 1 + maxLinks per layer (empty for most nodes)
+    vector<vector<int>> upperLinks;
+
+    // Node where every search starts and its layer
+    int entryPoint = -1;
+    int maxLevel = -1;
+
+    // Inserting: Layer of new nodes and buffers
+    mt19937 random { 42 };
+    SearchScratch insertScratch;
+    vector<Neighbour> selected;
+    vector<Neighbour> pruneCandidates;
+
+    // Searches hold the read lock, add() the write lock
+    ReadWriteLock lock;
+
+    float distance(const float* a, const float* b) const;
+    const float* getVector(int node) const;
+    int* getLinks(int node, int level);
+    const int* getLinks(int node, int level) const;
+
+    /**
+     * Prepare a query: Normalised copy for the cosine metric
+     * @return The vector to compare with the nodes
+     */
+    const float* prepareQuery(const float* query, SearchScratch& scratch) const;
+
+    /**
+     * Walk greedily towards the query on one layer
+     * @return The node closest to the query reached from entry
+     */
+    int greedyClosest(const float* query, int entry, int level) const;
+
+    /**
+     * Best-first search on one layer, leaves the ef closest nodes in scratch.results (a max-heap)
+     */
+    void searchLayer(const float* query, int entry, int ef, int level, SearchScratch& scratch) const;
+
+    /**
+     * Pick up to maxNeighbours diverse neighbours: A candidate is skipped if it is closer to an already selected
+     * neighbour than to the base node, which keeps links pointing in different directions.
+     * @param candidates Distances to the base node, sorted in place
+     * @param maxNeighbours
+     * @param result Receives the selection
+     */
+    void selectNeighbours(vector<Neighbour>& candidates, int maxNeighbours, vector<Neighbour>& result) const;
+
+    /**
+     * Link a node to its selected neighbours and back, pruning neighbours that have too many links
+     */
+    void connect(int node, int level);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HNSWIndex)
+};
+
+#endif //DMLAP_BACKEND_HNSWINDEX_H
@@ -0,0 +1,135 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "HeadlessEngine.h"
+
+HeadlessEngine::HeadlessEngine(int oscListeningPort, int oscSenderPort, int numSessions, Routing routing,
+                               int threadsPerSession) : routing(routing) {
+    // Initialise essentia
+    essentia::warningLevelActive = false;
+    essentia::init();
+
+    // The corpus is loaded once and shared by every session
+    dbConnector = make_unique<DBConnector>();
+
+    // Split the CPUs between the sessions, leaving one core for the audio thread
+    numSessions = jmax(1, numSessions);
+    if(threadsPerSession <= 0){
+        threadsPerSession = jmax(1, (SystemStats::getNumCpus() - 1) / numSessions);
+    }
+    for(int i = 0; i < numSessions; i++){
+        sessions.emplace_back(make_unique<AgentSession>(i, *dbConnector, threadsPerSession));
+        sessions.back()->connect(oscListeningPort + i, oscSenderPort + i);
+        // Like the GUI with the agent running: Every new trajectory is looped until the next one arrives
+        sessions.back()->getPlaybackEngine().post(PlaybackEngine::Command::Type::loop);
+    }
+
+    startTimer(metricsInterval);
+}
+
+HeadlessEngine::~HeadlessEngine() {
+    stopTimer();
+    // Stop talking to the agents before the database goes away
+    sessions.clear();
+
+    // Flush the output file before the components go away
+    outputWriter = nullptr;
+    writerThread.stopThread(4000);
+
+    essentia::shutdown();
+}
+
+int HeadlessEngine::getNumOutputChannels() const {
+    return routing == Routing::separate ? 2 * static_cast<int>(sessions.size()) : 2;
+}
+
+bool HeadlessEngine::canBeRenderedTo(int numDeviceChannels) const {
+    return routing == Routing::mixed || numDeviceChannels >= getNumOutputChannels();
+}
+
+bool HeadlessEngine::setOutputFile(const File& file, double sampleRate) {
+    file.deleteFile();
+    unique_ptr<FileOutputStream> stream = file.createOutputStream();
+    if(stream == nullptr || !stream->openedOk()){
+        return false;
+    }
+    WavAudioFormat wavFormat;
+    AudioFormatWriter* writer = wavFormat.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(getNumOutputChannels()), 24, {}, 0);
+    if(writer == nullptr){
+        return false;
+    }
+    // The writer owns the stream now
+    stream.release();
+
+    // Writing from the audio thread only queues the samples, the file is written on the writer thread
+    writerThread.startThread();
+    outputWriter = make_unique<AudioFormatWriter::ThreadedWriter>(writer, writerThread, 1 << 16);
+    return true;
+}
+
+void HeadlessEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    for(auto& session : sessions){
+        session->prepare(sampleRate);
+    }
+    sessionBuffer.setSize(2, jmax(1, samplesPerBlockExpected));
+    callbackMetrics.prepare(sampleRate);
+}
+
+void HeadlessEngine::releaseResources() {
+}
+
+void HeadlessEngine::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) {
+    // Measure how much of the real-time budget this callback uses
+    const AudioCallbackMetrics::ScopedMeasurement measurement (callbackMetrics, bufferToFill.buffer->getNumSamples());
+
+    AudioBuffer<float>& buffer = *bufferToFill.buffer;
+    const int numSamples = buffer.getNumSamples();
+    if(sessions.size() == 1 && buffer.getNumChannels() == 2){
+        // A single agent renders straight into the output
+        sessions.front()->process(buffer, numSamples);
+    } else {
+        // Render every session into the session buffer (in pieces if the block is longer than expected) and mix or
+        // route it into the output. Mixed sessions are scaled down so the sum does not clip
+        buffer.clear();
+        const float gain = routing == Routing::mixed ? 1.0f / static_cast<float>(sessions.size()) : 1.0f;
+        for(size_t i = 0; i < sessions.size(); i++){
+            const int firstChannel = routing == Routing::separate ? 2 * static_cast<int>(i) : 0;
+            for(int start = 0; start < numSamples; start += sessionBuffer.getNumSamples()){
+                const int length = jmin(sessionBuffer.getNumSamples(), numSamples - start);
+                sessions[i]->process(sessionBuffer, length);
+                for(int channel = 0; channel < 2 && firstChannel + channel < buffer.getNumChannels(); channel++){
+                    buffer.addFrom(firstChannel + channel, start, sessionBuffer, channel, 0, length, gain);
+                }
+            }
+        }
+    }
+
+    if(outputWriter != nullptr){
+        outputWriter->write(buffer.getArrayOfReadPointers(), buffer.getNumSamples());
+    }
+}
+
+bool HeadlessEngine::isConnected() const {
+    for(const auto& session : sessions){
+        if(!session->isConnected()){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HeadlessEngine::openSharedMemory(const String& name) {
+    bool allOpen = true;
+    for(auto& session : sessions){
+        allOpen = session->openSharedMemory(sessions.size() == 1 ? name : name + String(session->getSessionId())) && allOpen;
+    }
+    return allOpen;
+}
+
+void HeadlessEngine::timerCallback() {
+    AudioCallbackMetrics::Snapshot metrics = callbackMetrics.getSnapshot();
+    for(auto& session : sessions){
+        session->sendMetrics(metrics);
+    }
+}
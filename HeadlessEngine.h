@@ -0,0 +1,118 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_HEADLESSENGINE_H
+#define DMLAP_BACKEND_HEADLESSENGINE_H
+
+#include <memory>
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_osc/juce_osc.h>
+#include "external_libraries/essentia/include/algorithmfactory.h"
+#include "DBConnector.h"
+#include "AgentSession.h"
+#include "AudioCallbackMetrics.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * The audio engine without any GUI, driven either by a real audio device or by the NullAudioDriver. It serves one or
+ * more RL agents, each in its own AgentSession (OSC ports, traverser, trajectory worker, playback engine) on top of
+ * one shared grain database. It speaks the same OSC protocol towards every agent as the GUI application, minus
+ * everything that needs a human in front of the screen (recording, feedback buttons).
+ * Session i listens on oscListeningPort + i and replies to oscSenderPort + i. The sessions are either mixed into one
+ * stereo output or routed to separate channel pairs (session i on channels 2i and 2i + 1), which needs a device with
+ * getNumOutputChannels() outputs.
+ * The rendered output can additionally be written to a WAV file.
+ */
+class HeadlessEngine : public AudioSource,
+                       private Timer {
+public:
+    enum class Routing { mixed, separate };
+
+    /**
+     * @param oscListeningPort Port to receive messages of the first agent on
+     * @param oscSenderPort Port the first agent listens on
+     * @param numSessions Number of agents served
+     * @param routing Whether the sessions are mixed or each get their own output channels
+     * @param threadsPerSession Worker budget of each session for batch evaluation, 0 to split the CPUs evenly
+     */
+    HeadlessEngine(int oscListeningPort, int oscSenderPort, int numSessions = 1, Routing routing = Routing::mixed,
+                   int threadsPerSession = 0);
+    ~HeadlessEngine() override;
+
+    /**
+     * Number of output channels the engine renders: 2, or 2 per session if they are routed separately
+     * @return The number of channels
+     */
+    int getNumOutputChannels() const;
+
+    /**
+     * Whether every session can be heard on an output with the given number of channels. With separate routing the
+     * sessions beyond the device's channels would be silently muted.
+     * @param numDeviceChannels Number of output channels of the device
+     * @return True if the device has enough channels
+     */
+    bool canBeRenderedTo(int numDeviceChannels) const;
+
+    /**
+     * Write everything the engine renders to a WAV file (call before the audio starts)
+     * @param file The output file, overwritten if it exists
+     * @param sampleRate
+     * @return False if the file could not be opened
+     */
+    bool setOutputFile(const File& file, double sampleRate);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+
+    /**
+     * Audio thread: Render the next block (every session, then file output)
+     */
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    /**
+     * Whether the OSC receivers and senders of all sessions could be connected
+     * @return True if connected
+     */
+    bool isConnected() const;
+
+    /**
+     * Talk to the agents over shared memory instead of OSC (see SharedMemoryProtocol.h)
+     * @param name Name of the shared-memory segment, with several sessions session i uses name + i
+     * @return False if a segment could not be created
+     */
+    bool openSharedMemory(const String& name);
+
+private:
+    /**
+     * Periodically publishes the audio callback metrics to every agent
+     */
+    void timerCallback() override;
+
+    // Grain database, shared by all sessions (declared first so it outlives them)
+    unique_ptr<DBConnector> dbConnector;
+
+    // One session per agent
+    vector<unique_ptr<AgentSession>> sessions;
+    Routing routing;
+    // Render buffer of one session (stereo, allocated in prepareToPlay)
+    AudioBuffer<float> sessionBuffer;
+    AudioCallbackMetrics callbackMetrics;
+
+    // Optional file output
+    TimeSliceThread writerThread { "Headless output writer" };
+    unique_ptr<AudioFormatWriter::ThreadedWriter> outputWriter;
+
+    // How often the metrics are sent over OSC (milliseconds)
+    int metricsInterval = 1000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HeadlessEngine)
+};
+
+
+#endif //DMLAP_BACKEND_HEADLESSENGINE_H
@@ -0,0 +1,159 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_events/juce_events.h>
+#include "HeadlessEngine.h"
+#include "NullAudioDriver.h"
+#include "OfflineRenderer.h"
+
+/**
+ * Headless server application: Runs the audio engine and the OSC connection to the RL agent without a window.
+ *
+ * Options:
+ *   --osc-port <port>      Port to receive agent messages on (default 12000)
+ *   --reply-port <port>    Port the agent listens on (default 5005)
+ *   --null-device          Don't open an audio device, render in real time from a timer instead
+ *   --sample-rate <rate>   Sample rate of the null device (default 48000)
+ *   --block-size <size>    Block size of the null device (default 512)
+ *   --output <file.wav>    Additionally write the rendered audio to a WAV file
+ *   --shm <name>           Talk to the agent over the shared-memory segment /dev/shm/<name> instead of OSC
+ *                          (with several sessions session i uses /dev/shm/<name><i>)
+ *
+ * Multiple agents (one session each, all sharing one grain database):
+ *   --sessions <n>         Number of agents served (default 1). Session i listens on osc-port + i and replies to
+ *                          reply-port + i
+ *   --routing <mode>       "mix" to mix all sessions into one stereo output (default), "separate" to give each session
+ *                          its own pair of output channels (the device needs 2 output channels per session)
+ *   --session-threads <n>  Batch evaluation threads per session (default: the CPUs split evenly)
+ *
+ * Offline rendering (renders trajectories faster than real time and exits, no audio device or OSC):
+ *   --render <params.txt>  One trajectory per line, parameters in the "/params" layout separated by spaces or commas
+ *   --output-dir <dir>     Directory for the WAV files (default: current directory)
+ *   --grain-length <n>     Grain length in samples (default GRAIN_LENGTH)
+ *   --threads <n>          Number of trajectories rendered in parallel (default: number of CPUs)
+ *   --sample-rate <rate>   Sample rate written to the WAV files (default 48000)
+ */
+class DMLAP_HeadlessApplication : public juce::JUCEApplicationBase
+{
+public:
+    const juce::String getApplicationName() override       { return "DMLAP Headless Engine"; }
+    const juce::String getApplicationVersion() override    { return "0.0.1"; }
+    bool moreThanOneInstanceAllowed() override             { return true; }
+
+    void initialise (const juce::String& commandLine) override
+    {
+        ArgumentList arguments ("DMLAP_Headless", commandLine);
+        int oscPort = arguments.containsOption("--osc-port") ? arguments.getValueForOption("--osc-port").getIntValue() : 12000;
+        int replyPort = arguments.containsOption("--reply-port") ? arguments.getValueForOption("--reply-port").getIntValue() : 5005;
+        double sampleRate = arguments.containsOption("--sample-rate") ? arguments.getValueForOption("--sample-rate").getDoubleValue() : 48000.0;
+        int blockSize = arguments.containsOption("--block-size") ? arguments.getValueForOption("--block-size").getIntValue() : 512;
+
+        if(arguments.containsOption("--render")){
+            renderOffline(arguments, sampleRate);
+            quit();
+            return;
+        }
+
+        int numSessions = arguments.containsOption("--sessions") ? arguments.getValueForOption("--sessions").getIntValue() : 1;
+        int threadsPerSession = arguments.containsOption("--session-threads") ? arguments.getValueForOption("--session-threads").getIntValue() : 0;
+        HeadlessEngine::Routing routing = arguments.getValueForOption("--routing") == "separate" ? HeadlessEngine::Routing::separate
+                                                                                                 : HeadlessEngine::Routing::mixed;
+
+        engine = make_unique<HeadlessEngine>(oscPort, replyPort, numSessions, routing, threadsPerSession);
+        if(arguments.containsOption("--shm") && !engine->openSharedMemory(arguments.getValueForOption("--shm"))){
+            fprintf(stderr, "Error: could not open shared memory %s, using OSC\n", arguments.getValueForOption("--shm").toRawUTF8());
+        }
+
+        // Open the default output device unless asked not to, fall back to the null device if there is none
+        bool useNullDevice = arguments.containsOption("--null-device");
+        if(!useNullDevice){
+            String error = deviceManager.initialiseWithDefaultDevices(0, engine->getNumOutputChannels());
+            if(error.isNotEmpty() || deviceManager.getCurrentAudioDevice() == nullptr){
+                fprintf(stderr, "No audio device (%s), using the null device\n", error.toRawUTF8());
+                useNullDevice = true;
+            } else {
+                sampleRate = deviceManager.getCurrentAudioDevice()->getCurrentSampleRate();
+            }
+        }
+        if(!useNullDevice){
+            // Refuse to run with separately routed sessions the device cannot play, they would be silently muted
+            const int numDeviceChannels = deviceManager.getCurrentAudioDevice()->getActiveOutputChannels().countNumberOfSetBits();
+            if(!engine->canBeRenderedTo(numDeviceChannels)){
+                fprintf(stderr, "Error: %d sessions routed separately need %d output channels, the device has %d "
+                                "(use --routing mix or --null-device)\n", jmax(1, numSessions), engine->getNumOutputChannels(),
+                        numDeviceChannels);
+                setApplicationReturnValue(1);
+                quit();
+                return;
+            }
+        }
+
+        if(arguments.containsOption("--output")){
+            File outputFile = arguments.getFileForOption("--output");
+            if(!engine->setOutputFile(outputFile, sampleRate)){
+                fprintf(stderr, "Error: could not open %s for writing\n", outputFile.getFullPathName().toRawUTF8());
+            }
+        }
+
+        if(useNullDevice){
+            nullDriver = make_unique<NullAudioDriver>(*engine, sampleRate, blockSize, engine->getNumOutputChannels());
+            nullDriver->start();
+        } else {
+            player.setSource(engine.get());
+            deviceManager.addAudioCallback(&player);
+        }
+        fprintf(stdout, "Headless engine running (%s, %.0f Hz, %d session(s))\n", useNullDevice ? "null device" : "audio device",
+                sampleRate, jmax(1, numSessions));
+    }
+
+    void shutdown() override
+    {
+        // Stop the audio before the engine goes away
+        if(nullDriver != nullptr){
+            nullDriver->stop();
+            nullDriver = nullptr;
+        }
+        deviceManager.removeAudioCallback(&player);
+        player.setSource(nullptr);
+        deviceManager.closeAudioDevice();
+        engine = nullptr;
+    }
+
+    void systemRequestedQuit() override                         { quit(); }
+    void anotherInstanceStarted (const juce::String&) override  {}
+    void suspended() override                                   {}
+    void resumed() override                                     {}
+    void unhandledException (const std::exception*, const juce::String&, int) override { jassertfalse; }
+
+private:
+    /**
+     * Render all trajectories of the parameter file given on the command line to WAV files
+     * @param arguments The command line
+     * @param sampleRate Sample rate written to the WAV files
+     */
+    void renderOffline(const ArgumentList& arguments, double sampleRate)
+    {
+        File outputDirectory = arguments.containsOption("--output-dir") ? arguments.getFileForOption("--output-dir")
+                                                                        : File::getCurrentWorkingDirectory();
+        int grainLength = arguments.containsOption("--grain-length") ? arguments.getValueForOption("--grain-length").getIntValue() : GRAIN_LENGTH;
+        int numThreads = arguments.containsOption("--threads") ? arguments.getValueForOption("--threads").getIntValue() : SystemStats::getNumCpus();
+
+        vector<OfflineRenderer::Job> jobs = OfflineRenderer::readJobs(arguments.getFileForOption("--render"), outputDirectory, grainLength);
+        DBConnector dbConnector;
+        OfflineRenderer renderer (dbConnector, numThreads);
+        OfflineRenderer::Summary summary = renderer.render(jobs, sampleRate);
+
+        fprintf(stdout, "Rendered %d of %zu trajectories in %.2f s (%.1fx real time)\n",
+                summary.numWritten, jobs.size(), summary.seconds, summary.speedFactor);
+        setApplicationReturnValue(summary.numFailed == 0 ? 0 : 1);
+    }
+
+    unique_ptr<HeadlessEngine> engine;
+    AudioDeviceManager deviceManager;
+    AudioSourcePlayer player;
+    unique_ptr<NullAudioDriver> nullDriver;
+};
+
+START_JUCE_APPLICATION (DMLAP_HeadlessApplication)
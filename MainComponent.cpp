@@ -15,6 +15,13 @@ MainComponent::MainComponent()
     // Main window size
     setSize (1024, 600);
 
+    // Initialise essentia
+    essentia::warningLevelActive = false;
+    essentia::init();
+
+    // Everything the audio callback and the OSC handlers use exists before either of them can run
+    createComponents();
+
     // Disable input
     int numInputChannels = 0;
 
@@ -31,35 +38,14 @@ MainComponent::MainComponent()
         setAudioChannels (2, 2);
     }
 
-    // Initialise essentia
-    essentia::warningLevelActive = false;
-    essentia::init();
+    // Initialise OSC: The session handles the agent protocol, the GUI adds the handlers of its buttons before the
+    // session starts receiving
+    registerOSCHandlers();
+    if (!session->connect (oscListeningPort, oscSenderPort))
+        showConnectionErrorMessage ("Error: could not connect to UDP ports " + to_string(oscListeningPort) + " / " + to_string(oscSenderPort));
 
-    // Initialise OSC
-    // Server
-    if (!connect (oscListeningPort))
-        showConnectionErrorMessage ("Error: could not connect to UDP port " + to_string(oscListeningPort));
-
-    // Sender
-    if (!sender.connect ("127.0.0.1", oscSenderPort))
-        showConnectionErrorMessage ("Error: could not connect to UDP port " + to_string(oscSenderPort));
-
-    // Add OSC path listeners
-    addListener (this, "/path");
-    addListener (this, "/params");
-    addListener (this, "/osc_from_js");
-    addListener (this, "/osc_from_js_is_looping");
-    addListener (this, "/osc_from_js_left_channel_data");
-    addListener (this, "/osc_from_js_right_channel_data");
-    addListener (this, "/osc_from_js_audio_transmission_done");
-    addListener (this, "/osc_from_js_clear_recording_buffer");
-    addListener (this, "/osc_from_js_play");
-    addListener (this, "/osc_from_js_agent_feedback");
-    addListener (this, "/osc_from_js_agent_zone_feedback");
-    addListener (this, "/osc_from_js_pause_agent");
-    addListener (this, "/osc_from_js_record_in_JUCE");
-    addListener (this, "/osc_from_js_explore");
-    addListener (this, "/explore_state_done");
+    // Publish audio callback metrics
+    startTimer(metricsInterval);
 
     // Add keyboard listener
     addKeyListener(this);
@@ -70,16 +56,33 @@ MainComponent::MainComponent()
 
 MainComponent::~MainComponent()
 {
+    deviceManager.removeChangeListener (this);
+
+    // This shuts down the audio device and clears the audio source, the audio callback renders from the session
+    shutdownAudio();
+
+    // Stop receiving before the components go away, handlers must not run while they do
+    dataLoaderPanel = nullptr;
+    session = nullptr;
+
     // Shutdown essentia
     essentia::shutdown();
+}
 
-    // Stop OSC
-    sender.disconnect();
+void MainComponent::createComponents() {
+    // Initialise DB connector
+    dbConnector = make_unique<DBConnector>();
 
-    deviceManager.removeChangeListener (this);
+    // Initialise the agent session (analyser, traverser, trajectory and recording workers, batch evaluator, grain
+    // stream and playback engine), leaving one core for the audio thread
+    session = make_unique<AgentSession>(0, *dbConnector, SystemStats::getNumCpus() - 1);
+    session->onLogMessage = [this] (const String& message) { logMessage(message); };
+    session->getPlaybackEngine().onStateChanged = [this] { playbackStateChanged(); };
 
-    // This shuts down the audio device and clears the audio source.
-    shutdownAudio();
+    dataLoaderPanel = make_unique<DataLoaderPanel>(session->getAnalyser(), session->getTraverser());
+    addAndMakeVisible(*dataLoaderPanel);
+
+    initialiseGUI();
 }
 
 //==============================================================================
@@ -99,129 +102,29 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
         essentia::init();
     }
 
-    // Create audio buffer for generated graina trajectory
-    if (generatedBuffer == nullptr){
-        generatedBuffer = make_unique<AudioBuffer<float>>(2, GRAIN_LENGTH * GRAINS_IN_TRAJECTORY);
-        generatedBuffer->clear();
-    }
-    generatedIdx = -1;
-    recordingIdx = -1;
-    canSetGeneratedIdx = true;
-
-    // Create audio buffer for recording user audio
-    if(recordingBuffer == nullptr)
-    {
-        recordingBuffer = make_unique<AudioBuffer<float>>(2, GRAINS_IN_TRAJECTORY * GRAIN_LENGTH);
-        recordingBuffer->clear();
-    }
-
-    // Initialise components
-    if (analyser == nullptr){
-        // Initialise DB connector
-        dbConnector = make_unique<DBConnector>();
-        analyser = make_unique<Analyser>(*dbConnector);
-
-        // Initialise traverser
-        traverser = make_unique<Traverser>(*dbConnector, *analyser, *generatedBuffer, generatedGrains);
-
-        dataLoaderPanel = make_unique<DataLoaderPanel>(*analyser, *traverser);
-        addAndMakeVisible(*dataLoaderPanel);
-
-        initialiseGUI();
+    // The analyser is only used on the message thread, so it is re-initialised there
+    if(MessageManager::getInstance()->isThisTheMessageThread()){
+        session->getAnalyser().initialise(sampleRate);
+    } else {
+        Component::SafePointer<MainComponent> safeThis (this);
+        MessageManager::callAsync([safeThis, sampleRate] {
+            if(safeThis != nullptr){
+                safeThis->session->getAnalyser().initialise(sampleRate);
+            }
+        });
     }
-    analyser->initialise(sampleRate);
+    session->getRecordingWorker().prepare(sampleRate);
+    callbackMetrics.prepare(sampleRate);
+    numReportedOverruns = 0;
 }
 
 void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    canSetGeneratedIdx = false;
-    int numSamples = bufferToFill.buffer->getNumSamples();
-    int genIdx = generatedIdx;
-    // Normal, linear, one-time playback of trajectory
-    if(!isLooping && !isGeneratedLooping && isAgentPaused && genIdx > -1){
-        if(genIdx + numSamples > generatedBuffer->getNumSamples()){
-            generatedIdx = genIdx = -1;
-            triggerAsyncUpdate();
-            return;
-        }
-        bufferToFill.buffer->clear(0, numSamples);
-        bufferToFill.buffer->addFrom(0, 0, *generatedBuffer, 0, genIdx, numSamples);
-        bufferToFill.buffer->addFrom(1, 0, *generatedBuffer, 1, genIdx, numSamples);
-        generatedIdx += numSamples;
-        return;
-    }
-
-    // Recording user audio using the computer microphone
-    else if(isRecording){
-        // Audio input for recording
-        if(recordingIdx + numSamples > recordingBuffer->getNumSamples()){
-            isRecording = false;
-            recordingIdx = -1;
-            shouldPrimeTrajectory = true;
-            triggerAsyncUpdate();
-            return;
-        }
-        auto* device = deviceManager.getCurrentAudioDevice();
-        auto activeInputChannels  = device->getActiveInputChannels();
-        auto activeOutputChannels = device->getActiveOutputChannels();
-
-        recordingBuffer->clear(recordingIdx, numSamples);
-        recordingBuffer->addFrom(0, recordingIdx, *bufferToFill.buffer, 0, 0, numSamples);
-        recordingBuffer->addFrom(1, recordingIdx, *bufferToFill.buffer, 1, 0, numSamples);
-
-        recordingIdx += numSamples;
-
-        // Disable feedback
-        bufferToFill.buffer->clear();
-        return;
-    }
-
-    // Normal playback of recorded user audio
-    else if(!isRecording && recordingIdx > -1){
-        if(recordingIdx + numSamples >= recordingBuffer->getNumSamples()){
-            recordingIdx = -1;
-            return;
-        }
-        bufferToFill.buffer->clear(0, numSamples);
-        bufferToFill.buffer->addFrom(0, 0, *recordingBuffer, 0, recordingIdx, numSamples);
-        bufferToFill.buffer->addFrom(1, 0, *recordingBuffer, 1, recordingIdx, numSamples);
-        recordingIdx += numSamples;
-
-        return;
-    }
-
-    // Looping via the OSC MOBILE WEB interface (i.e. the one on the phone)
-    else if(isLooping){
-        if(genIdx >= loopingGrainEndIdx){
-            generatedIdx = genIdx = loopingGrainStartIdx;
-        }
-        bufferToFill.buffer->clear(0, numSamples);
-        bufferToFill.buffer->addFrom(0, 0, *generatedBuffer, 0, genIdx, numSamples);
-        bufferToFill.buffer->addFrom(1, 0, *generatedBuffer, 1, genIdx, numSamples);
-        generatedIdx += numSamples;
-        return;
-    }
-
-    // Standard looping of the generated trajectory
-    else if (generatedIdx > -1 && (!isAgentPaused || isGeneratedLooping)){
-        // Loop generated
-        if(genIdx + numSamples > generatedBuffer->getNumSamples()){
-            generatedIdx = genIdx = 0;
-        }
-        bufferToFill.buffer->clear(0, numSamples);
-        bufferToFill.buffer->addFrom(0, 0, *generatedBuffer, 0, genIdx, numSamples);
-        bufferToFill.buffer->addFrom(1, 0, *generatedBuffer, 1, genIdx, numSamples);
-        generatedIdx += numSamples;
-        return;
-    }
+    // Measure how much of the real-time budget this callback uses
+    const AudioCallbackMetrics::ScopedMeasurement measurement (callbackMetrics, bufferToFill.buffer->getNumSamples());
 
-    // Nothing, output silence
-    else {
-        // Disable feedback
-        bufferToFill.buffer->clear();
-    }
-
-    canSetGeneratedIdx = true;
+    // All playback and recording is handled by the playback state machine
+    session->process(*bufferToFill.buffer, bufferToFill.buffer->getNumSamples());
 }
 
 void MainComponent::releaseResources()
@@ -281,7 +184,7 @@ void MainComponent::initialiseGUI(){
     // Create initial random trajectory
     // Only execute if db is populated
     if(dbConnector->isPopulated()){
-        traverser->generateRandomTrajectory();
+        session->getTraverser().generateRandomTrajectory();
     }
 
     // No button
@@ -349,49 +252,45 @@ void MainComponent::initialiseGUI(){
 
 void MainComponent::buttonClicked(juce::Button *button) {
     if(button == recordButton.get()){
-        isRecording = true;
+        session->getPlaybackEngine().post(PlaybackEngine::Command::Type::record);
         recordButton->setButtonText("Recording...");
         repaint();
-        recordingBuffer->clear();
-        recordingIdx = 0;
     }
     if(button == playButton.get()){
-        // Reset generated buffer index -> plays the current trajectory
-        if(generatedIdx > 0){
-            generatedIdx = -1;
+        // Restart playback of the current trajectory, or stop it if it is playing
+        PlaybackEngine::Mode mode = session->getPlaybackEngine().getState().mode;
+        bool isPlaying = mode == PlaybackEngine::Mode::playingOnce || mode == PlaybackEngine::Mode::looping;
+        if(isPlaying || isGeneratedLooping){
+            session->getPlaybackEngine().post(PlaybackEngine::Command::Type::stop);
             playButton->setButtonText("Play");
+            isGeneratedLooping = false;
         }
         else {
-            generatedIdx = 0;
+            // While the agent is running its trajectories are looped
+            session->getPlaybackEngine().post(isAgentPaused ? PlaybackEngine::Command::Type::playOnce : PlaybackEngine::Command::Type::loop);
             playButton->setButtonText("Stop");
         }
-
-        if (isGeneratedLooping){
-            playButton->setButtonText("Play");
-            isGeneratedLooping = false;
-            generatedIdx = -1;
-        }
     }
     if(button == noButton.get()){
         // Apply feedback
         OSCMessage msgOut = OSCMessage("/reward");
         msgOut.addInt32(-1);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
     }
     if(button == yesButton.get()){
         OSCMessage msgOut = OSCMessage("/reward");
         msgOut.addInt32(1);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
     }
     if(button == superdislikeButton.get()){
         OSCMessage msgOut = OSCMessage("/super_like");
         msgOut.addInt32(-1);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
     }
     if(button == superlikeButton.get()){
         OSCMessage msgOut = OSCMessage("/super_like");
         msgOut.addInt32(1);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
     }
     if(button == runAgentButton.get()){
         isGeneratedLooping = false;
@@ -399,78 +298,45 @@ void MainComponent::buttonClicked(juce::Button *button) {
         if(isAgentPaused){
             runAgentButton->setColour(TextButton::buttonColourId, black);
             runAgentButton->setButtonText("Run agent");
-            generatedIdx = -1;
+            session->getPlaybackEngine().post(PlaybackEngine::Command::Type::stop);
         } else {
             runAgentButton->setColour(TextButton::buttonColourId, playButtonBackground);
             runAgentButton->setButtonText("Agent running...");
-            while(!canSetGeneratedIdx){
-                std::this_thread::sleep_for(10ms);
-            }
-            generatedIdx = 0;
+            session->getPlaybackEngine().post(PlaybackEngine::Command::Type::loop);
         }
         repaint();
 
         // Pause/unpause RL agent
         OSCMessage msgOut = OSCMessage("/pause");
         msgOut.addInt32(isAgentPaused);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
     }
     if(button == exploreButton.get()){
         OSCMessage msgOut = OSCMessage("/explore_state");
         msgOut.addInt32(1);
-        sender.send(msgOut);
+        session->sendToAgent(msgOut);
 
         exploreButton->setButtonText("Exploring...");
         repaint();
     }
     if(button == resetButton.get()){
         OSCMessage message = OSCMessage("/restart_script");
-        sender.send(message);
+        session->sendToAgent(message);
 
         // Stop playing
-        generatedIdx = -1;
+        session->getPlaybackEngine().post(PlaybackEngine::Command::Type::stop);
     }
 }
 
-void MainComponent::oscMessageReceived (const juce::OSCMessage& message){
-    String address = message.getAddressPattern().toString();
+void MainComponent::registerOSCHandlers(){
+    using Context = OSCDispatcher::Context;
+    OSCDispatcher& oscDispatcher = session->getDispatcher();
 
-    if(address == "/params"){
-        // Handle new set of grain parameters
-        vector<float> params;
-        for(const auto & element : message){
-            params.emplace_back(element.getFloat32());
-        }
-        // Generate new grain trajectory from RL parameters
-        traverser->generateTrajectoryFromParams(params);
-
-        fprintf(stdout, "New trajectory from RL params created.\n");
-        // Notify RL agent that we are ready to receive the next trajectory
-        OSCMessage msgOut = OSCMessage("/juce_ready_for_next");
-        sender.send(msgOut);
-    }
-
-    if(address == "/osc_from_js"){
-        // Handle incoming OSC data from mobile JS interface:
-        // This is for playback of an existing trajectory. We want to loop a grain based on the
-        // phone orientation. Through tilting the phone users can "go along" a trajectory.
-        // First, map the incoming value (in the range of [0...1]) to nearest grain start index
-        float incoming = message[0].getFloat32();
-        loopingGrainStartIdx = static_cast<int>(mapFloat(incoming, 0.0f, 1.0f, 0.0f, static_cast<float>(GRAINS_IN_TRAJECTORY - 1))) * GRAIN_LENGTH;
-        loopingGrainEndIdx = loopingGrainStartIdx + GRAIN_LENGTH;
-    }
-    if(address == "/osc_from_js_is_looping"){
-        isLooping = message[0].getInt32() != 0;
-        if(isLooping){
-            generatedIdx = loopingGrainStartIdx;
-        } else {
-            generatedIdx = -1;
-        }
-    }
-    if(address == "/osc_from_js_play"){
+    // Message thread: The mobile interface presses the GUI buttons
+    oscDispatcher.addHandler("/osc_from_js_play", Context::messageThread, [this] (const OSCMessage&) {
         playButton->triggerClick();
-    }
-    if(address == "/osc_from_js_agent_feedback"){
+    });
+    oscDispatcher.addHandler("/osc_from_js_agent_feedback", Context::messageThread, [this] (const OSCMessage& message) {
         // -1 for negative, 1 for positive
         int feedback = message[0].getInt32();
         if(feedback == -1){
@@ -478,8 +344,8 @@ void MainComponent::oscMessageReceived (const juce::OSCMessage& message){
         } else {
             yesButton->triggerClick();
         }
-    }
-    if(address == "/osc_from_js_agent_zone_feedback"){
+    });
+    oscDispatcher.addHandler("/osc_from_js_agent_zone_feedback", Context::messageThread, [this] (const OSCMessage& message) {
         // Apply zone feedback
         int feedback = message[0].getInt32();
         if(feedback == -1){
@@ -487,60 +353,22 @@ void MainComponent::oscMessageReceived (const juce::OSCMessage& message){
         } else {
             superlikeButton->triggerClick();
         }
-    }
-    if(address == "/osc_from_js_pause_agent"){
+    });
+    oscDispatcher.addHandler("/osc_from_js_pause_agent", Context::messageThread, [this] (const OSCMessage&) {
         runAgentButton->triggerClick();
-    }
-    if(address == "/osc_from_js_record_in_JUCE"){
+    });
+    oscDispatcher.addHandler("/osc_from_js_record_in_JUCE", Context::messageThread, [this] (const OSCMessage&) {
         // Start recording
         recordButton->triggerClick();
-    }
-    if(address == "/osc_from_js_explore"){
+    });
+    oscDispatcher.addHandler("/osc_from_js_explore", Context::messageThread, [this] (const OSCMessage&) {
         // Change zone
         exploreButton->triggerClick();
-    }
-    if(address == "/explore_state_done"){
+    });
+    oscDispatcher.addHandler("/explore_state_done", Context::messageThread, [this] (const OSCMessage&) {
         exploreButton->setButtonText("Explore");
         repaint();
-    }
-
-    // -------------------------------------------------------------------------------------------------------------------
-    // IMPORTANT NOTE: THE FOLLOWING 4 ADDRESSES ARE CURRENTLY NOT USED since phone audio data is pretty bad
-    // The original intent of those was to send recorded audio data FROM THE PHONE to the JUCE application via osc.
-    // Turns out that the resulting audio contains loads of noise, hence not particularly useful for priming the agent
-    if(address == "/osc_from_js_clear_recording_buffer"){
-        recordingBuffer->clear();
-        oscCounter = 0;
-    }
-    int messageSize = 100;
-    if(address == "/osc_from_js_left_channel_data"){
-        oscCounter++;
-        int bufferIdx = message[0].getInt32();
-        recordingBuffer->clear(0, bufferIdx, messageSize);
-        for(int i = 1; i < message.size(); i++){
-            recordingBuffer->addSample(0, bufferIdx++, message[i].getFloat32());
-        }
-    }
-    if(address == "/osc_from_js_right_channel_data"){
-        oscCounter++;
-        int bufferIdx = message[0].getInt32();
-        recordingBuffer->clear(1, bufferIdx, messageSize);
-        for(int i = 1; i < message.size(); i++){
-            recordingBuffer->addSample(1, bufferIdx++, message[i].getFloat32());
-        }
-    }
-    if(address == "/osc_from_js_audio_transmission_done"){
-        fprintf(stdout, "OSC done, floats received: %i / in percent: %f", oscCounter * messageSize, (static_cast<float>(oscCounter * messageSize) / (2.0f * 74496.0f)));
-        fprintf(stdout, "\n");
-        // Change button text back
-
-        repaint();
-
-        // Generate new grain trajectory from recorded audio
-        traverser->generateTrajectoryFromAudio(*recordingBuffer);
-        primeTrajectory();
-    }
-    // -------------------------------------------------------------------------------------------------------------------
+    });
 }
 
 bool MainComponent::keyPressed(const KeyPress &key, Component *originatingComponent) {
@@ -572,7 +400,7 @@ bool MainComponent::keyPressed(const KeyPress &key, Component *originatingCompon
     }
     if(key.getTextCharacter() == 'p'){
         // Start recorded playback
-        recordingIdx = 0;
+        session->getPlaybackEngine().post(PlaybackEngine::Command::Type::playRecording);
     }
     if(key.getTextCharacter() == 't'){
         primeTrajectory();
@@ -584,13 +412,45 @@ bool MainComponent::keyPressed(const KeyPress &key, Component *originatingCompon
         // Loop generated
         isGeneratedLooping = !isGeneratedLooping;
         if(isGeneratedLooping){
-            generatedIdx = 0;
+            session->getPlaybackEngine().post(PlaybackEngine::Command::Type::loop);
             playButton->setButtonText("Looping...");
         } else {
-            generatedIdx = -1;
+            session->getPlaybackEngine().post(PlaybackEngine::Command::Type::stop);
             playButton->setButtonText("Play");
         }
     }
+    if(key.getTextCharacter() == 'v'){
+        // Toggle between greedy and Viterbi trajectory search
+        bool isViterbi = session->getTraverser().getSearchMode() == Traverser::SearchMode::viterbi;
+        session->getTraverser().setSearchMode(isViterbi ? Traverser::SearchMode::greedy : Traverser::SearchMode::viterbi);
+        logMessage(isViterbi ? "Search mode: greedy" : "Search mode: viterbi");
+    }
+    if(key.getTextCharacter() == 'i'){
+        // Toggle streaming ("infinite trajectory") mode
+        if(session->getGrainStream().isActive()){
+            session->getGrainStream().stop();
+            logMessage("Streaming stopped, underruns: " + String(session->getGrainStream().getNumUnderruns()));
+        } else {
+            session->getGrainStream().start();
+            logMessage("Streaming started");
+        }
+    }
+    if(key.getTextCharacter() == 'g'){
+        // Toggle granular playback
+        bool isGranular = session->getPlaybackEngine().getState().mode == PlaybackEngine::Mode::granular;
+        session->getPlaybackEngine().post(isGranular ? PlaybackEngine::Command::Type::stop : PlaybackEngine::Command::Type::granular);
+        logMessage(isGranular ? "Granular playback stopped" : "Granular playback started");
+    }
+    if(key.getTextCharacter() == 'm'){
+        // Show audio callback metrics
+        logMessage(callbackMetrics.getSnapshot().toString());
+    }
+    if(key.getTextCharacter() == 'b'){
+        // Benchmark trajectory search
+        logMessage(session->getTraverser().benchmarkSearch(20, 10));
+        logMessage(session->getTraverser().benchmarkSearch(100, 10));
+        logMessage(session->getTraverser().benchmarkTimbreSearch(20, 100));
+    }
     if(key.getKeyCode() == KeyPress::backspaceKey){
         resetButton->triggerClick();
     }
@@ -608,13 +468,14 @@ void MainComponent::showConnectionErrorMessage (const juce::String& messageText)
     juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,"Connection error", messageText,"OK");
 }
 
-void MainComponent::handleAsyncUpdate(){
-    if(isRecording){
+void MainComponent::playbackStateChanged(){
+    PlaybackEngine::State state = session->getPlaybackEngine().getState();
+    if(state.mode == PlaybackEngine::Mode::recording){
         recordButton->setButtonText("Recording...");
     } else {
         recordButton->setButtonText("Record");
     }
-    if(generatedIdx == -1 && !isGeneratedLooping){
+    if(state.position == -1 && !isGeneratedLooping){
         playButton->setButtonText("Play");
     } else if(isGeneratedLooping){
         playButton->setButtonText("Looping...");
@@ -622,29 +483,27 @@ void MainComponent::handleAsyncUpdate(){
         playButton->setButtonText("Stop");
     }
     repaint();
-
-    if(shouldPrimeTrajectory){
-        shouldPrimeTrajectory = false;
-        // Generate trajectory from audio
-        traverser->generateTrajectoryFromAudio(*recordingBuffer);
-        // Send to RL
-        primeTrajectory();
-    }
 }
 
-void MainComponent::primeTrajectory() {
-    // Create grains from recording and send to RL agent
-    OSCMessage message = OSCMessage("/prime_trajectory");
-
-    // Convert recording buffer to grains
-    vector<float> data = traverser->convertAudioBufferToRLFormat(*recordingBuffer);
+void MainComponent::timerCallback() {
+    AudioCallbackMetrics::Snapshot metrics = callbackMetrics.getSnapshot();
 
-    // Each attribute of each grain is one message argument
-    for(auto& entry : data){
-        message.addFloat32(entry);
+    // Report new overruns in the diagnostics box
+    if(metrics.numOverruns > numReportedOverruns){
+        logMessage("Audio callback overrun (" + String(metrics.numOverruns - numReportedOverruns) + " new)\n" + metrics.toString());
+        numReportedOverruns = metrics.numOverruns;
     }
 
-    sender.send(message);
+    // Publish over OSC
+    session->sendMetrics(metrics);
+}
+
+void MainComponent::primeTrajectory() {
+    // Send the grains of the last recording to RL agent, they were analysed while recording
+    vector<Grain> grains;
+    vector<float> timbre;
+    session->getRecordingWorker().getLastRecording(grains, timbre);
+    session->primeTrajectory(grains);
 }
 
 void MainComponent::setupDiagnosticsAndDeviceManager(){
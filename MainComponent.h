@@ -2,6 +2,7 @@
 #ifndef DMLAP_BACKEND_MAIN_H
 #define DMLAP_BACKEND_MAIN_H
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <juce_gui_extra/juce_gui_extra.h>
@@ -11,8 +12,8 @@
 #include "external_libraries/essentia/include/algorithmfactory.h"
 #include "DataLoaderPanel.h"
 #include "DBConnector.h"
-#include "Analyser.h"
-#include "Traverser.h"
+#include "AgentSession.h"
+#include "AudioCallbackMetrics.h"
 #include "Constants.h"
 #include "Utility.h"
 #include "MyLookAndFeel.h"
@@ -31,10 +32,8 @@ class MainComponent  :
         public juce::AudioAppComponent,
         public juce::ChangeListener,
         public juce::Button::Listener,
-        public AsyncUpdater,
-        private OSCReceiver,
-        private OSCReceiver::ListenerWithOSCAddress<OSCReceiver::MessageLoopCallback>,
-        public KeyListener
+        public KeyListener,
+        private juce::Timer
 {
 public:
     //==============================================================================
@@ -43,9 +42,8 @@ public:
 
     //==============================================================================
     /**
-     * This is the main "initialise" method of the MainComponent. It is called every time the audio context changes
-     * i.e. the audio device changes, switching to headphones, etc. When it is called it initialises all the sub-components
-     * (Analyser, Traverser, DBConnector)
+     * Called every time the audio context changes i.e. the audio device changes, switching to headphones, etc.
+     * The sub-components already exist (see createComponents), this only adapts the analysis to the new sample rate.
      * @param samplesPerBlockExpected Samples per audio block of the new context
      * @param sampleRate Audio sample rate of the new context
      */
@@ -82,35 +80,36 @@ public:
     bool keyPressed(const KeyPress &key, Component *originatingComponent) override;
 
     /**
-     * Callback for handling asynchronous UI updates
+     * Callback for handling asynchronous UI updates when the audio thread changed the playback state on its own
      */
-    void handleAsyncUpdate() override;
+    void playbackStateChanged();
 
 private:
+    /**
+     * Periodically publishes the audio callback metrics
+     */
+    void timerCallback() override;
+
+    /**
+     * Create all sub-components (DBConnector, the agent session with its analyser, traverser, workers and playback
+     * engine) and the GUI. Called from the constructor before the audio device is opened and the OSC handlers are
+     * connected, since both use them.
+     */
+    void createComponents();
+
     //==============================================================================
     // DB connection
     unique_ptr<DBConnector> dbConnector;
-    // The data loader panel component
+    // Everything the RL agent talks to: OSC, analyser, traverser, workers and the playback engine (destroyed before the
+    // database, after the audio device was shut down)
+    unique_ptr<AgentSession> session;
+    // The data loader panel component (uses the session's analyser and traverser)
     unique_ptr<DataLoaderPanel> dataLoaderPanel;
-    // The analyser (for calculating audio features)
-    unique_ptr<Analyser> analyser;
-    // The traverser (for creating trajectories through the grain sound space)
-    unique_ptr<Traverser> traverser;
-
-    // Audio data of the generated trajectory grains
-    unique_ptr<AudioBuffer<float>> generatedBuffer;
-    // Grain data of the generated trajectory grains
-    vector<Grain> generatedGrains;
-    // Current index of the generatedBuffer audio buffer
-    atomic<int> generatedIdx;
-
-    // Flag for checking if we're currently looping (i.e. playing with the little ball thingimajic) via the MOBILE OSC interface
-    bool isLooping = false;
-    int loopingGrainStartIdx = -1;
-    int loopingGrainEndIdx = -1;
-
-    // Flag for checking whether generated buffer is currently looping
-    // This is mainly for listening to created loops
+    // Sample rate the analysis is initialised with until the audio device reports its own
+    double defaultSampleRate = 44100.0;
+
+    // Flag for checking whether generated buffer is currently looping (message thread only, the audio thread
+    // only knows about its playback mode). This is mainly for listening to created loops
     bool isGeneratedLooping = false;
 
     // GUI
@@ -139,25 +138,28 @@ private:
     void initialiseGUI();
 
     // OSC for communication with python RL agent
-    OSCSender sender;
     int oscSenderPort = 5005;
     int oscListeningPort = 12000;
     void showConnectionErrorMessage (const String& messageText);
-    void oscMessageReceived (const juce::OSCMessage& message) override;
-    int oscCounter = 0;
+    /**
+     * Register the handlers of the addresses that control the GUI with the session's dispatcher, the agent protocol
+     * itself is handled by the session
+     */
+    void registerOSCHandlers();
 
     // RL management
     bool isAgentPaused = true;
-    bool shouldPrimeTrajectory = false;
     /**
      * Prime RL agent with current trajectory
      */
     void primeTrajectory();
 
-    // Recording audio
-    unique_ptr<AudioBuffer<float>> recordingBuffer;
-    atomic<int> recordingIdx;
-    bool isRecording = false;
+    // Audio callback performance counters, written by the audio thread
+    AudioCallbackMetrics callbackMetrics;
+    // Number of overruns already reported in the diagnostics box
+    int64 numReportedOverruns = 0;
+    // How often the metrics are sent over OSC (milliseconds)
+    int metricsInterval = 1000;
 
     // Audio device manager
     bool isManagerVisible = false;
@@ -168,9 +170,6 @@ private:
     juce::TextEditor diagnosticsBox;
     void changeListenerCallback(ChangeBroadcaster*) override;
 
-    // Thread safety
-    atomic<bool> canSetGeneratedIdx;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
 
@@ -0,0 +1,47 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "NullAudioDriver.h"
+
+NullAudioDriver::NullAudioDriver(AudioSource& source, double sampleRate, int blockSize, int numChannels)
+: source(source), sampleRate(sampleRate), blockSize(blockSize) {
+    buffer.setSize(numChannels, blockSize);
+}
+
+NullAudioDriver::~NullAudioDriver() {
+    stop();
+}
+
+void NullAudioDriver::start() {
+    source.prepareToPlay(blockSize, sampleRate);
+    numBlocksRendered = 0;
+    startTimeMs = Time::getMillisecondCounterHiRes();
+    startTimer(1);
+}
+
+void NullAudioDriver::stop() {
+    if(!isTimerRunning()){
+        return;
+    }
+    stopTimer();
+    source.releaseResources();
+}
+
+int64 NullAudioDriver::getNumBlocksRendered() const {
+    return numBlocksRendered;
+}
+
+void NullAudioDriver::hiResTimerCallback() {
+    // Catch up with the wall clock
+    const double elapsedMs = Time::getMillisecondCounterHiRes() - startTimeMs;
+    const auto blocksDue = static_cast<int64>(elapsedMs * 0.001 * sampleRate / blockSize);
+
+    while(numBlocksRendered < blocksDue){
+        // Like a real device: The buffer holds the (silent) input on entry
+        buffer.clear();
+        AudioSourceChannelInfo info (&buffer, 0, blockSize);
+        source.getNextAudioBlock(info);
+        numBlocksRendered++;
+    }
+}
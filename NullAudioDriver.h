@@ -0,0 +1,64 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_NULLAUDIODRIVER_H
+#define DMLAP_BACKEND_NULLAUDIODRIVER_H
+
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Stand-in for an audio device on machines without a sound card: Pulls blocks from an AudioSource at the real-time rate
+ * from a high resolution timer thread. The timer ticks every millisecond and renders as many blocks as the wall clock
+ * demands, so the average rate is exact even for blocks shorter than a timer period. The rendered audio is discarded
+ * (the source can write it to a file if needed).
+ */
+class NullAudioDriver : private HighResolutionTimer {
+public:
+    /**
+     * @param source
+     * @param sampleRate
+     * @param blockSize
+     * @param numChannels Number of output channels the source renders
+     */
+    NullAudioDriver(AudioSource& source, double sampleRate, int blockSize, int numChannels = 2);
+    ~NullAudioDriver() override;
+
+    /**
+     * Prepare the source and start pulling blocks
+     */
+    void start();
+
+    /**
+     * Stop pulling blocks and release the source
+     */
+    void stop();
+
+    /**
+     * Number of blocks rendered since start()
+     * @return The number of blocks
+     */
+    int64 getNumBlocksRendered() const;
+
+private:
+    void hiResTimerCallback() override;
+
+    AudioSource& source;
+    double sampleRate;
+    int blockSize;
+    AudioBuffer<float> buffer;
+
+    // Wall clock time of start() and number of blocks rendered since then
+    double startTimeMs = 0.0;
+    atomic<int64> numBlocksRendered { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NullAudioDriver)
+};
+
+
+#endif //DMLAP_BACKEND_NULLAUDIODRIVER_H
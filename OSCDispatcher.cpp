@@ -0,0 +1,115 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "OSCDispatcher.h"
+
+OSCDispatcher::OSCDispatcher() {
+    OSCReceiver::addListener(this);
+}
+
+OSCDispatcher::~OSCDispatcher() {
+    disconnect();
+    OSCReceiver::removeListener(this);
+}
+
+void OSCDispatcher::addHandler(const String& address, Context context, Handler handler) {
+    Route& route = routes[address];
+    route.context = context;
+    route.handler = std::move(handler);
+}
+
+bool OSCDispatcher::connect(int port) {
+    isAccepting = true;
+    return OSCReceiver::connect(port);
+}
+
+void OSCDispatcher::disconnect() {
+    // Joins the receiver thread, so no receiver thread handler is running after this
+    OSCReceiver::disconnect();
+
+    isAccepting = false;
+    cancelPendingUpdate();
+    const ScopedLock sl (queueLock);
+    pendingMessages.clear();
+    for(Route* route : pendingCoalesced){
+        route->latest = nullptr;
+    }
+    pendingCoalesced.clear();
+}
+
+void OSCDispatcher::dispatch(const OSCMessage& message) {
+    if(!isAccepting){
+        return;
+    }
+    auto it = routes.find(message.getAddressPattern().toString());
+    if(it == routes.end()){
+        return;
+    }
+    Route& route = it->second;
+
+    switch(route.context){
+        case Context::receiverThread:
+            route.handler(message);
+            return;
+        case Context::messageThread: {
+            const ScopedLock sl (queueLock);
+            pendingMessages.emplace_back(&route, message);
+            break;
+        }
+        case Context::coalesced: {
+            const ScopedLock sl (queueLock);
+            if(route.latest != nullptr){
+                // The previous value was never handled, only the latest one matters
+                *route.latest = message;
+                numCoalescedMessages++;
+                return;
+            }
+            route.latest = make_unique<OSCMessage>(message);
+            pendingCoalesced.emplace_back(&route);
+            break;
+        }
+    }
+    triggerAsyncUpdate();
+}
+
+int OSCDispatcher::getNumCoalescedMessages() const {
+    return numCoalescedMessages;
+}
+
+void OSCDispatcher::oscMessageReceived(const OSCMessage& message) {
+    dispatch(message);
+}
+
+void OSCDispatcher::oscBundleReceived(const OSCBundle& bundle) {
+    for(const auto& element : bundle){
+        if(element.isMessage()){
+            dispatch(element.getMessage());
+        } else if(element.isBundle()){
+            oscBundleReceived(element.getBundle());
+        }
+    }
+}
+
+void OSCDispatcher::handleAsyncUpdate() {
+    // Take everything that arrived so far, the handlers run without holding the lock
+    deque<pair<Route*, OSCMessage>> messages;
+    vector<unique_ptr<OSCMessage>> coalesced;
+    vector<Route*> coalescedRoutes;
+    {
+        const ScopedLock sl (queueLock);
+        messages.swap(pendingMessages);
+        for(Route* route : pendingCoalesced){
+            coalesced.emplace_back(std::move(route->latest));
+            coalescedRoutes.emplace_back(route);
+        }
+        pendingCoalesced.clear();
+    }
+
+    for(auto& entry : messages){
+        entry.first->handler(entry.second);
+    }
+    for(size_t i = 0; i < coalesced.size(); i++){
+        coalescedRoutes[i]->handler(*coalesced[i]);
+    }
+}
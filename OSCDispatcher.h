@@ -0,0 +1,106 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_OSCDISPATCHER_H
+#define DMLAP_BACKEND_OSCDISPATCHER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_osc/juce_osc.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Receives OSC messages on the receiver's own thread (instead of queueing every packet onto the message loop) and
+ * dispatches them through a hash map from address to handler. Each handler says where it runs:
+ *   receiverThread: Directly on the receiving thread. Only for handlers that are thread-safe and quick (atomics,
+ *                   locked queues), these never wait for the GUI.
+ *   messageThread:  Queued for the message thread in arrival order, for anything that touches the UI or state owned
+ *                   by the message thread.
+ *   coalesced:      Message thread, but only the latest message per address is kept until the message thread gets to
+ *                   it, for high-rate controls where only the current value matters.
+ * Messages from other transports (e.g. shared memory) can be fed in via dispatch().
+ */
+class OSCDispatcher : private OSCReceiver,
+                      private OSCReceiver::Listener<OSCReceiver::RealtimeCallback>,
+                      private AsyncUpdater {
+public:
+    enum class Context { receiverThread, messageThread, coalesced };
+    using Handler = std::function<void(const OSCMessage&)>;
+
+    OSCDispatcher();
+    ~OSCDispatcher() override;
+
+    /**
+     * Register the handler for an address. All handlers must be added before connecting.
+     * @param address The full OSC address, e.g. "/params"
+     * @param context Where the handler runs
+     * @param handler
+     */
+    void addHandler(const String& address, Context context, Handler handler);
+
+    /**
+     * Start receiving
+     * @param port UDP port
+     * @return False if the port could not be opened
+     */
+    bool connect(int port);
+
+    /**
+     * Stop receiving and drop all messages that have not been handled yet. After this returns no handler is called.
+     */
+    void disconnect();
+
+    /**
+     * Route a message to its handler (any thread). Messages for unknown addresses are ignored.
+     * @param message
+     */
+    void dispatch(const OSCMessage& message);
+
+    /**
+     * Number of messages replaced by a newer one before the message thread handled them
+     * @return The number of coalesced messages
+     */
+    int getNumCoalescedMessages() const;
+
+private:
+    void oscMessageReceived(const OSCMessage& message) override;
+    void oscBundleReceived(const OSCBundle& bundle) override;
+    void handleAsyncUpdate() override;
+
+    struct Route {
+        Context context;
+        Handler handler;
+        // Coalesced routes: Latest message not handled yet, guarded by queueLock
+        unique_ptr<OSCMessage> latest;
+    };
+
+    struct AddressHash {
+        size_t operator()(const String& address) const noexcept { return static_cast<size_t>(address.hashCode64()); }
+    };
+
+    // Address -> route, read-only once connected
+    unordered_map<String, Route, AddressHash> routes;
+
+    // Messages waiting for the message thread, guarded by queueLock
+    CriticalSection queueLock;
+    deque<pair<Route*, OSCMessage>> pendingMessages;
+    vector<Route*> pendingCoalesced;
+    // Cleared on disconnect
+    atomic<bool> isAccepting { true };
+
+    atomic<int> numCoalescedMessages { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OSCDispatcher)
+};
+
+
+#endif //DMLAP_BACKEND_OSCDISPATCHER_H
@@ -0,0 +1,129 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "OfflineRenderer.h"
+
+class OfflineRenderer::Worker : public ThreadPoolJob {
+public:
+    Worker(DBConnector& dbConnector, const vector<Job>& jobs, atomic<int>& nextJob, double sampleRate)
+    : ThreadPoolJob("Offline render worker"), jobs(jobs), nextJob(nextJob), sampleRate(sampleRate),
+      analyser(dbConnector), trajectory(2, MAX_TRAJECTORY_SAMPLES), traverser(dbConnector, analyser, trajectory, target) {
+    }
+
+    JobStatus runJob() override {
+        // Take jobs until all are taken, so that fast and slow trajectories balance out across the threads
+        for(int jobIdx = nextJob++; jobIdx < static_cast<int>(jobs.size()); jobIdx = nextJob++){
+            if(shouldExit()){
+                break;
+            }
+            if(renderJob(jobs[static_cast<size_t>(jobIdx)])){
+                numWritten++;
+            } else {
+                numFailed++;
+            }
+        }
+        return jobHasFinished;
+    }
+
+    int numWritten = 0;
+    int numFailed = 0;
+    int64 numSamplesWritten = 0;
+
+private:
+    bool renderJob(const Job& job) {
+        if(!traverser.generateTrajectoryFromParams(job.params, job.grainLength)){
+            return false;
+        }
+        // This thread is writer and reader of its trajectory buffer
+        trajectory.swapInLatest();
+        const AudioBuffer<float>& buffer = trajectory.getFrontBuffer();
+        const int numSamples = trajectory.getFrontLayout().getNumSamples();
+
+        job.outputFile.deleteFile();
+        unique_ptr<FileOutputStream> stream = job.outputFile.createOutputStream();
+        if(stream == nullptr || !stream->openedOk()){
+            return false;
+        }
+        WavAudioFormat wavFormat;
+        unique_ptr<AudioFormatWriter> writer (wavFormat.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+        if(writer == nullptr){
+            return false;
+        }
+        // The writer owns the stream now
+        stream.release();
+        if(!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples)){
+            return false;
+        }
+        numSamplesWritten += numSamples;
+        return true;
+    }
+
+    const vector<Job>& jobs;
+    atomic<int>& nextJob;
+    double sampleRate;
+
+    // Private rendering context, reused for every trajectory of this worker
+    Analyser analyser;
+    TrajectoryBuffer trajectory;
+    vector<Grain> target;
+    Traverser traverser;
+};
+
+OfflineRenderer::OfflineRenderer(DBConnector& dbConnector, int numThreads)
+: dbConnector(dbConnector), numThreads(jmax(1, numThreads)) {
+}
+
+OfflineRenderer::Summary OfflineRenderer::render(const vector<Job>& jobs, double sampleRate) {
+    const double startTime = Time::getMillisecondCounterHiRes();
+    atomic<int> nextJob { 0 };
+
+    const int numWorkers = jmin(numThreads, static_cast<int>(jobs.size()));
+    ThreadPool pool (jmax(1, numWorkers));
+    vector<unique_ptr<Worker>> workers;
+    for(int i = 0; i < numWorkers; i++){
+        workers.emplace_back(make_unique<Worker>(dbConnector, jobs, nextJob, sampleRate));
+        pool.addJob(workers.back().get(), false);
+    }
+
+    Summary summary;
+    int64 numSamplesWritten = 0;
+    for(auto& worker : workers){
+        pool.waitForJobToFinish(worker.get(), -1);
+        summary.numWritten += worker->numWritten;
+        summary.numFailed += worker->numFailed;
+        numSamplesWritten += worker->numSamplesWritten;
+    }
+
+    summary.seconds = (Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    if(summary.seconds > 0.0){
+        summary.speedFactor = static_cast<double>(numSamplesWritten) / sampleRate / summary.seconds;
+    }
+    return summary;
+}
+
+vector<OfflineRenderer::Job> OfflineRenderer::readJobs(const File& paramsFile, const File& outputDirectory, int grainLength) {
+    vector<Job> jobs;
+    outputDirectory.createDirectory();
+
+    StringArray lines;
+    paramsFile.readLines(lines);
+    for(int lineIdx = 0; lineIdx < lines.size(); lineIdx++){
+        StringArray tokens;
+        tokens.addTokens(lines[lineIdx], " \t,", "");
+        tokens.removeEmptyStrings();
+        if(tokens.isEmpty()){
+            continue;
+        }
+
+        Job job;
+        job.grainLength = grainLength;
+        job.params.reserve(static_cast<size_t>(tokens.size()));
+        for(const auto& token : tokens){
+            job.params.emplace_back(token.getFloatValue());
+        }
+        job.outputFile = outputDirectory.getChildFile("trajectory_" + String(lineIdx + 1).paddedLeft('0', 5) + ".wav");
+        jobs.emplace_back(std::move(job));
+    }
+    return jobs;
+}
@@ -0,0 +1,84 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_OFFLINERENDERER_H
+#define DMLAP_BACKEND_OFFLINERENDERER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+#include "DBConnector.h"
+#include "Analyser.h"
+#include "Traverser.h"
+#include "TrajectoryBuffer.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Renders trajectories from RL parameters straight to WAV files, as fast as the CPU allows instead of in real time.
+ * Trajectories are rendered in parallel on a thread pool. Every pool thread has its own traverser and trajectory
+ * buffer (created once and reused for all trajectories it renders), only the read-only grain database is shared.
+ */
+class OfflineRenderer {
+public:
+    // A single trajectory to render
+    struct Job {
+        // Grain parameters in the same layout as the "/params" OSC message (NUM_FEATURES floats per grain)
+        vector<float> params;
+        // Grain length in samples
+        int grainLength = GRAIN_LENGTH;
+        // Where to write the trajectory to (overwritten if it exists)
+        File outputFile;
+    };
+
+    // Outcome of a batch
+    struct Summary {
+        int numWritten = 0;
+        int numFailed = 0;
+        double seconds = 0.0;
+        // Length of all written audio in seconds, divided by the time it took to render
+        double speedFactor = 0.0;
+    };
+
+    /**
+     * @param dbConnector The grain database
+     * @param numThreads Number of trajectories rendered in parallel
+     */
+    OfflineRenderer(DBConnector& dbConnector, int numThreads);
+
+    /**
+     * Render all jobs and block until they are written
+     * @param jobs
+     * @param sampleRate Sample rate written to the WAV files (grains are not resampled)
+     * @return Summary of the batch
+     */
+    Summary render(const vector<Job>& jobs, double sampleRate);
+
+    /**
+     * Read jobs from a text file with one trajectory per line, the parameters separated by whitespace or commas.
+     * Output files are named "trajectory_<line number>.wav".
+     * @param paramsFile The parameter file
+     * @param outputDirectory Directory for the WAV files (created if needed)
+     * @param grainLength Grain length of all trajectories
+     * @return The jobs, empty lines are skipped
+     */
+    static vector<Job> readJobs(const File& paramsFile, const File& outputDirectory, int grainLength);
+
+private:
+    // Pool job rendering trajectories until there are none left
+    class Worker;
+
+    DBConnector& dbConnector;
+    int numThreads;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
+
+
+#endif //DMLAP_BACKEND_OFFLINERENDERER_H
@@ -0,0 +1,220 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "PQIndex.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// Lloyd iterations when training a subspace
+constexpr int maxTrainIterations = 15;
+
+// Max-heap order: The furthest of the neighbours found so far is on top
+bool isCloser(const PQIndex::Neighbour& a, const PQIndex::Neighbour& b) {
+    return a.distance < b.distance;
+}
+
+}
+
+PQIndex::PQIndex(int dimensions, Metric metric, int numSubspaces)
+    : dimensions(jmax(1, dimensions)), metric(metric) {
+    this->numSubspaces = jlimit(1, this->dimensions, numSubspaces > 0 ? numSubspaces : (this->dimensions + 1) / 2);
+
+    // Spread the dimensions as evenly as possible
+    subspaceStarts.resize(static_cast<size_t>(this->numSubspaces) + 1);
+    for(int j = 0; j <= this->numSubspaces; j++){
+        subspaceStarts[static_cast<size_t>(j)] = j * this->dimensions / this->numSubspaces;
+    }
+    codebooks.assign(static_cast<size_t>(numCentroids) * this->dimensions, 0.0f);
+}
+
+const float* PQIndex::prepare(const float* values, vector<float>& buffer) const {
+    if(metric == Metric::l2){
+        return values;
+    }
+    buffer.assign(values, values + dimensions);
+    const float norm = std::sqrt(VectorKernels::dot(values, values, dimensions));
+    if(norm > 0.0f){
+        for(float& value : buffer){
+            value /= norm;
+        }
+    }
+    return buffer.data();
+}
+
+void PQIndex::train(const vector<float>& sample) {
+    const ScopedWriteLock sl (lock);
+
+    const int numVectors = static_cast<int>(sample.size() / static_cast<size_t>(dimensions));
+    if(numVectors == 0){
+        return;
+    }
+    // Never more centroids than vectors: They would only repeat vectors
+    const int numUsedCentroids = jmin(numCentroids, numVectors);
+
+    // Training set, normalised like the vectors that will be added
+    vector<float> prepared;
+    prepared.reserve(sample.size());
+    vector<float> buffer;
+    for(int v = 0; v < numVectors; v++){
+        const float* values = prepare(sample.data() + static_cast<long>(v) * dimensions, buffer);
+        prepared.insert(prepared.end(), values, values + dimensions);
+    }
+
+    mt19937 random(12345);
+    vector<int> order(static_cast<size_t>(numVectors));
+    vector<float> part;
+    vector<float> distances(numCentroids);
+    vector<int> assignments;
+    vector<int> counts(numCentroids);
+    vector<float> sums;
+    for(int j = 0; j < numSubspaces; j++){
+        const int start = subspaceStarts[static_cast<size_t>(j)];
+        const int width = subspaceStarts[static_cast<size_t>(j) + 1] - start;
+        float* centroids = codebooks.data() + static_cast<long>(numCentroids) * start;
+
+        // The parts of this subspace, contiguous
+        part.resize(static_cast<size_t>(numVectors) * width);
+        for(int v = 0; v < numVectors; v++){
+            copy_n(prepared.begin() + static_cast<long>(v) * dimensions + start, width, part.begin() + static_cast<long>(v) * width);
+        }
+
+        // Seed with distinct random parts
+        iota(order.begin(), order.end(), 0);
+        shuffle(order.begin(), order.end(), random);
+        for(int c = 0; c < numUsedCentroids; c++){
+            copy_n(part.begin() + static_cast<long>(order[static_cast<size_t>(c)]) * width, width, centroids + c * width);
+        }
+
+        // Lloyd iterations
+        assignments.assign(static_cast<size_t>(numVectors), -1);
+        for(int iteration = 0; iteration < maxTrainIterations; iteration++){
+            int changed = 0;
+            for(int v = 0; v < numVectors; v++){
+                VectorKernels::squaredL2Rows(part.data() + static_cast<long>(v) * width, centroids, numUsedCentroids, width, width, distances.data());
+                const int closest = static_cast<int>(min_element(distances.begin(), distances.begin() + numUsedCentroids) - distances.begin());
+                if(closest != assignments[static_cast<size_t>(v)]){
+                    assignments[static_cast<size_t>(v)] = closest;
+                    changed++;
+                }
+            }
+            if(changed == 0){
+                break;
+            }
+            // Centroids without parts keep their position
+            fill(counts.begin(), counts.end(), 0);
+            sums.assign(static_cast<size_t>(numCentroids) * width, 0.0f);
+            for(int v = 0; v < numVectors; v++){
+                const int c = assignments[static_cast<size_t>(v)];
+                for(int d = 0; d < width; d++){
+                    sums[static_cast<size_t>(c * width + d)] += part[static_cast<size_t>(v * width + d)];
+                }
+                counts[static_cast<size_t>(c)]++;
+            }
+            for(int c = 0; c < numUsedCentroids; c++){
+                if(counts[static_cast<size_t>(c)] > 0){
+                    for(int d = 0; d < width; d++){
+                        centroids[c * width + d] = sums[static_cast<size_t>(c * width + d)] / static_cast<float>(counts[static_cast<size_t>(c)]);
+                    }
+                }
+            }
+        }
+    }
+    trained = true;
+    numTrainedCentroids = numUsedCentroids;
+    numTrainingVectors = numVectors;
+}
+
+void PQIndex::add(int64 rowId, const float* vector) {
+    const ScopedWriteLock sl (lock);
+    // Without centroids there is no code to store: The owner trains a new index instead (see DBConnector)
+    jassert(trained);
+    if(!trained){
+        return;
+    }
+
+    const float* values = prepare(vector, addBuffer);
+    float distances[numCentroids];
+    for(int j = 0; j < numSubspaces; j++){
+        const int start = subspaceStarts[static_cast<size_t>(j)];
+        const int width = subspaceStarts[static_cast<size_t>(j) + 1] - start;
+        VectorKernels::squaredL2Rows(values + start, codebooks.data() + static_cast<long>(numCentroids) * start,
+                                     numTrainedCentroids, width, width, distances);
+        codes.push_back(static_cast<uint8_t>(min_element(distances, distances + numTrainedCentroids) - distances));
+    }
+    rowIds.push_back(rowId);
+}
+
+void PQIndex::search(const float* query, int k, SearchScratch& scratch, vector<Neighbour>& found) const {
+    const ScopedReadLock sl (lock);
+    found.clear();
+    if(rowIds.empty() || k <= 0){
+        return;
+    }
+
+    // Distance table: Query part to every centroid in use, per subspace (codes never refer to the others)
+    const float* values = prepare(query, scratch.query);
+    scratch.table.resize(static_cast<size_t>(numSubspaces) * numCentroids);
+    for(int j = 0; j < numSubspaces; j++){
+        const int start = subspaceStarts[static_cast<size_t>(j)];
+        const int width = subspaceStarts[static_cast<size_t>(j) + 1] - start;
+        VectorKernels::squaredL2Rows(values + start, codebooks.data() + static_cast<long>(numCentroids) * start,
+                                     numTrainedCentroids, width, width, scratch.table.data() + static_cast<long>(j) * numCentroids);
+    }
+
+    // Scan the codes: One table lookup per subspace. For unit vectors 1 - cosine is half the squared distance.
+    const float scale = metric == Metric::cosine ? 0.5f : 1.0f;
+    const float* table = scratch.table.data();
+    const uint8_t* code = codes.data();
+    const int numCodes = static_cast<int>(rowIds.size());
+    for(int i = 0; i < numCodes; i++, code += numSubspaces){
+        float distance = 0.0f;
+        for(int j = 0; j < numSubspaces; j++){
+            distance += table[j * numCentroids + code[j]];
+        }
+        distance *= scale;
+
+        if(static_cast<int>(found.size()) < k){
+            found.push_back({ distance, rowIds[static_cast<size_t>(i)] });
+            push_heap(found.begin(), found.end(), isCloser);
+        } else if(distance < found.front().distance){
+            pop_heap(found.begin(), found.end(), isCloser);
+            found.back() = { distance, rowIds[static_cast<size_t>(i)] };
+            push_heap(found.begin(), found.end(), isCloser);
+        }
+    }
+    sort_heap(found.begin(), found.end(), isCloser);
+}
+
+int PQIndex::size() const {
+    const ScopedReadLock sl (lock);
+    return static_cast<int>(rowIds.size());
+}
+
+bool PQIndex::isEmpty() const {
+    return size() == 0;
+}
+
+bool PQIndex::isTrained() const {
+    const ScopedReadLock sl (lock);
+    return trained;
+}
+
+int PQIndex::getNumTrainingVectors() const {
+    const ScopedReadLock sl (lock);
+    return numTrainingVectors;
+}
+
+int PQIndex::getNumSubspaces() const {
+    return numSubspaces;
+}
+
+size_t PQIndex::getMemoryBytes() const {
+    const ScopedReadLock sl (lock);
+    return codes.capacity() + rowIds.capacity() * sizeof(int64) + codebooks.size() * sizeof(float);
+}
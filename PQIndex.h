@@ -0,0 +1,135 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_PQINDEX_H
+#define DMLAP_BACKEND_PQINDEX_H
+
+#include <cstdint>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "TimbreIndex.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Compressed timbre search for hosts with little memory: Product quantisation.
+ * Each vector is split into subspaces of (at most) two dimensions, and each part is replaced by the index of the
+ * closest of 256 centroids learned for its subspace. A grain therefore takes numSubspaces bytes of code plus its 8 byte
+ * row id in the database, on top of the codebooks (numSubspaces * 256 centroids of up to two floats), shared by all
+ * grains. Nothing else is kept in memory: Not the vectors, not the grains.
+ * A search builds a table of the distances from the query to every centroid and sums one table entry per subspace for
+ * each code (asymmetric distance computation), which only approximates the true distance. The best matches should be
+ * re-ranked with their exact vectors from the database (DBConnector::queryTimbreRows), which recovers most of the
+ * recall for a few database lookups per query. Traverser::benchmarkTimbreSearch measures memory, recall and latency
+ * against the other timbre searches.
+ * Searches run concurrently with each other; adding a code waits for searches in flight.
+ */
+class PQIndex {
+public:
+    using Metric = TimbreIndex::Metric;
+
+    struct Neighbour {
+        // Approximate distance, like TimbreIndex::Neighbour
+        float distance;
+        // Row id of the grain in the database (the type of sqlite3_int64)
+        int64 rowId;
+    };
+
+    /**
+     * Buffers of a search, owned by the caller so repeated searches don't allocate
+     */
+    struct SearchScratch {
+        vector<float> query;
+        vector<float> table;
+    };
+
+    // Centroids per subspace: Codes are one byte per subspace
+    static constexpr int numCentroids = 256;
+
+    /**
+     * @param dimensions Length of the vectors
+     * @param metric Cosine vectors are normalised, so the distance is half the squared euclidean distance
+     * @param numSubspaces Number of bytes per code, 0 for one subspace per two dimensions
+     */
+    explicit PQIndex(int dimensions, Metric metric = Metric::cosine, int numSubspaces = 0);
+
+    /**
+     * Learn the centroids of every subspace (k-means). Call once, before adding codes.
+     * With fewer vectors than numCentroids, every subspace gets one centroid per vector instead, so the codes of the
+     * sample are exact. The index stays untrained for an empty sample: Train a new index once there are vectors.
+     * @param sample dimensions values per vector, one vector after another: A random sample of the corpus
+     */
+    void train(const vector<float>& sample);
+
+    /**
+     * Add the code of a vector (trained indexes only)
+     * @param rowId Row of the grain in the database
+     * @param vector dimensions values
+     */
+    void add(int64 rowId, const float* vector);
+
+    /**
+     * Find the k codes closest to a query, by approximate distance
+     * @param query dimensions values
+     * @param k Maximum number of neighbours
+     * @param scratch Buffers of the search
+     * @param found Receives the neighbours, closest first (cleared first)
+     */
+    void search(const float* query, int k, SearchScratch& scratch, vector<Neighbour>& found) const;
+
+    int size() const;
+
+    bool isEmpty() const;
+
+    bool isTrained() const;
+
+    /**
+     * Number of vectors train() learned from: Codes of vectors added later are only as good as this sample is
+     * representative of them
+     * @return The size of the training sample
+     */
+    int getNumTrainingVectors() const;
+
+    int getNumSubspaces() const;
+
+    /**
+     * Memory held by the index
+     * @return Bytes of codes, row ids and centroids
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    int dimensions;
+    Metric metric;
+    int numSubspaces;
+    // First dimension of every subspace, and the end of the last one
+    vector<int> subspaceStarts;
+    // Centroids, subspace after subspace: Subspace j has numCentroids rows of its width at numCentroids * start
+    vector<float> codebooks;
+    bool trained = false;
+    // Centroids in use per subspace (the first ones of each codebook), fewer than numCentroids for a small sample
+    int numTrainedCentroids = 0;
+    int numTrainingVectors = 0;
+
+    // Codes (numSubspaces bytes each) and the database rows they belong to
+    vector<uint8_t> codes;
+    vector<int64> rowIds;
+
+    // Buffer for normalising vectors that are added
+    vector<float> addBuffer;
+
+    // Searches hold the read lock, add() and train() the write lock
+    ReadWriteLock lock;
+
+    /**
+     * Prepare a vector: Normalised copy for the cosine metric
+     * @return The vector to quantise or compare
+     */
+    const float* prepare(const float* values, vector<float>& buffer) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PQIndex)
+};
+
+#endif //DMLAP_BACKEND_PQINDEX_H
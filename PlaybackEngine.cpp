@@ -0,0 +1,346 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "PlaybackEngine.h"
+
+PlaybackEngine::PlaybackEngine(TrajectoryBuffer& generatedTrajectory, GrainStream& grainStream, RecordingWorker& recordingWorker)
+: generatedTrajectory(generatedTrajectory), recordings(recordingWorker.getRecordings()), grainStream(grainStream),
+  recordingWorker(recordingWorker) {
+    publishedState = State();
+    for(int i = 0; i <= crossfadeTableSize; i++){
+        const float angle = MathConstants<float>::halfPi * static_cast<float>(i) / static_cast<float>(crossfadeTableSize);
+        fadeOutTable[static_cast<size_t>(i)] = std::cos(angle);
+        fadeInTable[static_cast<size_t>(i)] = std::sin(angle);
+    }
+}
+
+PlaybackEngine::~PlaybackEngine() {
+    cancelPendingUpdate();
+}
+
+bool PlaybackEngine::post(const Command& command) {
+    jassert(command.type != Command::Type::stream);
+    if(commandFifo.getFreeSpace() < 1){
+        return false;
+    }
+    if(command.type != Command::Type::setDensity && grainStream.isActive()){
+        // Streaming is left like any other mode. The stream is stopped before the command is queued, so the audio
+        // thread can't see it still running and switch back to it.
+        grainStream.stop();
+    }
+    int start1, size1, start2, size2;
+    commandFifo.prepareToWrite(1, start1, size1, start2, size2);
+    commands[static_cast<size_t>(start1)] = command;
+    commandFifo.finishedWrite(1);
+    return true;
+}
+
+bool PlaybackEngine::post(Command::Type type) {
+    Command command;
+    command.type = type;
+    return post(command);
+}
+
+void PlaybackEngine::setScrubPosition(float normalisedPosition) {
+    scrubTarget = jlimit(0.0f, 1.0f, normalisedPosition);
+}
+
+PlaybackEngine::State PlaybackEngine::getState() const {
+    return publishedState.load();
+}
+
+int PlaybackEngine::getNumActiveVoices() const {
+    return numActiveVoices;
+}
+
+void PlaybackEngine::handleAsyncUpdate() {
+    if(onStateChanged != nullptr){
+        onStateChanged();
+    }
+}
+
+void PlaybackEngine::drainCommands() {
+    int numReady = commandFifo.getNumReady();
+    if(numReady == 0){
+        return;
+    }
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead(numReady, start1, size1, start2, size2);
+    for(int i = 0; i < size1; i++){
+        apply(commands[static_cast<size_t>(start1 + i)]);
+    }
+    for(int i = 0; i < size2; i++){
+        apply(commands[static_cast<size_t>(start2 + i)]);
+    }
+    commandFifo.finishedRead(size1 + size2);
+}
+
+void PlaybackEngine::apply(const Command& command) {
+    if(mode == Mode::granular && command.type != Command::Type::granular && command.type != Command::Type::setDensity){
+        // Leaving granular mode: Let the playing grains fade out
+        voicePool.releaseAll(releaseSamples);
+    }
+    if(mode == Mode::recording && command.type != Command::Type::setDensity){
+        // Any other command (including another record) cuts the recording short. The worker needs to hear about it,
+        // it waits for the end of every recording it was told about.
+        recordingWorker.abort();
+        recordingIdx = -1;
+        // The GUI shows the recording until it is told otherwise
+        isRecordingAborted = true;
+    }
+    switch(command.type){
+        case Command::Type::stop:
+            mode = Mode::stopped;
+            generatedIdx = -1;
+            recordingIdx = -1;
+            break;
+        case Command::Type::playOnce:
+            mode = Mode::playingOnce;
+            generatedIdx = 0;
+            break;
+        case Command::Type::loop:
+            mode = Mode::looping;
+            generatedIdx = 0;
+            break;
+        case Command::Type::scrub:
+            // Start at the current tilt without gliding there from wherever scrubbing stopped last time
+            mode = Mode::scrubbing;
+            scrubPosition = scrubTarget;
+            scrubPhase = 0;
+            break;
+        case Command::Type::record:
+            mode = Mode::recording;
+            recordingIdx = 0;
+            recordingWorker.begin();
+            break;
+        case Command::Type::playRecording:
+            mode = Mode::playingRecording;
+            recordingIdx = 0;
+            break;
+        case Command::Type::granular:
+            if(mode != Mode::granular){
+                mode = Mode::granular;
+                generatedIdx = 0;
+                samplesUntilNextGrain = 0;
+            }
+            break;
+        case Command::Type::setDensity:
+            density = jlimit(0.1f, 256.0f, command.value);
+            break;
+        case Command::Type::stream:
+            mode = Mode::streaming;
+            generatedIdx = -1;
+            recordingIdx = -1;
+            break;
+    }
+}
+
+void PlaybackEngine::copyToOutput(AudioBuffer<float>& output, const AudioBuffer<float>& source, int sourceIdx, int numSamples) {
+    output.copyFrom(0, 0, source, 0, sourceIdx, numSamples);
+    output.copyFrom(1, 0, source, 1, sourceIdx, numSamples);
+}
+
+void PlaybackEngine::process(AudioBuffer<float>& buffer, int numSamples) {
+    drainCommands();
+
+    // Pick up a newly rendered trajectory at the block boundary. The read position is kept, so a trajectory
+    // replaced while looping continues from the same grain.
+    // Voices read straight from the front buffer, and the writer may overwrite it as soon as it is retired: While
+    // grains are playing they are faded out first and the swap waits until the last one has finished.
+    bool isSwapPending = false;
+    if(generatedTrajectory.hasLatest()){
+        if(voicePool.getNumActiveVoices() == 0){
+            generatedTrajectory.swapInLatest();
+        } else {
+            voicePool.releaseAll(releaseSamples);
+            isSwapPending = true;
+        }
+    }
+    const AudioBuffer<float>& generatedBuffer = generatedTrajectory.getFrontBuffer();
+    const int generatedLength = generatedTrajectory.getFrontLayout().getNumSamples();
+    // Same for the last finished recording
+    recordings.swapInLatest();
+    bool changedOnItsOwn = isRecordingAborted;
+    isRecordingAborted = false;
+
+    // A stream started since the last block takes over like a command (a recording is cut short, grains fade out).
+    // Commands to other modes stop the stream before they are posted, so a running stream is the latest request.
+    if(mode != Mode::streaming && grainStream.isActive()){
+        Command command;
+        command.type = Command::Type::stream;
+        apply(command);
+        changedOnItsOwn = true;
+        // apply() reported the aborted recording already
+        isRecordingAborted = false;
+    }
+
+    switch(mode){
+        case Mode::playingOnce:
+            // Normal, linear, one-time playback of trajectory
+            if(generatedIdx + numSamples > generatedLength){
+                mode = Mode::stopped;
+                generatedIdx = -1;
+                changedOnItsOwn = true;
+                buffer.clear();
+                break;
+            }
+            copyToOutput(buffer, generatedBuffer, generatedIdx, numSamples);
+            generatedIdx += numSamples;
+            break;
+
+        case Mode::recording: {
+            // Recording user audio using the computer microphone: The input only goes into the recording worker's ring
+            const int numToRecord = jmin(numSamples, recordingWorker.getRecordingLength() - recordingIdx);
+            recordingWorker.push(buffer, numToRecord);
+            recordingIdx += numToRecord;
+            if(recordingIdx >= recordingWorker.getRecordingLength()){
+                recordingWorker.finish();
+                mode = Mode::stopped;
+                recordingIdx = -1;
+                changedOnItsOwn = true;
+            }
+
+            // Disable feedback
+            buffer.clear();
+            break;
+        }
+
+        case Mode::playingRecording:
+            // Normal playback of recorded user audio
+            if(recordingIdx + numSamples >= recordings.getFrontLayout().getNumSamples()){
+                mode = Mode::stopped;
+                recordingIdx = -1;
+                buffer.clear();
+                break;
+            }
+            copyToOutput(buffer, recordings.getFrontBuffer(), recordingIdx, numSamples);
+            recordingIdx += numSamples;
+            break;
+
+        case Mode::scrubbing:
+            // Looping via the OSC MOBILE WEB interface (i.e. the one on the phone)
+            if(generatedLength == 0){
+                buffer.clear();
+                break;
+            }
+            renderScrub(buffer, generatedBuffer, generatedTrajectory.getFrontLayout(), numSamples);
+            break;
+
+        case Mode::looping:
+            // Standard looping of the generated trajectory
+            if(generatedIdx + numSamples > generatedLength){
+                generatedIdx = 0;
+            }
+            if(generatedIdx + numSamples > generatedLength){
+                // Trajectory shorter than a block
+                buffer.clear();
+                break;
+            }
+            copyToOutput(buffer, generatedBuffer, generatedIdx, numSamples);
+            generatedIdx += numSamples;
+            break;
+
+        case Mode::granular:
+            // Overlapping grains, the play position moves through the trajectory in real time
+            buffer.clear();
+            if(generatedLength == 0){
+                break;
+            }
+            if(generatedIdx < 0 || generatedIdx >= generatedLength){
+                generatedIdx = 0;
+            }
+            if(!isSwapPending){
+                scheduleGrains(generatedBuffer, generatedTrajectory.getFrontLayout(), numSamples);
+            }
+            generatedIdx = (generatedIdx + numSamples) % generatedLength;
+            break;
+
+        case Mode::streaming:
+            // Grains are rendered just in time into a ring buffer. The first block after a restart is silent while the
+            // audio of the previous stream is dropped.
+            if(!grainStream.read(buffer, 0, numSamples)){
+                buffer.clear();
+                if(!grainStream.isActive()){
+                    mode = Mode::stopped;
+                    changedOnItsOwn = true;
+                }
+            }
+            break;
+
+        case Mode::stopped:
+            // Nothing, output silence (also disables feedback)
+            buffer.clear();
+            break;
+    }
+
+    // Playing grains, including the tails of grains released by a mode change
+    voicePool.render(buffer, 0, numSamples);
+    numActiveVoices = voicePool.getNumActiveVoices();
+
+    State state;
+    state.mode = mode;
+    state.position = (mode == Mode::recording || mode == Mode::playingRecording) ? recordingIdx : generatedIdx;
+    publishedState.store(state);
+
+    if(changedOnItsOwn){
+        triggerAsyncUpdate();
+    }
+}
+
+void PlaybackEngine::scheduleGrains(const AudioBuffer<float>& source, const TrajectoryBuffer::Layout& layout, int numSamples) {
+    const int interval = jmax(1, roundToInt(static_cast<float>(layout.grainLength) / density));
+    // The grains of the trajectory are windowed already, with windows normalised to an average gain of 1 (as looped).
+    // Overlapping grains add up to density times that.
+    const float gain = jmin(1.0f, 1.0f / density);
+    const int length = layout.getNumSamples();
+
+    while(samplesUntilNextGrain < numSamples){
+        // Each grain starts at the beginning of the trajectory grain under the play position at its onset
+        const int grainIdx = ((generatedIdx + samplesUntilNextGrain) % length) / layout.grainLength * layout.grainLength;
+        voicePool.startVoice(source.getReadPointer(0, grainIdx), source.getReadPointer(1, grainIdx),
+                             layout.grainLength, gain, samplesUntilNextGrain, true);
+        samplesUntilNextGrain += interval;
+    }
+    samplesUntilNextGrain -= numSamples;
+}
+
+void PlaybackEngine::renderScrub(AudioBuffer<float>& output, const AudioBuffer<float>& source, const TrajectoryBuffer::Layout& layout, int numSamples) {
+    const int grainLength = layout.grainLength;
+    const int lastGrain = layout.numGrains - 1;
+    if(scrubPhase >= grainLength){
+        scrubPhase = 0;
+    }
+
+    // Glide from the position of the last block to the latest target over this block, in units of grains
+    const float start = scrubPosition * static_cast<float>(lastGrain);
+    const float target = scrubTarget.load();
+    const float step = (target * static_cast<float>(lastGrain) - start) / static_cast<float>(numSamples);
+
+    const float* sourceLeft = source.getReadPointer(0);
+    const float* sourceRight = source.getReadPointer(1);
+    float* outLeft = output.getWritePointer(0);
+    float* outRight = output.getWritePointer(1);
+    int grain = 0;
+
+    for(int i = 0; i < numSamples; i++){
+        // Crossfade between the grain below and the grain above the scrub position
+        const float position = start + step * static_cast<float>(i + 1);
+        grain = jlimit(0, jmax(0, lastGrain - 1), static_cast<int>(position));
+        const float fraction = jlimit(0.0f, 1.0f, position - static_cast<float>(grain));
+        const auto fadeIdx = static_cast<size_t>(roundToInt(fraction * crossfadeTableSize));
+        const int lowerIdx = grain * grainLength + scrubPhase;
+        const int upperIdx = lastGrain > 0 ? lowerIdx + grainLength : lowerIdx;
+
+        outLeft[i] = sourceLeft[lowerIdx] * fadeOutTable[fadeIdx] + sourceLeft[upperIdx] * fadeInTable[fadeIdx];
+        outRight[i] = sourceRight[lowerIdx] * fadeOutTable[fadeIdx] + sourceRight[upperIdx] * fadeInTable[fadeIdx];
+
+        // Both grains are looped in lockstep, wrapping exactly at the grain end
+        if(++scrubPhase == grainLength){
+            scrubPhase = 0;
+        }
+    }
+
+    scrubPosition = target;
+    generatedIdx = grain * grainLength + scrubPhase;
+}
@@ -0,0 +1,202 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_PLAYBACKENGINE_H
+#define DMLAP_BACKEND_PLAYBACKENGINE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_events/juce_events.h>
+#include "TrajectoryBuffer.h"
+#include "GrainStream.h"
+#include "GrainVoicePool.h"
+#include "RecordingWorker.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Playback state machine driven by the audio thread.
+ * All playback state is owned by the audio thread. Other threads never write it directly: The message thread posts
+ * commands through a lock-free single-producer/single-consumer queue, which the audio thread drains at the start of
+ * each block. After processing a block the audio thread publishes a snapshot of its state as a single atomic value,
+ * which the message thread reads to update the GUI. Transitions are therefore race-free and nobody ever has to wait
+ * for the audio thread.
+ */
+class PlaybackEngine : private AsyncUpdater {
+public:
+    // What the audio thread is currently doing
+    enum class Mode : uint8_t {
+        // Output silence
+        stopped,
+        // Play the generated trajectory once
+        playingOnce,
+        // Loop the generated trajectory (agent running or looping a created trajectory)
+        looping,
+        // Loop the grain under the scrub position of the generated trajectory, crossfading between neighbouring grains
+        // (mobile tilt interface)
+        scrubbing,
+        // Record user audio (handed to the recording worker, which analyses it while recording)
+        recording,
+        // Play back the last finished recording
+        playingRecording,
+        // Play the generated trajectory as overlapping grains through the voice pool
+        granular,
+        // Play the grain stream (entered on its own when a stream is started, left when it stops)
+        streaming
+    };
+
+    // Snapshot of the playback state published by the audio thread
+    struct State {
+        Mode mode = Mode::stopped;
+        // Read position in the generated trajectory or recording, -1 if not playing
+        int32_t position = -1;
+    };
+
+    // A command posted from the message thread
+    struct Command {
+        // stream is applied by the audio thread itself when it finds a stream running, it is not posted
+        enum class Type : uint8_t { stop, playOnce, loop, scrub, record, playRecording, granular, setDensity, stream };
+        Type type = Type::stop;
+        // Grain density (setDensity only)
+        float value = 0.0f;
+    };
+
+    PlaybackEngine(TrajectoryBuffer& generatedTrajectory, GrainStream& grainStream, RecordingWorker& recordingWorker);
+    ~PlaybackEngine() override;
+
+    /**
+     * Message thread: Post a command to the audio thread. It takes effect at the start of the next block.
+     * Commands that change the mode stop a running grain stream first, since the stream would otherwise take over the
+     * output again.
+     * @param command
+     * @return False if the command queue is full
+     */
+    bool post(const Command& command);
+
+    /**
+     * Message thread: Post a command without arguments
+     * @param type
+     * @return False if the command queue is full
+     */
+    bool post(Command::Type type);
+
+    /**
+     * Any thread: Set the scrub position in the generated trajectory. Only the latest position matters, so instead
+     * of going through the command queue it is picked up directly by the next block.
+     * @param normalisedPosition Position in the range [0...1], 0 is the first and 1 the last grain
+     */
+    void setScrubPosition(float normalisedPosition);
+
+    /**
+     * Any thread: The playback state as of the end of the last block
+     * @return The state snapshot
+     */
+    State getState() const;
+
+    /**
+     * Any thread: Number of grains playing in granular mode as of the end of the last block
+     * @return The number of active voices
+     */
+    int getNumActiveVoices() const;
+
+    // Called on the message thread whenever the audio thread changed state on its own (end of playback or recording),
+    // or a recording was cut short by another command
+    std::function<void()> onStateChanged;
+
+    /**
+     * Audio thread: Render the next block. The buffer holds the audio input on entry (used when recording)
+     * and receives the output.
+     * @param buffer The audio buffer of the current block
+     * @param numSamples Number of samples in the block
+     */
+    void process(AudioBuffer<float>& buffer, int numSamples);
+
+private:
+    void handleAsyncUpdate() override;
+
+    /**
+     * Audio thread: Apply all commands posted since the last block
+     */
+    void drainCommands();
+
+    /**
+     * Audio thread: Apply a single command
+     * @param command
+     */
+    void apply(const Command& command);
+
+    /**
+     * Audio thread: Copy from a source buffer into the output
+     */
+    static void copyToOutput(AudioBuffer<float>& output, const AudioBuffer<float>& source, int sourceIdx, int numSamples);
+
+    /**
+     * Audio thread: Start all grains whose onset falls into the next block (granular mode)
+     * @param source The generated trajectory
+     * @param layout Layout of the generated trajectory
+     * @param numSamples Number of samples in the block
+     */
+    void scheduleGrains(const AudioBuffer<float>& source, const TrajectoryBuffer::Layout& layout, int numSamples);
+
+    /**
+     * Audio thread: Render the next block in scrubbing mode
+     * @param output The output buffer
+     * @param source The generated trajectory
+     * @param layout Layout of the generated trajectory
+     * @param numSamples Number of samples in the block
+     */
+    void renderScrub(AudioBuffer<float>& output, const AudioBuffer<float>& source, const TrajectoryBuffer::Layout& layout, int numSamples);
+
+    // Sources
+    TrajectoryBuffer& generatedTrajectory;
+    // Finished recordings of the recording worker
+    TrajectoryBuffer& recordings;
+    GrainStream& grainStream;
+    RecordingWorker& recordingWorker;
+
+    // Command queue: Single producer (message thread), single consumer (audio thread)
+    static constexpr int commandCapacity = 64;
+    AbstractFifo commandFifo { commandCapacity };
+    array<Command, commandCapacity> commands;
+
+    // State published by the audio thread
+    atomic<State> publishedState;
+    static_assert(atomic<State>::is_always_lock_free, "Playback state must be lock-free");
+    atomic<int> numActiveVoices { 0 };
+
+    // Audio thread state
+    Mode mode = Mode::stopped;
+    int generatedIdx = -1;
+    int recordingIdx = -1;
+    // A command cut the recording short during this block
+    bool isRecordingAborted = false;
+
+    // Scrubbing: Target position set by the message thread and the position reached at the end of the last block
+    // (both normalised), and the read position within the looped grain
+    atomic<float> scrubTarget { 0.0f };
+    float scrubPosition = 0.0f;
+    int scrubPhase = 0;
+    // Equal-power crossfade between two neighbouring grains, indexed by the fractional scrub position
+    static constexpr int crossfadeTableSize = 512;
+    array<float, crossfadeTableSize + 1> fadeOutTable;
+    array<float, crossfadeTableSize + 1> fadeInTable;
+
+    // Granular mode: Voices, average number of overlapping grains and samples until the next grain onset
+    GrainVoicePool voicePool { MAX_GRAIN_VOICES };
+    float density = 4.0f;
+    int samplesUntilNextGrain = 0;
+    // Fade applied to playing grains when they are stopped or their trajectory is replaced. A new trajectory is only
+    // swapped in once the grains have faded out, since they read from the front buffer.
+    static constexpr int releaseSamples = 256;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaybackEngine)
+};
+
+
+#endif //DMLAP_BACKEND_PLAYBACKENGINE_H
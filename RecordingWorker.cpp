@@ -0,0 +1,215 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "RecordingWorker.h"
+
+RecordingWorker::RecordingWorker(DBConnector& dbConnector, int recordingLength)
+: Thread("Recording worker"), analyser(dbConnector), recordings(2, recordingLength){
+    ring.setSize(2, ringGrains * GRAIN_LENGTH);
+    ring.clear();
+    pendingUpload.setSize(2, recordingLength);
+    grains.reserve(static_cast<size_t>(recordingLength / GRAIN_LENGTH));
+    timbre.reserve(grains.capacity() * TIMBRE_DIMENSIONS);
+    startThread();
+}
+
+RecordingWorker::~RecordingWorker() {
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+}
+
+void RecordingWorker::prepare(double sampleRate) {
+    const ScopedLock sl (analyserLock);
+    analyser.initialise(sampleRate);
+    isPrepared = true;
+}
+
+int RecordingWorker::getRecordingLength() const {
+    return recordings.getCapacity();
+}
+
+TrajectoryBuffer& RecordingWorker::getRecordings() {
+    return recordings;
+}
+
+void RecordingWorker::getLastRecording(vector<Grain>& grainsOut, vector<float>& timbreOut) {
+    const ScopedLock sl (resultLock);
+    grainsOut = result;
+    timbreOut = resultTimbre;
+}
+
+void RecordingWorker::begin() {
+    // Whatever is still in the ring belongs to the previous recording
+    recordingStartSample.store(numPushedSamples, memory_order_relaxed);
+    numStartedRecordings.fetch_add(1, memory_order_release);
+}
+
+void RecordingWorker::push(const AudioBuffer<float>& input, int numSamples) {
+    const int numToWrite = jmin(numSamples, ringFifo.getFreeSpace());
+    if(numToWrite < numSamples){
+        numDroppedSamples += numSamples - numToWrite;
+    }
+    int start1, size1, start2, size2;
+    ringFifo.prepareToWrite(numToWrite, start1, size1, start2, size2);
+    for(int channel = 0; channel < 2; channel++){
+        if(size1 > 0){
+            ring.copyFrom(channel, start1, input, channel, 0, size1);
+        }
+        if(size2 > 0){
+            ring.copyFrom(channel, start2, input, channel, size1, size2);
+        }
+    }
+    ringFifo.finishedWrite(size1 + size2);
+    numPushedSamples += size1 + size2;
+}
+
+void RecordingWorker::finish() {
+    numFinishedRecordings.fetch_add(1, memory_order_release);
+}
+
+void RecordingWorker::abort() {
+    lastAbortedRecording.store(numStartedRecordings.load(memory_order_relaxed), memory_order_relaxed);
+    numFinishedRecordings.fetch_add(1, memory_order_release);
+}
+
+void RecordingWorker::analyseUpload(const AudioBuffer<float>& audio) {
+    {
+        const ScopedLock sl (uploadLock);
+        pendingUploadLength = jmin(audio.getNumSamples(), pendingUpload.getNumSamples());
+        for(int channel = 0; channel < 2; channel++){
+            pendingUpload.copyFrom(channel, 0, audio, jmin(channel, audio.getNumChannels() - 1), 0, pendingUploadLength);
+        }
+    }
+    notify();
+}
+
+int RecordingWorker::getNumDroppedSamples() const {
+    return numDroppedSamples;
+}
+
+void RecordingWorker::run() {
+    while(!threadShouldExit()){
+        // Read the finished count before draining: Everything pushed before finish() is then guaranteed to be drained
+        const int finished = numFinishedRecordings.load(memory_order_acquire);
+        const int started = numStartedRecordings.load(memory_order_acquire);
+        if(started != currentRecording){
+            // New recording, into the back buffer: The audio thread may still be playing the last one
+            currentRecording = started;
+            writeIdx = 0;
+            numAnalysedGrains = 0;
+            grains.clear();
+            timbre.clear();
+            recordings.getBackBuffer().clear();
+            isReported = false;
+        }
+
+        drainRing();
+
+        if(!isReported && finished == currentRecording){
+            isReported = true;
+            if(lastAbortedRecording.load(memory_order_relaxed) == currentRecording){
+                // Cut short: Neither published nor reported
+                continue;
+            }
+            publishRecording();
+        } else if(isReported && takePendingUpload()){
+            // No recording in progress: The upload is analysed in one go
+            analyseCompleteGrains();
+            publishRecording();
+        }
+
+        wait(pollInterval);
+    }
+}
+
+void RecordingWorker::drainRing() {
+    AudioBuffer<float>& recordingBuffer = recordings.getBackBuffer();
+    const int numReady = ringFifo.getNumReady();
+    if(numReady > 0){
+        int start1, size1, start2, size2;
+        ringFifo.prepareToRead(numReady, start1, size1, start2, size2);
+        const int starts[2] = { start1, start2 };
+        const int sizes[2] = { size1, size2 };
+        // Input of an earlier recording that was not drained before the current one began
+        const int64 numStale = jlimit<int64>(0, size1 + size2, recordingStartSample.load(memory_order_relaxed) - numDrainedSamples);
+        int numSkipped = 0;
+        for(int block = 0; block < 2; block++){
+            const int skip = static_cast<int>(jmin<int64>(sizes[block], numStale - numSkipped));
+            numSkipped += skip;
+            // Anything beyond the end of the recording buffer is discarded
+            const int numToCopy = jmin(sizes[block] - skip, recordingBuffer.getNumSamples() - writeIdx);
+            if(numToCopy <= 0){
+                continue;
+            }
+            recordingBuffer.copyFrom(0, writeIdx, ring, 0, starts[block] + skip, numToCopy);
+            recordingBuffer.copyFrom(1, writeIdx, ring, 1, starts[block] + skip, numToCopy);
+            writeIdx += numToCopy;
+        }
+        ringFifo.finishedRead(size1 + size2);
+        numDrainedSamples += size1 + size2;
+    }
+
+    analyseCompleteGrains();
+}
+
+void RecordingWorker::analyseCompleteGrains() {
+    // Same grains as Analyser::audioBufferToGrains on the whole recording
+    const AudioBuffer<float>& recordingBuffer = recordings.getBackBuffer();
+    const ScopedLock sl (analyserLock);
+    if(!isPrepared){
+        return;
+    }
+    while(true){
+        const int grainStart = numAnalysedGrains * GRAIN_LENGTH;
+        if(grainStart + GRAIN_LENGTH > writeIdx || grainStart + GRAIN_LENGTH >= recordingBuffer.getNumSamples()){
+            break;
+        }
+        grains.emplace_back(analyser.analyseGrain(recordingBuffer.getReadPointer(0, grainStart)));
+        timbre.insert(timbre.end(), analyser.getTimbre().begin(), analyser.getTimbre().end());
+        numAnalysedGrains++;
+    }
+}
+
+void RecordingWorker::publishRecording() {
+    recordings.setBackLayout(writeIdx / GRAIN_LENGTH, GRAIN_LENGTH);
+    recordings.publish();
+    {
+        const ScopedLock sl (resultLock);
+        result = grains;
+        resultTimbre = timbre;
+    }
+    triggerAsyncUpdate();
+}
+
+bool RecordingWorker::takePendingUpload() {
+    const ScopedLock sl (uploadLock);
+    if(pendingUploadLength == 0){
+        return false;
+    }
+    AudioBuffer<float>& recordingBuffer = recordings.getBackBuffer();
+    recordingBuffer.clear();
+    recordingBuffer.copyFrom(0, 0, pendingUpload, 0, 0, pendingUploadLength);
+    recordingBuffer.copyFrom(1, 0, pendingUpload, 1, 0, pendingUploadLength);
+    writeIdx = pendingUploadLength;
+    numAnalysedGrains = 0;
+    grains.clear();
+    timbre.clear();
+    pendingUploadLength = 0;
+    return true;
+}
+
+void RecordingWorker::handleAsyncUpdate() {
+    vector<Grain> analysedGrains;
+    vector<float> analysedTimbre;
+    {
+        const ScopedLock sl (resultLock);
+        analysedGrains = result;
+        analysedTimbre = resultTimbre;
+    }
+    if(onRecordingAnalysed != nullptr){
+        onRecordingAnalysed(analysedGrains, analysedTimbre);
+    }
+}
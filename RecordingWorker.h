@@ -0,0 +1,181 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_RECORDINGWORKER_H
+#define DMLAP_BACKEND_RECORDINGWORKER_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "Analyser.h"
+#include "DBConnector.h"
+#include "Grain.h"
+#include "TrajectoryBuffer.h"
+#include "Constants.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Recording path between the audio thread and the analysis.
+ * The audio thread only pushes its input into a lock-free single-producer/single-consumer ring buffer. A background
+ * thread drains the ring into the back buffer of "recordings" and analyses every grain as soon as it is complete, using
+ * its own Analyser instance, while the recording is still going. When the recording stops only the last grain is left
+ * to analyse, so the grains are reported (via "onRecordingAnalysed" on the message thread) within one grain of the end
+ * of the recording instead of after a full re-analysis. The finished recording is published to the audio thread through
+ * the same triple buffer as generated trajectories, so playing the last recording never races the next one.
+ * Uploaded audio (see AudioUploadReceiver) takes the same way once no recording is in progress: It is analysed on this
+ * thread, published as the last recording and reported like one.
+ */
+class RecordingWorker : private Thread, private AsyncUpdater {
+public:
+    /**
+     * @param dbConnector
+     * @param recordingLength Length of a recording in samples
+     */
+    RecordingWorker(DBConnector& dbConnector, int recordingLength);
+    ~RecordingWorker() override;
+
+    /**
+     * Message thread: (Re-)initialise the analysis for the given sample rate
+     * @param sampleRate
+     */
+    void prepare(double sampleRate);
+
+    /**
+     * Length of a recording in samples, i.e. the capacity of the recording buffers
+     * @return The recording length
+     */
+    int getRecordingLength() const;
+
+    /**
+     * The finished recordings: Written by this worker, played back by the audio thread (reader side only)
+     * @return The recordings
+     */
+    TrajectoryBuffer& getRecordings();
+
+    /**
+     * Message thread: The grains and timbre vectors of the last finished recording
+     * @param grainsOut
+     * @param timbreOut
+     */
+    void getLastRecording(vector<Grain>& grainsOut, vector<float>& timbreOut);
+
+    /**
+     * Audio thread: Start a new recording. Every recording must be ended with finish() or abort().
+     */
+    void begin();
+
+    /**
+     * Audio thread: Append input to the current recording
+     * @param input The input of the current block
+     * @param numSamples Number of samples to append
+     */
+    void push(const AudioBuffer<float>& input, int numSamples);
+
+    /**
+     * Audio thread: End the current recording, it is published and analysed
+     */
+    void finish();
+
+    /**
+     * Audio thread: End the current recording early (e.g. playback mode changed), it is discarded
+     */
+    void abort();
+
+    /**
+     * Message thread: Analyse uploaded audio in the background and make it the last recording. Replaces an upload that
+     * has not been analysed yet. Waits for a recording in progress to end.
+     * @param audio The uploaded audio (2 channels), cut to the recording length
+     */
+    void analyseUpload(const AudioBuffer<float>& audio);
+
+    /**
+     * Number of input samples dropped because the analysis thread fell behind
+     * @return The number of dropped samples since the worker was created
+     */
+    int getNumDroppedSamples() const;
+
+    // Called on the message thread with the analysed grains and their timbre vectors (TIMBRE_DIMENSIONS values per
+    // grain) once a recording has finished or an upload was analysed
+    std::function<void(const vector<Grain>&, const vector<float>&)> onRecordingAnalysed;
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    /**
+     * Move everything in the ring into the recording buffer and analyse the grains completed by it. Input pushed before
+     * the current recording began is dropped.
+     */
+    void drainRing();
+
+    /**
+     * Analyse every grain of the recording buffer that is complete by now
+     */
+    void analyseCompleteGrains();
+
+    /**
+     * Publish the recording in the back buffer and hand its grains over to the message thread
+     */
+    void publishRecording();
+
+    /**
+     * Copy the pending upload into the back buffer as a complete recording
+     * @return False if there is no pending upload
+     */
+    bool takePendingUpload();
+
+    // Analysis
+    Analyser analyser;
+    // Held while analysing, so the analyser is not re-initialised under our feet
+    CriticalSection analyserLock;
+    bool isPrepared = false;
+
+    // Finished recordings, this thread writes into the back buffer
+    TrajectoryBuffer recordings;
+    int writeIdx = 0;
+    int numAnalysedGrains = 0;
+    vector<Grain> grains;
+    vector<float> timbre;
+
+    // Input ring: Single producer (audio thread), single consumer (this thread)
+    static constexpr int ringGrains = 8;
+    AbstractFifo ringFifo { ringGrains * GRAIN_LENGTH };
+    AudioBuffer<float> ring;
+
+    // Recording sessions started and ended (finished or aborted) by the audio thread, and the last aborted one
+    atomic<int> numStartedRecordings { 0 };
+    atomic<int> numFinishedRecordings { 0 };
+    atomic<int> lastAbortedRecording { 0 };
+    int currentRecording = 0;
+    bool isReported = true;
+    atomic<int> numDroppedSamples { 0 };
+    // Samples written to the ring (audio thread) and read from it (this thread) since construction, and the count at
+    // which the current recording began
+    int64 numPushedSamples = 0;
+    atomic<int64> recordingStartSample { 0 };
+    int64 numDrainedSamples = 0;
+
+    // Uploaded audio waiting for the analysis (allocated up front), guarded by uploadLock
+    CriticalSection uploadLock;
+    AudioBuffer<float> pendingUpload;
+    int pendingUploadLength = 0;
+
+    // Grains (and timbre) of the last finished recording, handed over to the message thread
+    CriticalSection resultLock;
+    vector<Grain> result;
+    vector<float> resultTimbre;
+
+    // How often the ring is drained while recording (milliseconds)
+    static constexpr int pollInterval = 5;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecordingWorker)
+};
+
+
+#endif //DMLAP_BACKEND_RECORDINGWORKER_H
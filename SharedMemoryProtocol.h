@@ -0,0 +1,97 @@
+/*
+ * Created by Max on 19/10/2026.
+ *
+ * Layout of the shared-memory transport between the backend and the RL agent. Plain C so that it can be used from
+ * any language; the agent maps it with numpy (see below).
+ *
+ * The backend creates a POSIX shared-memory object (shm_open, "/dev/shm/<name>" on Linux) holding one
+ * dmlap_shm_segment. It contains two single-producer/single-consumer rings of fixed-size message slots: toBackend
+ * (agent writes, backend reads) and toAgent (backend writes, agent reads). Every slot carries one message with the
+ * same semantics as the OSC message of the same address, e.g. "/params" with a single blob argument holding a
+ * feature blob (see FeatureBlob.h), so both sides keep their existing message handlers.
+ *
+ * Ring protocol (all integers little endian, counters wrap around at 2^32):
+ *   - writeCount is only written by the producer, readCount only by the consumer
+ *   - the ring is empty if writeCount == readCount and full if writeCount - readCount == DMLAP_SHM_NUM_SLOTS
+ *   - producer: fill slots[writeCount % DMLAP_SHM_NUM_SLOTS], then increment writeCount (release), then a full
+ *     (sequentially consistent) fence, then, if consumerWaiting is set, wake the consumer with FUTEX_WAKE on
+ *     writeCount (Linux, shared futex)
+ *   - consumer: if empty, set consumerWaiting = 1, then a full fence, then check again and FUTEX_WAIT on writeCount
+ *     with the observed value (or just poll); when done, set consumerWaiting = 0. Read
+ *     slots[readCount % DMLAP_SHM_NUM_SLOTS], then increment readCount (release)
+ *   Both sides store one word and then load the other, so both fences are needed: Without them either load may be
+ *   served before the other side's store is visible, the producer skips the wake-up and the consumer sleeps on a
+ *   message. A consumer that polls, or bounds its FUTEX_WAIT with a timeout, at worst picks the message up late.
+ * If a ring is full the producer drops the message, like a lost UDP packet, and counts it in droppedCount.
+ *
+ * Every message takes exactly one slot, there is no fragmentation. A slot holds DMLAP_SHM_PAYLOAD_SIZE bytes of
+ * arguments, which is just below the largest OSC message a UDP datagram can carry (65507 bytes including address and
+ * type tags), so every message that can be sent over OSC fits. The backend never writes a larger message: Replies
+ * that could grow beyond it (e.g. "/batch_result") are bounded by rejecting the request up front. A producer that is
+ * handed a message that doesn't fit must report it to its caller rather than truncate it.
+ *
+ * Message payload: The arguments in the order of typeTags, each one packed little endian:
+ *   'i' int32, 'f' float32, 'b' uint32 size followed by the bytes, padded to a multiple of 4, 's' UTF-8 string in
+ *   the same layout as 'b' (no terminating NUL; new in version 2)
+ *
+ * numpy (agent side), e.g.:
+ *   segment = np.memmap("/dev/shm/dmlap", dtype=np.uint8, mode="r+")
+ *   slot = DMLAP_SHM_TO_BACKEND_OFFSET + DMLAP_SHM_RING_HEADER_SIZE + (writeCount % DMLAP_SHM_NUM_SLOTS) * DMLAP_SHM_SLOT_SIZE
+ *   features = np.frombuffer(segment, dtype="<f4", count=n, offset=slot + DMLAP_SHM_MESSAGE_HEADER_SIZE + 4 + 12)
+ */
+
+#ifndef DMLAP_BACKEND_SHAREDMEMORYPROTOCOL_H
+#define DMLAP_BACKEND_SHAREDMEMORYPROTOCOL_H
+
+#include <stdint.h>
+
+#define DMLAP_SHM_MAGIC 0x504C4D44u /* "DMLP" */
+#define DMLAP_SHM_VERSION 2u
+
+/* Message slots per ring and their size in bytes (version 1 had 16 KiB slots) */
+#define DMLAP_SHM_NUM_SLOTS 32
+#define DMLAP_SHM_SLOT_SIZE 65536
+#define DMLAP_SHM_ADDRESS_SIZE 64
+#define DMLAP_SHM_TYPE_TAGS_SIZE 32
+#define DMLAP_SHM_MESSAGE_HEADER_SIZE (DMLAP_SHM_ADDRESS_SIZE + DMLAP_SHM_TYPE_TAGS_SIZE + 8)
+#define DMLAP_SHM_PAYLOAD_SIZE (DMLAP_SHM_SLOT_SIZE - DMLAP_SHM_MESSAGE_HEADER_SIZE)
+
+/* Byte offsets, for mapping the segment without a C compiler */
+#define DMLAP_SHM_SEGMENT_HEADER_SIZE 64
+#define DMLAP_SHM_RING_HEADER_SIZE 192
+#define DMLAP_SHM_RING_SIZE (DMLAP_SHM_RING_HEADER_SIZE + DMLAP_SHM_NUM_SLOTS * DMLAP_SHM_SLOT_SIZE)
+#define DMLAP_SHM_TO_BACKEND_OFFSET DMLAP_SHM_SEGMENT_HEADER_SIZE
+#define DMLAP_SHM_TO_AGENT_OFFSET (DMLAP_SHM_SEGMENT_HEADER_SIZE + DMLAP_SHM_RING_SIZE)
+
+/* One message, same semantics as the OSC message with the same address */
+typedef struct dmlap_shm_message {
+    char address[DMLAP_SHM_ADDRESS_SIZE];      /* OSC address, NUL-terminated, e.g. "/params" */
+    char typeTags[DMLAP_SHM_TYPE_TAGS_SIZE];   /* One character per argument ('i', 'f', 'b' or 's'), NUL-terminated */
+    uint32_t payloadSize;                      /* Number of payload bytes in use */
+    uint32_t reserved;
+    uint8_t payload[DMLAP_SHM_PAYLOAD_SIZE];
+} dmlap_shm_message;
+
+/* Counters each live on their own cache line so producer and consumer don't share one */
+typedef struct dmlap_shm_ring {
+    uint32_t writeCount;         /* Messages written (producer), also the futex word */
+    uint32_t consumerWaiting;    /* Set by the consumer while it sleeps on the futex */
+    uint32_t droppedCount;       /* Messages dropped because the ring was full (producer) */
+    uint8_t pad0[52];
+    uint32_t readCount;          /* Messages read (consumer) */
+    uint8_t pad1[60];
+    uint8_t pad2[64];
+    dmlap_shm_message slots[DMLAP_SHM_NUM_SLOTS];
+} dmlap_shm_ring;
+
+typedef struct dmlap_shm_segment {
+    uint32_t magic;              /* DMLAP_SHM_MAGIC once the backend has initialised the segment */
+    uint32_t version;            /* DMLAP_SHM_VERSION */
+    uint32_t numSlots;           /* DMLAP_SHM_NUM_SLOTS */
+    uint32_t slotSize;           /* DMLAP_SHM_SLOT_SIZE */
+    uint8_t pad[48];
+    dmlap_shm_ring toBackend;
+    dmlap_shm_ring toAgent;
+} dmlap_shm_segment;
+
+#endif /* DMLAP_BACKEND_SHAREDMEMORYPROTOCOL_H */
@@ -0,0 +1,303 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "SharedMemoryTransport.h"
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if JUCE_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+// The agent maps the segment from the byte offsets in the protocol header, make sure the structs agree with them
+static_assert(sizeof(dmlap_shm_message) == DMLAP_SHM_SLOT_SIZE, "Unexpected message slot size");
+static_assert(offsetof(dmlap_shm_ring, slots) == DMLAP_SHM_RING_HEADER_SIZE, "Unexpected ring header size");
+static_assert(offsetof(dmlap_shm_ring, readCount) == 64, "Ring counters must be on separate cache lines");
+static_assert(offsetof(dmlap_shm_segment, toBackend) == DMLAP_SHM_TO_BACKEND_OFFSET, "Unexpected ring offset");
+static_assert(offsetof(dmlap_shm_segment, toAgent) == DMLAP_SHM_TO_AGENT_OFFSET, "Unexpected ring offset");
+
+// Shared counters are accessed atomically in place, the other process uses the same memory
+static uint32_t loadAcquire(const uint32_t* word) {
+    return __atomic_load_n(word, __ATOMIC_ACQUIRE);
+}
+
+static void storeRelease(uint32_t* word, uint32_t value) {
+    __atomic_store_n(word, value, __ATOMIC_RELEASE);
+}
+
+// Orders a store before a later load of another word (release and acquire alone allow the load to move up)
+static void fullFence() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+SharedMemoryTransport::SharedMemoryTransport() : Thread("Shared memory transport") {
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    close();
+}
+
+bool SharedMemoryTransport::open(const String& name) {
+    close();
+
+    shmName = "/" + name.trimCharactersAtStart("/");
+    fileDescriptor = shm_open(shmName.toRawUTF8(), O_CREAT | O_RDWR, 0600);
+    if(fileDescriptor < 0){
+        fprintf(stderr, "Could not create shared memory %s\n", shmName.toRawUTF8());
+        return false;
+    }
+    if(ftruncate(fileDescriptor, sizeof(dmlap_shm_segment)) != 0){
+        fprintf(stderr, "Could not resize shared memory %s\n", shmName.toRawUTF8());
+        close();
+        return false;
+    }
+    void* memory = mmap(nullptr, sizeof(dmlap_shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if(memory == MAP_FAILED){
+        fprintf(stderr, "Could not map shared memory %s\n", shmName.toRawUTF8());
+        close();
+        return false;
+    }
+    segment = static_cast<dmlap_shm_segment*>(memory);
+
+    // Fresh rings. The magic number goes in last, the agent waits for it before using the segment
+    memset(segment, 0, offsetof(dmlap_shm_segment, toBackend.slots));
+    memset(&segment->toAgent, 0, offsetof(dmlap_shm_ring, slots));
+    segment->version = DMLAP_SHM_VERSION;
+    segment->numSlots = DMLAP_SHM_NUM_SLOTS;
+    segment->slotSize = DMLAP_SHM_SLOT_SIZE;
+    storeRelease(&segment->magic, DMLAP_SHM_MAGIC);
+
+    startThread();
+    fprintf(stdout, "Shared memory transport open on %s\n", shmName.toRawUTF8());
+    return true;
+}
+
+void SharedMemoryTransport::close() {
+    if(isThreadRunning()){
+        signalThreadShouldExit();
+        if(segment != nullptr){
+            // Wake the reader so it does not have to time out
+            wakeWaiter(&segment->toBackend.writeCount);
+        }
+        stopThread(2 * waitTimeout);
+    }
+    if(segment != nullptr){
+        storeRelease(&segment->magic, 0);
+        munmap(segment, sizeof(dmlap_shm_segment));
+        segment = nullptr;
+    }
+    if(fileDescriptor >= 0){
+        ::close(fileDescriptor);
+        shm_unlink(shmName.toRawUTF8());
+        fileDescriptor = -1;
+    }
+}
+
+bool SharedMemoryTransport::isOpen() const {
+    return segment != nullptr;
+}
+
+bool SharedMemoryTransport::send(const OSCMessage& message) {
+    if(segment == nullptr){
+        return false;
+    }
+    dmlap_shm_ring& ring = segment->toAgent;
+    const uint32_t writeCount = ring.writeCount;
+    if(writeCount - loadAcquire(&ring.readCount) >= DMLAP_SHM_NUM_SLOTS){
+        storeRelease(&ring.droppedCount, ring.droppedCount + 1);
+        return false;
+    }
+    if(!messageToSlot(message, ring.slots[writeCount % DMLAP_SHM_NUM_SLOTS])){
+        // Callers bound their large replies with fits() before building them, so this is a bug on the sending side
+        fprintf(stderr, "Message %s does not fit into a shared memory slot\n", message.getAddressPattern().toString().toRawUTF8());
+        return false;
+    }
+    storeRelease(&ring.writeCount, writeCount + 1);
+    // Store writeCount, then load consumerWaiting: Without the fence the load can be satisfied before the store is
+    // visible, and a consumer going to sleep at the same time would miss both the message and the wake-up
+    fullFence();
+    if(loadAcquire(&ring.consumerWaiting) != 0){
+        wakeWaiter(&ring.writeCount);
+    }
+    return true;
+}
+
+uint32 SharedMemoryTransport::getNumDroppedMessages() const {
+    return segment != nullptr ? loadAcquire(&segment->toAgent.droppedCount) : 0;
+}
+
+void SharedMemoryTransport::run() {
+    dmlap_shm_ring& ring = segment->toBackend;
+
+    while(!threadShouldExit()){
+        const uint32_t readCount = ring.readCount;
+        const uint32_t writeCount = loadAcquire(&ring.writeCount);
+        if(readCount == writeCount){
+            // Nothing to read: Announce that we are going to sleep, check again (the agent may have written in
+            // between) and sleep until the write count changes
+            storeRelease(&ring.consumerWaiting, 1);
+            // The mirror image of send(): Either we see the new write count here, or the producer sees us waiting
+            fullFence();
+            if(loadAcquire(&ring.writeCount) == writeCount){
+                waitForChange(&ring.writeCount, writeCount, waitTimeout);
+            }
+            storeRelease(&ring.consumerWaiting, 0);
+            continue;
+        }
+
+        OSCMessage message ("/");
+        const bool isValid = slotToMessage(ring.slots[readCount % DMLAP_SHM_NUM_SLOTS], message);
+        // The slot was copied into the message, hand it back to the agent
+        storeRelease(&ring.readCount, readCount + 1);
+
+        if(isValid && onMessage != nullptr){
+            onMessage(message);
+        }
+    }
+}
+
+bool SharedMemoryTransport::slotToMessage(const dmlap_shm_message& slot, OSCMessage& message) {
+    const size_t addressLength = strnlen(slot.address, DMLAP_SHM_ADDRESS_SIZE);
+    const size_t numArguments = strnlen(slot.typeTags, DMLAP_SHM_TYPE_TAGS_SIZE);
+    if(addressLength == 0 || addressLength == DMLAP_SHM_ADDRESS_SIZE || slot.address[0] != '/'
+       || slot.payloadSize > DMLAP_SHM_PAYLOAD_SIZE){
+        return false;
+    }
+    message = OSCMessage(String(slot.address, addressLength));
+
+    size_t offset = 0;
+    for(size_t i = 0; i < numArguments; i++){
+        if(offset + 4 > slot.payloadSize){
+            return false;
+        }
+        const uint8_t* argument = slot.payload + offset;
+        switch(slot.typeTags[i]){
+            case 'i':
+                message.addInt32(static_cast<int32>(ByteOrder::littleEndianInt(argument)));
+                offset += 4;
+                break;
+            case 'f': {
+                const uint32_t bits = ByteOrder::littleEndianInt(argument);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                message.addFloat32(value);
+                offset += 4;
+                break;
+            }
+            case 'b':
+            case 's': {
+                const uint32_t size = ByteOrder::littleEndianInt(argument);
+                if(offset + 4 + size > slot.payloadSize){
+                    return false;
+                }
+                if(slot.typeTags[i] == 'b'){
+                    message.addBlob(MemoryBlock(argument + 4, size));
+                } else {
+                    message.addString(String::fromUTF8(reinterpret_cast<const char*>(argument + 4), static_cast<int>(size)));
+                }
+                offset += 4 + ((size + 3) & ~3u);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SharedMemoryTransport::fits(const OSCMessage& message) {
+    if(message.getAddressPattern().toString().getNumBytesAsUTF8() >= DMLAP_SHM_ADDRESS_SIZE
+       || message.size() >= DMLAP_SHM_TYPE_TAGS_SIZE){
+        return false;
+    }
+    size_t payloadSize = 0;
+    for(const auto& argument : message){
+        if(argument.isInt32() || argument.isFloat32()){
+            payloadSize += 4;
+        } else if(argument.isBlob()){
+            payloadSize += 4 + ((argument.getBlob().getSize() + 3) & ~static_cast<size_t>(3));
+        } else if(argument.isString()){
+            payloadSize += 4 + ((argument.getString().getNumBytesAsUTF8() + 3) & ~static_cast<size_t>(3));
+        } else {
+            return false;
+        }
+    }
+    return payloadSize <= DMLAP_SHM_PAYLOAD_SIZE;
+}
+
+bool SharedMemoryTransport::messageToSlot(const OSCMessage& message, dmlap_shm_message& slot) {
+    // Checked up front, so a message that doesn't fit leaves the slot untouched
+    if(!fits(message)){
+        return false;
+    }
+    const String address = message.getAddressPattern().toString();
+    memset(slot.address, 0, sizeof(slot.address));
+    memset(slot.typeTags, 0, sizeof(slot.typeTags));
+    memcpy(slot.address, address.toRawUTF8(), address.getNumBytesAsUTF8());
+
+    size_t offset = 0;
+    auto writeWord = [&slot, &offset] (uint32_t word) {
+        word = ByteOrder::swapIfBigEndian(word);
+        memcpy(slot.payload + offset, &word, sizeof(word));
+        offset += 4;
+    };
+    // Size, then the bytes padded to a multiple of 4
+    auto writeBytes = [&slot, &offset, &writeWord] (const void* data, size_t size) {
+        const size_t paddedSize = (size + 3) & ~static_cast<size_t>(3);
+        writeWord(static_cast<uint32_t>(size));
+        memcpy(slot.payload + offset, data, size);
+        memset(slot.payload + offset + size, 0, paddedSize - size);
+        offset += paddedSize;
+    };
+
+    for(int i = 0; i < message.size(); i++){
+        const OSCArgument& argument = message[i];
+        if(argument.isInt32()){
+            slot.typeTags[i] = 'i';
+            writeWord(static_cast<uint32_t>(argument.getInt32()));
+        } else if(argument.isFloat32()){
+            slot.typeTags[i] = 'f';
+            const float value = argument.getFloat32();
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            writeWord(bits);
+        } else if(argument.isBlob()){
+            slot.typeTags[i] = 'b';
+            const MemoryBlock& blob = argument.getBlob();
+            writeBytes(blob.getData(), blob.getSize());
+        } else {
+            slot.typeTags[i] = 's';
+            const String text = argument.getString();
+            writeBytes(text.toRawUTF8(), text.getNumBytesAsUTF8());
+        }
+    }
+    slot.payloadSize = static_cast<uint32_t>(offset);
+    return true;
+}
+
+void SharedMemoryTransport::waitForChange(uint32_t* word, uint32_t observedValue, int timeoutMs) {
+#if JUCE_LINUX
+    // Shared (not process private) futex, the agent wakes us from another process
+    timespec timeout { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+    syscall(SYS_futex, word, FUTEX_WAIT, observedValue, &timeout, nullptr, 0);
+#else
+    // Polling fallback
+    const uint32 endTime = Time::getMillisecondCounter() + static_cast<uint32>(timeoutMs);
+    while(loadAcquire(word) == observedValue && Time::getMillisecondCounter() < endTime){
+        Thread::sleep(1);
+    }
+#endif
+}
+
+void SharedMemoryTransport::wakeWaiter(uint32_t* word) {
+#if JUCE_LINUX
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    ignoreUnused(word);
+#endif
+}
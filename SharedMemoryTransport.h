@@ -0,0 +1,100 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_SHAREDMEMORYTRANSPORT_H
+#define DMLAP_BACKEND_SHAREDMEMORYTRANSPORT_H
+
+#include <functional>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_osc/juce_osc.h>
+#include "SharedMemoryProtocol.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Optional transport to an RL agent on the same machine: Messages go through lock-free rings in a POSIX shared-memory
+ * segment (layout in SharedMemoryProtocol.h) instead of UDP, so there is no packet loss as long as the agent keeps up,
+ * and a round trip takes microseconds. Messages are limited to one slot (DMLAP_SHM_PAYLOAD_SIZE bytes of arguments,
+ * about as much as a UDP datagram carries): send() rejects larger messages, and the senders of large replies check
+ * their size before they build them.
+ * Messages keep their OSC semantics: Incoming messages are converted to OSCMessages and delivered on the reader thread
+ * (like OSCReceiver's real-time callbacks, usually straight into an OSCDispatcher), and outgoing OSCMessages are written
+ * to the agent's ring as they are.
+ * The reader thread sleeps on a futex (Linux) or polls every millisecond (other platforms).
+ */
+class SharedMemoryTransport : private Thread {
+public:
+    SharedMemoryTransport();
+    ~SharedMemoryTransport() override;
+
+    /**
+     * Create (or re-initialise) the shared-memory segment and start receiving
+     * @param name Name of the shared-memory object, e.g. "dmlap" for "/dev/shm/dmlap"
+     * @return False if the segment could not be created
+     */
+    bool open(const String& name);
+
+    /**
+     * Stop receiving and unmap the segment. The shared-memory object is removed.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * Send a message to the agent (message thread, the only producer)
+     * @param message A message with int32, float32, blob and string arguments only
+     * @return False if the message does not fit into a slot (see fits()) or the ring is full
+     */
+    bool send(const OSCMessage& message);
+
+    /**
+     * Whether a message fits into a slot, i.e. whether send() could ever deliver it
+     * @param message
+     * @return False if the address, type tags or arguments are too long, or an argument type is not supported
+     */
+    static bool fits(const OSCMessage& message);
+
+    /**
+     * Number of messages dropped since open() because the agent's ring was full
+     * @return The number of dropped messages
+     */
+    uint32 getNumDroppedMessages() const;
+
+    // Called on the reader thread for every message from the agent
+    std::function<void(const OSCMessage&)> onMessage;
+
+private:
+    void run() override;
+
+    /**
+     * Convert a message slot into an OSC message
+     * @return False if the slot is malformed
+     */
+    static bool slotToMessage(const dmlap_shm_message& slot, OSCMessage& message);
+
+    /**
+     * Convert an OSC message into a message slot
+     * @return False if the message does not fit
+     */
+    static bool messageToSlot(const OSCMessage& message, dmlap_shm_message& slot);
+
+    // Futex helpers on a 32-bit word in the segment (polling fallback on platforms without futexes)
+    static void waitForChange(uint32_t* word, uint32_t observedValue, int timeoutMs);
+    static void wakeWaiter(uint32_t* word);
+
+    dmlap_shm_segment* segment = nullptr;
+    String shmName;
+    int fileDescriptor = -1;
+
+    // How long the reader sleeps before checking whether it should exit (milliseconds)
+    static constexpr int waitTimeout = 100;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedMemoryTransport)
+};
+
+
+#endif //DMLAP_BACKEND_SHAREDMEMORYTRANSPORT_H
@@ -0,0 +1,47 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_SILENCEGATE_H
+#define DMLAP_BACKEND_SILENCEGATE_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+/**
+ * The silence gate of the corpus: Which grains are left out at ingest for being too quiet (silent tails, gaps between
+ * samples) or, with the noise gate on, quiet and noisy (hiss or hum between takes). The Analyser supplies the levels
+ * and the spectral flatness, the decision is kept here free of the analysis so it can be checked on its own.
+ */
+namespace SilenceGate {
+
+// Default minimum RMS level of a grain in the corpus
+inline constexpr float defaultThresholdDb = -60.0f;
+// Range above the silence threshold in which the noise gate applies
+inline constexpr float noiseGateRangeDb = 20.0f;
+
+/**
+ * Whether a grain is kept in the corpus
+ * @param rms RMS level of the grain (linear)
+ * @param thresholdDb Minimum level in dBFS (-100 or less to keep every grain)
+ * @param noiseFlatness Noise gate: Grains up to noiseGateRangeDb above the threshold whose spectral flatness is at least
+ * this value are left out as well. 0 disables it.
+ * @param computeFlatness Returns the spectral flatness of the grain (0 to 1), only called when the noise gate decides,
+ * since computing it costs an extra pass over the spectrum
+ * @return True if the grain passes
+ */
+template <typename ComputeFlatness>
+bool passes(float rms, float thresholdDb, float noiseFlatness, ComputeFlatness&& computeFlatness) {
+    const float levelDb = juce::Decibels::gainToDecibels(rms);
+    if(levelDb < thresholdDb){
+        return false;
+    }
+    // Noise gate: Quiet grains with a flat spectrum
+    if(noiseFlatness > 0.0f && levelDb < thresholdDb + noiseGateRangeDb){
+        return computeFlatness() < noiseFlatness;
+    }
+    return true;
+}
+
+}
+
+#endif //DMLAP_BACKEND_SILENCEGATE_H
@@ -0,0 +1,250 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "TimbreIndex.h"
+#include "VectorKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// Lloyd iterations when building an index (stops earlier once no row changes its cluster)
+constexpr int maxClusterIterations = 10;
+
+float inverseNorm(const float* values, int dimensions) {
+    const float norm = std::sqrt(VectorKernels::dot(values, values, dimensions));
+    return norm > 0.0f ? 1.0f / norm : 0.0f;
+}
+
+// Order of a max-heap: The furthest of the neighbours found so far is on top
+bool isCloser(const TimbreIndex::Neighbour& a, const TimbreIndex::Neighbour& b) {
+    return a.distance < b.distance;
+}
+
+}
+
+void TimbreIndex::build(const vector<Grain>& grainsToIndex, const vector<float>& timbre, int numDimensions, int numLists) {
+    dimensions = max(numDimensions, 0);
+    stride = (dimensions + 7) & ~7;
+    matrix.clear();
+    inverseNorms.clear();
+    grains.clear();
+    centroids.clear();
+    centroidInverseNorms.clear();
+    listStarts.assign(1, 0);
+
+    const int numRows = dimensions > 0 ? static_cast<int>(min(grainsToIndex.size(), timbre.size() / static_cast<size_t>(dimensions))) : 0;
+    if(numRows == 0){
+        return;
+    }
+    if(numLists <= 0){
+        numLists = static_cast<int>(std::sqrt(static_cast<float>(numRows)));
+    }
+    numLists = clamp(numLists, 1, numRows);
+
+    // Padded copy for clustering: The kernels read whole rows
+    vector<float> padded(static_cast<size_t>(numRows) * stride, 0.0f);
+    for(int row = 0; row < numRows; row++){
+        copy_n(timbre.begin() + static_cast<long>(row) * dimensions, dimensions, padded.begin() + static_cast<long>(row) * stride);
+    }
+    vector<int> assignments;
+    cluster(padded, numRows, numLists, assignments);
+
+    // Group the rows by cluster (counting sort), so each cluster is scanned as one contiguous block
+    listStarts.assign(static_cast<size_t>(numLists) + 1, 0);
+    for(int assignment : assignments){
+        listStarts[static_cast<size_t>(assignment) + 1]++;
+    }
+    partial_sum(listStarts.begin(), listStarts.end(), listStarts.begin());
+    vector<int> next(listStarts.begin(), listStarts.end() - 1);
+
+    matrix.assign(padded.size(), 0.0f);
+    inverseNorms.resize(static_cast<size_t>(numRows));
+    grains.resize(static_cast<size_t>(numRows));
+    for(int row = 0; row < numRows; row++){
+        const int destination = next[static_cast<size_t>(assignments[static_cast<size_t>(row)])]++;
+        float* target = matrix.data() + static_cast<long>(destination) * stride;
+        copy_n(padded.begin() + static_cast<long>(row) * stride, stride, target);
+        inverseNorms[static_cast<size_t>(destination)] = inverseNorm(target, dimensions);
+        grains[static_cast<size_t>(destination)] = grainsToIndex[static_cast<size_t>(row)];
+    }
+
+    centroidInverseNorms.resize(static_cast<size_t>(numLists));
+    for(int list = 0; list < numLists; list++){
+        centroidInverseNorms[static_cast<size_t>(list)] = inverseNorm(centroids.data() + static_cast<long>(list) * stride, dimensions);
+    }
+}
+
+void TimbreIndex::cluster(const vector<float>& timbre, int numRows, int numLists, vector<int>& assignments) {
+    // Seed the centroids with distinct rows in a fixed pseudo random order, so an index is the same every time it is built
+    vector<int> order(static_cast<size_t>(numRows));
+    iota(order.begin(), order.end(), 0);
+    mt19937 random(12345);
+    shuffle(order.begin(), order.end(), random);
+    centroids.assign(static_cast<size_t>(numLists) * stride, 0.0f);
+    for(int list = 0; list < numLists; list++){
+        copy_n(timbre.begin() + static_cast<long>(order[static_cast<size_t>(list)]) * stride, stride,
+               centroids.begin() + static_cast<long>(list) * stride);
+    }
+
+    assignments.assign(static_cast<size_t>(numRows), -1);
+    vector<float> distances(static_cast<size_t>(numLists));
+    vector<int> counts(static_cast<size_t>(numLists));
+
+    // Assign every row to its closest centroid, returns the number of rows that changed cluster
+    auto assign = [&] {
+        int changed = 0;
+        for(int row = 0; row < numRows; row++){
+            VectorKernels::squaredL2Rows(timbre.data() + static_cast<long>(row) * stride, centroids.data(), numLists,
+                                         stride, dimensions, distances.data());
+            const int closest = static_cast<int>(min_element(distances.begin(), distances.end()) - distances.begin());
+            if(closest != assignments[static_cast<size_t>(row)]){
+                assignments[static_cast<size_t>(row)] = closest;
+                changed++;
+            }
+        }
+        return changed;
+    };
+
+    // Move every centroid to the mean of its rows. A cluster that lost all its rows restarts at a random row.
+    auto update = [&] {
+        fill(centroids.begin(), centroids.end(), 0.0f);
+        fill(counts.begin(), counts.end(), 0);
+        for(int row = 0; row < numRows; row++){
+            const int list = assignments[static_cast<size_t>(row)];
+            const float* source = timbre.data() + static_cast<long>(row) * stride;
+            float* centroid = centroids.data() + static_cast<long>(list) * stride;
+            for(int i = 0; i < dimensions; i++){
+                centroid[i] += source[i];
+            }
+            counts[static_cast<size_t>(list)]++;
+        }
+        uniform_int_distribution<int> anyRow(0, numRows - 1);
+        for(int list = 0; list < numLists; list++){
+            float* centroid = centroids.data() + static_cast<long>(list) * stride;
+            const int count = counts[static_cast<size_t>(list)];
+            if(count == 0){
+                copy_n(timbre.begin() + static_cast<long>(anyRow(random)) * stride, stride, centroid);
+                continue;
+            }
+            for(int i = 0; i < dimensions; i++){
+                centroid[i] /= static_cast<float>(count);
+            }
+        }
+    };
+
+    assign();
+    for(int iteration = 0; iteration < maxClusterIterations; iteration++){
+        update();
+        if(assign() == 0){
+            break;
+        }
+    }
+}
+
+void TimbreIndex::findClosestLists(const float* query, Metric metric, int numProbes, SearchScratch& scratch) const {
+    const int numLists = getNumLists();
+    scratch.distances.resize(max(scratch.distances.size(), static_cast<size_t>(numLists)));
+    float* distances = scratch.distances.data();
+    if(metric == Metric::l2){
+        VectorKernels::squaredL2Rows(query, centroids.data(), numLists, stride, dimensions, distances);
+    } else {
+        VectorKernels::dotRows(query, centroids.data(), numLists, stride, dimensions, distances);
+        // The query norm scales every similarity alike, so it doesn't change the ranking
+        for(int list = 0; list < numLists; list++){
+            distances[list] = 1.0f - distances[list] * centroidInverseNorms[static_cast<size_t>(list)];
+        }
+    }
+
+    scratch.lists.clear();
+    for(int list = 0; list < numLists; list++){
+        scratch.lists.push_back({ distances[list], list });
+    }
+    numProbes = clamp(numProbes, 1, numLists);
+    if(numProbes < numLists){
+        nth_element(scratch.lists.begin(), scratch.lists.begin() + numProbes, scratch.lists.end(), isCloser);
+        scratch.lists.resize(static_cast<size_t>(numProbes));
+    }
+}
+
+void TimbreIndex::search(const float* query, int k, Metric metric, int numProbes, SearchScratch& scratch, vector<Neighbour>& found) const {
+    found.clear();
+    if(isEmpty() || k <= 0){
+        return;
+    }
+    findClosestLists(query, metric, numProbes, scratch);
+    const float queryInverseNorm = metric == Metric::cosine ? inverseNorm(query, dimensions) : 0.0f;
+
+    for(const Neighbour& list : scratch.lists){
+        const int begin = listStarts[static_cast<size_t>(list.row)];
+        const int count = listStarts[static_cast<size_t>(list.row) + 1] - begin;
+        if(count == 0){
+            continue;
+        }
+        scratch.distances.resize(max(scratch.distances.size(), static_cast<size_t>(count)));
+        float* distances = scratch.distances.data();
+        const float* rows = matrix.data() + static_cast<long>(begin) * stride;
+        if(metric == Metric::l2){
+            VectorKernels::squaredL2Rows(query, rows, count, stride, dimensions, distances);
+        } else {
+            VectorKernels::dotRows(query, rows, count, stride, dimensions, distances);
+            for(int i = 0; i < count; i++){
+                distances[i] = 1.0f - distances[i] * queryInverseNorm * inverseNorms[static_cast<size_t>(begin + i)];
+            }
+        }
+
+        // Keep the k closest in a max-heap
+        for(int i = 0; i < count; i++){
+            if(static_cast<int>(found.size()) < k){
+                found.push_back({ distances[i], begin + i });
+                push_heap(found.begin(), found.end(), isCloser);
+            } else if(distances[i] < found.front().distance){
+                pop_heap(found.begin(), found.end(), isCloser);
+                found.back() = { distances[i], begin + i };
+                push_heap(found.begin(), found.end(), isCloser);
+            }
+        }
+    }
+    sort_heap(found.begin(), found.end(), isCloser);
+}
+
+float TimbreIndex::distance(const float* query, int row, Metric metric) const {
+    const float* values = getRow(row);
+    if(metric == Metric::l2){
+        return VectorKernels::squaredL2(query, values, dimensions);
+    }
+    return 1.0f - VectorKernels::dot(query, values, dimensions) * inverseNorm(query, dimensions)
+                  * inverseNorms[static_cast<size_t>(row)];
+}
+
+const Grain& TimbreIndex::getGrain(int row) const {
+    return grains[static_cast<size_t>(row)];
+}
+
+const float* TimbreIndex::getRow(int row) const {
+    return matrix.data() + static_cast<long>(row) * stride;
+}
+
+int TimbreIndex::size() const {
+    return static_cast<int>(grains.size());
+}
+
+bool TimbreIndex::isEmpty() const {
+    return grains.empty();
+}
+
+size_t TimbreIndex::getMemoryBytes() const {
+    return (matrix.capacity() + inverseNorms.capacity() + centroids.capacity() + centroidInverseNorms.capacity()) * sizeof(float)
+           + grains.capacity() * sizeof(Grain) + listStarts.capacity() * sizeof(int);
+}
+
+int TimbreIndex::getDimensions() const {
+    return dimensions;
+}
+
+int TimbreIndex::getNumLists() const {
+    return static_cast<int>(listStarts.size()) - 1;
+}
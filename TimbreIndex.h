@@ -0,0 +1,131 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_TIMBREINDEX_H
+#define DMLAP_BACKEND_TIMBREINDEX_H
+
+#include <vector>
+#include "Grain.h"
+
+using namespace std;
+
+/**
+ * Nearest neighbour search over the timbre vectors (MFCCs) of the corpus.
+ * The vectors are kept in one contiguous row-major matrix (rows padded to a multiple of 8 floats) and compared with the
+ * SIMD kernels of "VectorKernels.h", by squared euclidean or cosine distance. Range queries per feature, as used for the
+ * four scalar features in the database, don't prune anything at 13 to 40 dimensions, so the index is an inverted file
+ * instead: The rows are clustered with k-means and stored grouped by cluster, and a search only scans the clusters
+ * whose centroids are closest to the query. More probes give better recall at the cost of speed; probing every
+ * cluster is an exact search.
+ * An index is immutable once built and can be searched from any number of threads.
+ */
+class TimbreIndex {
+public:
+    enum class Metric { l2, cosine };
+
+    struct Neighbour {
+        // Squared euclidean distance, or 1 - cosine similarity
+        float distance;
+        // Row of the neighbour (see getGrain)
+        int row;
+    };
+
+    /**
+     * Buffers of a search, owned by the caller so repeated searches don't allocate
+     */
+    struct SearchScratch {
+        vector<Neighbour> lists;
+        vector<float> distances;
+    };
+
+    // Number of clusters scanned per search by default
+    static constexpr int defaultNumProbes = 8;
+
+    TimbreIndex() = default;
+
+    /**
+     * Build the index
+     * @param grains The grains of the rows
+     * @param timbre dimensions values per grain, one grain after another
+     * @param dimensions Length of the timbre vectors
+     * @param numLists Number of clusters, 0 for about the square root of the number of grains
+     */
+    void build(const vector<Grain>& grains, const vector<float>& timbre, int dimensions, int numLists = 0);
+
+    /**
+     * Find the k rows closest to a query
+     * @param query dimensions values
+     * @param k Maximum number of neighbours
+     * @param metric
+     * @param numProbes Number of clusters to scan
+     * @param scratch Buffers of the search
+     * @param found Receives the neighbours, closest first (cleared first, reserve k to avoid allocating)
+     */
+    void search(const float* query, int k, Metric metric, int numProbes, SearchScratch& scratch, vector<Neighbour>& found) const;
+
+    /**
+     * Distance between a query and a row
+     * @param query dimensions values
+     * @param row
+     * @param metric
+     * @return Squared euclidean distance, or 1 - cosine similarity
+     */
+    float distance(const float* query, int row, Metric metric) const;
+
+    const Grain& getGrain(int row) const;
+
+    const float* getRow(int row) const;
+
+    int size() const;
+
+    bool isEmpty() const;
+
+    int getDimensions() const;
+
+    /**
+     * Memory held by the index
+     * @return Bytes of vectors, grains and clusters
+     */
+    size_t getMemoryBytes() const;
+
+    int getNumLists() const;
+
+private:
+    // Length of the vectors
+    int dimensions = 0;
+    // Floats per row in the matrices (dimensions rounded up to a multiple of 8, zero padded)
+    int stride = 0;
+
+    // Timbre vectors, grouped by cluster: The rows of cluster i are listStarts[i] to listStarts[i + 1]
+    vector<float> matrix;
+    // 1 / norm of every row (0 for silent grains), for the cosine distance
+    vector<float> inverseNorms;
+    // Grain of every row
+    vector<Grain> grains;
+
+    // Cluster centroids and their inverse norms
+    vector<float> centroids;
+    vector<float> centroidInverseNorms;
+    vector<int> listStarts;
+
+    /**
+     * Rank the clusters by the distance of their centroid to the query
+     * @param query
+     * @param metric
+     * @param numProbes
+     * @param scratch Receives the numProbes closest clusters in scratch.lists
+     */
+    void findClosestLists(const float* query, Metric metric, int numProbes, SearchScratch& scratch) const;
+
+    /**
+     * Run k-means over the timbre vectors
+     * @param timbre The vectors, padded to the stride
+     * @param numRows
+     * @param numLists
+     * @param assignments Receives the cluster of every row
+     */
+    void cluster(const vector<float>& timbre, int numRows, int numLists, vector<int>& assignments);
+};
+
+#endif //DMLAP_BACKEND_TIMBREINDEX_H
@@ -0,0 +1,63 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "TrajectoryBuffer.h"
+
+TrajectoryBuffer::TrajectoryBuffer(int numChannels, int capacityInSamples) : capacity(capacityInSamples) {
+    // All allocation happens here, the buffers are never resized afterwards
+    for(auto& buffer : buffers){
+        buffer.setSize(numChannels, capacityInSamples);
+        buffer.clear();
+    }
+}
+
+int TrajectoryBuffer::getCapacity() const {
+    return capacity;
+}
+
+AudioBuffer<float>& TrajectoryBuffer::getBackBuffer() {
+    return buffers[backIdx];
+}
+
+void TrajectoryBuffer::setBackLayout(int numGrains, int grainLength) {
+    jassert(numGrains * grainLength <= capacity);
+    layouts[backIdx].numGrains = numGrains;
+    layouts[backIdx].grainLength = grainLength;
+}
+
+TrajectoryBuffer::Layout TrajectoryBuffer::getPublishedLayout() const {
+    Layout layout;
+    layout.numGrains = publishedNumGrains;
+    layout.grainLength = publishedGrainLength;
+    return layout;
+}
+
+void TrajectoryBuffer::publish() {
+    publishedNumGrains = layouts[backIdx].numGrains;
+    publishedGrainLength = layouts[backIdx].grainLength;
+    // Hand the rendered buffer over and take whatever is in the shared slot: Either a retired front buffer or a
+    // published buffer the audio thread never picked up
+    backIdx = middle.exchange(backIdx | freshFlag, memory_order_acq_rel) & indexMask;
+}
+
+bool TrajectoryBuffer::hasLatest() const {
+    return (middle.load(memory_order_acquire) & freshFlag) != 0;
+}
+
+bool TrajectoryBuffer::swapInLatest() {
+    if(!hasLatest()){
+        return false;
+    }
+    // Retire the current front buffer into the shared slot, the writer will reclaim it on its next publish
+    frontIdx = middle.exchange(frontIdx, memory_order_acq_rel) & indexMask;
+    return true;
+}
+
+const AudioBuffer<float>& TrajectoryBuffer::getFrontBuffer() const {
+    return buffers[frontIdx];
+}
+
+const TrajectoryBuffer::Layout& TrajectoryBuffer::getFrontLayout() const {
+    return layouts[frontIdx];
+}
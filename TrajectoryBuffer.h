@@ -0,0 +1,118 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_TRAJECTORYBUFFER_H
+#define DMLAP_BACKEND_TRAJECTORYBUFFER_H
+
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Triple-buffered audio data of a generated trajectory, shared between the thread rendering trajectories (writer) and
+ * the audio thread (reader).
+ * The writer always renders into a private back buffer and publishes it with a single atomic exchange. The audio thread
+ * picks up the latest published buffer at a block boundary, again with a single atomic exchange, so it never sees a
+ * half-rendered trajectory and never blocks. The buffer the audio thread retires is handed back through the same
+ * exchange and is only ever cleared and re-rendered by the writer, i.e. never on the audio thread.
+ * All buffers are preallocated to a fixed capacity. Each one carries the layout (number of grains and grain length) of
+ * the trajectory it holds, so trajectories of different sizes can be served without allocating.
+ */
+class TrajectoryBuffer {
+public:
+    // Layout of a trajectory stored in one of the buffers
+    struct Layout {
+        int numGrains = 0;
+        int grainLength = 0;
+
+        int getNumSamples() const { return numGrains * grainLength; }
+    };
+
+    TrajectoryBuffer(int numChannels, int capacityInSamples);
+
+    /**
+     * Maximum length of a trajectory in samples
+     * @return The capacity of each buffer
+     */
+    int getCapacity() const;
+
+    /**
+     * Writer side: The buffer to render the next trajectory into. Only valid until the next call to publish().
+     * @return The back buffer
+     */
+    AudioBuffer<float>& getBackBuffer();
+
+    /**
+     * Writer side: Publish the back buffer so that the audio thread picks it up at the start of its next block.
+     * If the audio thread has not yet picked up a previously published buffer, that buffer is dropped and becomes
+     * the new back buffer.
+     */
+    void publish();
+
+    /**
+     * Writer side: Set the layout of the trajectory rendered into the back buffer. Must fit into the capacity.
+     * @param numGrains
+     * @param grainLength
+     */
+    void setBackLayout(int numGrains, int grainLength);
+
+    /**
+     * Any thread: Layout of the most recently published trajectory. This may be ahead of the audio thread by one block.
+     * @return The layout
+     */
+    Layout getPublishedLayout() const;
+
+    /**
+     * Audio thread side: Check whether a published buffer is waiting to be swapped in
+     * @return True if swapInLatest() would swap
+     */
+    bool hasLatest() const;
+
+    /**
+     * Audio thread side: Swap in the latest published buffer, if there is one. Call once at the start of each block.
+     * The retired front buffer may be overwritten by the writer from then on.
+     * @return True if a new trajectory was swapped in
+     */
+    bool swapInLatest();
+
+    /**
+     * Audio thread side: The buffer currently being played back.
+     * @return The front buffer
+     */
+    const AudioBuffer<float>& getFrontBuffer() const;
+
+    /**
+     * Audio thread side: Layout of the trajectory currently being played back
+     * @return The layout
+     */
+    const Layout& getFrontLayout() const;
+
+private:
+    // The three buffers. Ownership rotates between writer (back), audio thread (front) and the shared middle slot.
+    AudioBuffer<float> buffers[3];
+    // The layouts travel with their buffers, they are handed over by the same atomic exchange
+    Layout layouts[3];
+    int capacity = 0;
+
+    // Layout of the last published trajectory, for threads other than writer and audio thread
+    atomic<int> publishedNumGrains { 0 };
+    atomic<int> publishedGrainLength { 0 };
+
+    // Index of the buffer owned by the writer
+    int backIdx = 0;
+    // Index of the buffer owned by the audio thread
+    int frontIdx = 1;
+    // Index of the buffer in the shared slot, tagged with freshFlag if it was published but not yet picked up
+    atomic<int> middle { 2 };
+
+    static constexpr int indexMask = 3;
+    static constexpr int freshFlag = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrajectoryBuffer)
+};
+
+
+#endif //DMLAP_BACKEND_TRAJECTORYBUFFER_H
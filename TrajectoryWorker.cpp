@@ -0,0 +1,124 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "TrajectoryWorker.h"
+
+TrajectoryWorker::TrajectoryWorker(Traverser& traverser)
+: Thread("Trajectory worker"), traverser(traverser){
+    startThread();
+}
+
+TrajectoryWorker::~TrajectoryWorker() {
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    // Abort the trajectory in flight so we don't have to wait for it
+    traverser.cancelGeneration();
+    notify();
+    stopThread(4000);
+}
+
+void TrajectoryWorker::submit(vector<float> params, int grainLength, int requestId) {
+    Request request;
+    request.params = std::move(params);
+    request.grainLength = grainLength;
+    request.requestId = requestId;
+    enqueue(std::move(request));
+}
+
+void TrajectoryWorker::submitGrains(vector<Grain> grains, vector<float> timbre) {
+    Request request;
+    request.isFromAudio = true;
+    request.grains = std::move(grains);
+    request.timbre = std::move(timbre);
+    enqueue(std::move(request));
+}
+
+void TrajectoryWorker::enqueue(Request&& request) {
+    bool isReplyDue = false;
+    {
+        const ScopedLock sl (queueLock);
+        if(hasPendingRequest){
+            // The pending request has not been started yet -> replace it. The agent still waits for a reply to it,
+            // whatever replaced it (a recording or upload sends none of its own).
+            numDroppedRequests++;
+            if(!pendingRequest.isFromAudio){
+                finishedRequestIds.emplace_back(pendingRequest.requestId);
+                isReplyDue = true;
+            }
+        }
+        pendingRequest = std::move(request);
+        hasPendingRequest = true;
+        if(isBusy){
+            // The trajectory in flight is stale now. Its ticket was taken under the same lock, so this cancels it even
+            // if it has not reached the traverser yet.
+            traverser.cancelGeneration();
+        }
+    }
+    if(isReplyDue){
+        triggerAsyncUpdate();
+    }
+    notify();
+}
+
+int TrajectoryWorker::getNumDroppedRequests() const {
+    return numDroppedRequests;
+}
+
+bool TrajectoryWorker::takePendingRequest(Request& request, uint64_t& generation) {
+    const ScopedLock sl (queueLock);
+    if(!hasPendingRequest){
+        return false;
+    }
+    std::swap(request, pendingRequest);
+    hasPendingRequest = false;
+    generation = traverser.newGeneration();
+    isBusy = true;
+    return true;
+}
+
+void TrajectoryWorker::run() {
+    Request request;
+    uint64_t generation = 0;
+    while(!threadShouldExit()){
+        if(!takePendingRequest(request, generation)){
+            // Sleep until the next request comes in
+            wait(-1);
+            continue;
+        }
+
+        bool published = request.isFromAudio ? traverser.generateTrajectoryFromGrains(request.grains, request.timbre, generation)
+                                             : traverser.generateTrajectoryFromParams(request.params, request.grainLength, generation);
+        {
+            const ScopedLock sl (queueLock);
+            isBusy = false;
+            if(!request.isFromAudio){
+                // Reply either way, the agent stalls until it hears back
+                finishedRequestIds.emplace_back(request.requestId);
+            }
+        }
+
+        // Without db statistics nothing gets rendered, which is not a drop
+        if(!published && traverser.isMinMaxInitialised()){
+            // Cancelled by a newer request, or by a trajectory generated on another thread
+            numDroppedRequests++;
+        }
+        if(!request.isFromAudio){
+            triggerAsyncUpdate();
+        }
+    }
+}
+
+void TrajectoryWorker::handleAsyncUpdate() {
+    // Several requests may have finished before the message thread got here
+    vector<int> requestIds;
+    {
+        const ScopedLock sl (queueLock);
+        requestIds.swap(finishedRequestIds);
+    }
+    for(int requestId : requestIds){
+        if(onRequestFinished != nullptr){
+            onRequestFinished(requestId);
+        }
+    }
+}
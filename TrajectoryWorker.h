@@ -0,0 +1,108 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_TRAJECTORYWORKER_H
+#define DMLAP_BACKEND_TRAJECTORYWORKER_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "Traverser.h"
+
+using namespace std;
+using namespace juce;
+
+/**
+ * Dedicated background thread generating trajectories from RL parameters or analysed audio, so that neither the OSC
+ * traffic nor the GUI have to wait for database queries, file reads or building the timbre index.
+ * Requests go into a bounded queue with a single slot: A newer request replaces a pending one that has not been started
+ * yet and cancels the one in flight, since the agent only ever cares about its latest set of parameters.
+ * Every request from the agent is reported asynchronously on the message thread via "onRequestFinished", also when it
+ * was cancelled or replaced before it started: The agent waits for a reply before it sends its next request.
+ * Requests from audio (recordings, uploads) share the queue slot, but the agent did not ask for them, so they are not
+ * reported.
+ */
+class TrajectoryWorker : private Thread, private AsyncUpdater {
+public:
+    explicit TrajectoryWorker(Traverser& traverser);
+    ~TrajectoryWorker() override;
+
+    /**
+     * Queue a new set of RL parameters for trajectory generation. Returns immediately.
+     * @param params The grain parameters in the same layout as the "/params" OSC message
+     * @param grainLength Length of the rendered grains in samples
+     * @param requestId Id of the request given by the agent, handed back to onRequestFinished (-1 for none)
+     */
+    void submit(vector<float> params, int grainLength = GRAIN_LENGTH, int requestId = -1);
+
+    /**
+     * Queue analysed audio (e.g. a recording) for trajectory generation, matching its features and timbre. Returns
+     * immediately.
+     * @param grains The analysed grains
+     * @param timbre Their timbre vectors (TIMBRE_DIMENSIONS values per grain), empty to match the features only
+     */
+    void submitGrains(vector<Grain> grains, vector<float> timbre);
+
+    /**
+     * Number of requests that were dropped or cancelled because a newer request superseded them
+     * @return The number of dropped requests since the worker was created
+     */
+    int getNumDroppedRequests() const;
+
+    // Called on the message thread with the id of every request from the agent, whether its trajectory was published,
+    // cancelled or replaced before it started
+    std::function<void(int requestId)> onRequestFinished;
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    struct Request {
+        // RL parameters, the grain length and the agent's id of the request
+        vector<float> params;
+        int grainLength = GRAIN_LENGTH;
+        int requestId = -1;
+        // Requests from audio: Analysed grains and their timbre vectors instead of parameters
+        bool isFromAudio = false;
+        vector<Grain> grains;
+        vector<float> timbre;
+    };
+
+    /**
+     * Put a request into the queue slot, replacing a pending one and cancelling the one in flight
+     * @param request
+     */
+    void enqueue(Request&& request);
+
+    /**
+     * Take the pending request out of the queue
+     * @param request Receives the pending request
+     * @param generation Receives the traverser ticket of the request: Requests submitted from now on cancel it
+     * @return True if there was a pending request
+     */
+    bool takePendingRequest(Request& request, uint64_t& generation);
+
+    // Ref to the traverser
+    Traverser& traverser;
+
+    // The single queue slot, guarded by queueLock
+    CriticalSection queueLock;
+    Request pendingRequest;
+    bool hasPendingRequest = false;
+    // True while the worker is generating a trajectory (guarded by queueLock, so a cancel always hits the request it
+    // was meant for)
+    bool isBusy = false;
+
+    // Statistics
+    atomic<int> numDroppedRequests { 0 };
+    // Ids of the requests finished but not yet reported on the message thread, guarded by queueLock
+    vector<int> finishedRequestIds;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrajectoryWorker)
+};
+
+
+#endif //DMLAP_BACKEND_TRAJECTORYWORKER_H
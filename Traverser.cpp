@@ -3,158 +3,510 @@
 //
 
 #include "Traverser.h"
+#include "VectorKernels.h"
 
-Traverser::Traverser(DBConnector& connector, Analyser& analyser, AudioBuffer<float>& generatedBuffer, vector<Grain>& target)
-    : dbConnector(connector), analyser(analyser), generatedBuffer(generatedBuffer), target(target){
+Traverser::Traverser(DBConnector& connector, Analyser& analyser, TrajectoryBuffer& generatedTrajectory, vector<Grain>& target)
+    : dbConnector(connector), analyser(analyser), generatedTrajectory(generatedTrajectory), target(target){
     formatManager.registerBasicFormats();
 
     calculateFeatureStatistics();
 
-    // Initialise window
-    window = make_unique<dsp::WindowingFunction<float>>(GRAIN_LENGTH, dsp::WindowingFunction<float>::WindowingMethod::hann);
+    // Allocate the trajectory containers up front for the longest trajectory
+    source.reserve(static_cast<size_t>(MAX_GRAINS_IN_TRAJECTORY));
+    target.reserve(static_cast<size_t>(MAX_GRAINS_IN_TRAJECTORY));
+    candidates.reserve(static_cast<size_t>(numCandidates));
+    candidateCosts.reserve(static_cast<size_t>(numCandidates));
+    timbreNeighbours.reserve(static_cast<size_t>(numCandidates));
+    sourceTimbre.reserve(static_cast<size_t>(MAX_GRAINS_IN_TRAJECTORY * TIMBRE_DIMENSIONS));
+    streamCandidates.reserve(static_cast<size_t>(numCandidates));
+    const auto latticeSize = static_cast<size_t>(MAX_GRAINS_IN_TRAJECTORY * numCandidates);
+    latticeGrains.reserve(latticeSize);
+    latticeTargetCosts.reserve(latticeSize);
+    latticePathCosts.reserve(latticeSize);
+    latticeBackPointers.reserve(latticeSize);
+    latticeSizes.reserve(static_cast<size_t>(MAX_GRAINS_IN_TRAJECTORY));
+    ranked.reserve(static_cast<size_t>(numCandidates));
+    beam.reserve(static_cast<size_t>(numCandidates));
+
+    // Initialise windows: One precomputed table per supported grain length
+    for(int grainLength : SUPPORTED_GRAIN_LENGTHS){
+        windows.emplace_back(make_unique<dsp::WindowingFunction<float>>(grainLength, dsp::WindowingFunction<float>::WindowingMethod::hann));
+    }
 }
 
-void Traverser::generateTrajectoryFromParams(vector<float> params){
+bool Traverser::generateTrajectoryFromParams(const vector<float>& params, int grainLength, uint64_t generation){
+    if(generation == 0){
+        generation = newGeneration();
+    }
+    const ScopedLock sl (generationLock);
+    activeGeneration = generation;
+
     if(!init()){
-        return;
+        return false;
     }
+    renderGrainLength = nearestSupportedGrainLength(grainLength);
+
     // Create source from RL parameters
-    // Define length of trajectory
-    for(int i = 0; i < params.size(); i += NUM_FEATURES){
-        float loudness = mapFloat(params[i], 0.0f, 1.0f, minLoudness, maxLoudness);
-        float sc = mapFloat(params[i + 1], 0.0f, 1.0f, minSC, maxSC);
-        float sf = mapFloat(params[i + 2], 0.0f, 1.0f, minSF, maxSF);; // Spectral flux
-        // Limit pitch to 0-10000
-        float pitchHi = 4.0f;
-        float pitch = mapFloat(params[i + 3], 0.0f, pitchHi, minPitch, maxPitch);
-
-        Grain* grain = new Grain(loudness, sc, sf, pitch);
-        source.emplace_back(*grain);
+    // Define length of trajectory: As many complete grains as were sent, limited by what fits into the buffers
+    int maxGrains = jmin(MAX_GRAINS_IN_TRAJECTORY, generatedTrajectory.getCapacity() / renderGrainLength);
+    int numGrains = jmin(static_cast<int>(params.size()) / NUM_FEATURES, maxGrains);
+    for(int i = 0; i < numGrains * NUM_FEATURES; i += NUM_FEATURES){
+        source.emplace_back(paramsToGrain(&params[i]));
     }
-    generateTargetGrainsAndCreateBuffer();
+    return generateTargetGrainsAndCreateBuffer();
+}
+
+Grain Traverser::paramsToGrain(const float* params) const {
+    float features[NUM_FEATURES];
+    for(int i = 0; i < NUM_FEATURES; i++){
+        features[i] = mapFloat(params[i], 0.0f, FeatureSchema::descriptors[i].parameterMax, minFeatures[i], maxFeatures[i]);
+    }
+    return Grain(features);
+}
+
+bool Traverser::renderStreamGrain(const float* params, int grainLength, AudioBuffer<float>& dest, Grain& previous) {
+    if(!isMinMaxInitialised()){
+        return false;
+    }
+    const ScopedLock sl (streamLock);
+    Grain src = paramsToGrain(params);
+    float margin = 100;
+    vector<Grain>& found = streamCandidates;
+    dbConnector.queryClosestGrain(src, margin, numCandidates, found);
+    if(found.empty()){
+        return false;
+    }
+
+    // One step of the Viterbi search: Balance the target distance against the join with the previous grain
+    bool hasPrevious = previous.isValid();
+    int bestIdx = 0;
+    float bestCost = numeric_limits<float>::max();
+    for(int i = 0; i < static_cast<int>(found.size()); i++){
+        float cost = targetDistance(src, found[i]);
+        if(hasPrevious){
+            cost += concatenationCost(previous, found[i], grainLength);
+        }
+        if(cost < bestCost){
+            bestCost = cost;
+            bestIdx = i;
+        }
+    }
+    Grain& best = found[bestIdx];
+
+    AudioFormatReader* reader = getReader(streamReaderCache, best.getFileId());
+    if(reader == nullptr){
+        return false;
+    }
+    dest.clear(0, grainLength);
+    reader->read(&dest, 0, grainLength, best.getIdx(), true, true);
+    // Apply window
+    const dsp::WindowingFunction<float>& window = getWindow(grainLength);
+    window.multiplyWithWindowingTable(dest.getWritePointer(0), grainLength);
+    window.multiplyWithWindowingTable(dest.getWritePointer(1), grainLength);
+
+    previous = best;
+    return true;
+}
+
+bool Traverser::matchParams(const float* params, int numGrains, int grainLength, vector<Grain>& matched, vector<float>& distances) {
+    const ScopedLock sl (generationLock);
+    activeGeneration = latestGeneration;
+
+    matched.clear();
+    distances.clear();
+    if(!isMinMaxInitialised()){
+        return false;
+    }
+
+    // The source vector is free while no trajectory is generated
+    vector<Grain>& src = source;
+    src.clear();
+    sourceTimbre.clear();
+    for(int i = 0; i < numGrains; i++){
+        src.emplace_back(paramsToGrain(params + i * NUM_FEATURES));
+    }
+    float margin = 100;
+    const bool completed = searchMode == SearchMode::viterbi ? matchViterbi(src, matched, margin, numCandidates, grainLength)
+                                                             : matchGreedy(src, matched, margin, numCandidates);
+    if(!completed){
+        return false;
+    }
+
+    distances.reserve(matched.size());
+    for(size_t i = 0; i < matched.size(); i++){
+        distances.emplace_back(matched[i].isValid() ? targetDistance(src[i], matched[i]) : -1.0f);
+    }
+    return true;
 }
 
 void Traverser::generateTrajectoryFromAudio(AudioBuffer<float>& input) {
+    const uint64_t generation = newGeneration();
+    const ScopedLock sl (generationLock);
+    activeGeneration = generation;
+
     if(!init()){
         return;
     }
+    renderGrainLength = GRAIN_LENGTH;
     // Create source from input audio
-    source = analyser.audioBufferToGrains(input);
+    analyser.audioBufferToGrains(input, source, sourceTimbre);
+    prepareTimbreSearch();
+    generateTargetGrainsAndCreateBuffer();
+}
+
+bool Traverser::generateTrajectoryFromGrains(const vector<Grain>& grains, const vector<float>& timbre, uint64_t generation) {
+    if(generation == 0){
+        generation = newGeneration();
+    }
+    const ScopedLock sl (generationLock);
+    activeGeneration = generation;
+
+    if(!init()){
+        return false;
+    }
+    renderGrainLength = GRAIN_LENGTH;
+    source = grains;
+    sourceTimbre = timbre;
+    if(!sourceTimbre.empty()){
+        prepareTimbreSearch();
+    }
     return generateTargetGrainsAndCreateBuffer();
 }
 
 void Traverser::generateRandomTrajectory() {
+    const uint64_t generation = newGeneration();
+    const ScopedLock sl (generationLock);
+    activeGeneration = generation;
+
     if(!init()){
         return;
     }
-    source = dbConnector.queryRandomTrajectory();
-    return generateTargetGrainsAndCreateBuffer();
+    renderGrainLength = GRAIN_LENGTH;
+    dbConnector.queryRandomTrajectory(source);
+    generateTargetGrainsAndCreateBuffer();
+}
+
+void Traverser::fetchCandidates(const vector<Grain>& src, int position, float margin, int k) {
+    const Grain& sourceGrain = src[static_cast<size_t>(position)];
+
+    // Timbre: Only for source grains that were analysed along with the trajectory
+    if(sourceTimbre.size() == src.size() * static_cast<size_t>(TIMBRE_DIMENSIONS)
+       && fetchTimbreCandidates(sourceTimbre.data() + static_cast<long>(position) * TIMBRE_DIMENSIONS, sourceGrain, k)){
+        return;
+    }
+
+    candidateCosts.clear();
+    dbConnector.queryClosestGrain(sourceGrain, margin, k, candidates);
+    for(const Grain& grain : candidates){
+        candidateCosts.emplace_back(targetDistance(sourceGrain, grain));
+    }
+}
+
+bool Traverser::fetchTimbreCandidates(const float* query, const Grain& sourceGrain, int k) {
+    candidates.clear();
+    candidateCosts.clear();
+    auto addCandidate = [&](const Grain& grain, float timbreDistance){
+        candidates.emplace_back(grain);
+        candidateCosts.emplace_back(targetDistance(sourceGrain, grain) + timbreWeight * timbreDistance);
+    };
+
+    if(activeTimbreSearch == TimbreSearch::pq){
+        if(timbreCodes == nullptr){
+            return false;
+        }
+        searchTimbreCodes(*timbreCodes, query, k, timbreRerankFactor, timbreCodeScratch, timbreNeighbours);
+        for(const TimbreIndex::Neighbour& neighbour : timbreNeighbours){
+            addCandidate(timbreCodeScratch.grains[static_cast<size_t>(neighbour.row)], neighbour.distance);
+        }
+    } else if(activeTimbreSearch == TimbreSearch::hnsw){
+        if(timbreGraph == nullptr){
+            return false;
+        }
+        timbreGraph->search(query, k, jmax(timbreEfSearch, k), timbreGraphScratch, timbreNeighbours);
+        for(const TimbreIndex::Neighbour& neighbour : timbreNeighbours){
+            addCandidate(timbreGraph->getGrain(neighbour.row), neighbour.distance);
+        }
+    } else {
+        if(timbreIndex == nullptr || timbreIndex->isEmpty()){
+            return false;
+        }
+        if(activeTimbreSearch == TimbreSearch::ivf){
+            timbreIndex->search(query, k, TimbreIndex::Metric::cosine, timbreProbes, timbreScratch, timbreNeighbours);
+        } else {
+            // Exact: Probe every cluster, and measure the cost for automatic mode
+            const double start = Time::getMillisecondCounterHiRes();
+            timbreIndex->search(query, k, TimbreIndex::Metric::cosine, timbreIndex->getNumLists(), timbreScratch, timbreNeighbours);
+            const double nanosPerRow = (Time::getMillisecondCounterHiRes() - start) * 1.0e6 / timbreIndex->size();
+            exactTimbreNanosPerRow = exactTimbreNanosPerRow == 0.0 ? nanosPerRow : 0.9 * exactTimbreNanosPerRow + 0.1 * nanosPerRow;
+        }
+        for(const TimbreIndex::Neighbour& neighbour : timbreNeighbours){
+            addCandidate(timbreIndex->getGrain(neighbour.row), neighbour.distance);
+        }
+    }
+    return !candidates.empty();
+}
+
+void Traverser::searchTimbreCodes(const PQIndex& codes, const float* query, int k, int rerankFactor,
+                                  CodeSearchScratch& scratch, vector<TimbreIndex::Neighbour>& found) {
+    // The approximate distances of the codes choose the rows, their exact timbre from the database ranks them
+    codes.search(query, k * rerankFactor, scratch.codes, scratch.matches);
+    dbConnector.queryTimbreRows(scratch.matches, scratch.grains, scratch.timbre);
+    found.clear();
+    for(int i = 0; i < static_cast<int>(scratch.grains.size()); i++){
+        if(scratch.grains[static_cast<size_t>(i)].isValid()){
+            found.push_back({ VectorKernels::cosineDistance(query, &scratch.timbre[static_cast<size_t>(i * TIMBRE_DIMENSIONS)], TIMBRE_DIMENSIONS), i });
+        }
+    }
+    const auto numKept = static_cast<long>(jmin(static_cast<size_t>(jmax(0, k)), found.size()));
+    partial_sort(found.begin(), found.begin() + numKept, found.end(),
+                 [](const TimbreIndex::Neighbour& a, const TimbreIndex::Neighbour& b){ return a.distance < b.distance; });
+    found.resize(static_cast<size_t>(numKept));
 }
 
-Grain Traverser::findBestGrain(Grain& src, vector<Grain>& grains) const {
-    float wLoudness = 1.0f;
-    float wSC = 2.0f;
-    float wSF = 1.0f;
-    float wPitch = 3.0f;
+AudioFormatReader* Traverser::getReader(ReaderCache& cache, int fileId) {
+    CachedReader& slot = cache[static_cast<size_t>(fileId) % cache.size()];
+    if(slot.fileId != fileId){
+        slot.reader.reset(formatManager.createReaderFor(File(dbConnector.getFilePath(fileId))));
+        slot.fileId = fileId;
+    }
+    return slot.reader.get();
+}
 
-    Grain bestMatch;
-    vector<float> distances;
-    for(Grain& candidate : grains){
-        float distance = 0.0f;
-        // Normalise values
-        float distLoudness = powf((normaliseValue(candidate.getLoudness(), maxLoudness) - normaliseValue(src.getLoudness(), maxLoudness)), 2) * wLoudness;
-        float distSC = powf((normaliseValue(candidate.getSpectralCentroid(), maxSC) - normaliseValue(src.getSpectralCentroid(), maxSC)), 2) * wSC;
-        float distSF = powf((normaliseValue(candidate.getSpectralFlux(), maxSF) - normaliseValue(src.getSpectralFlux(), maxSF)), 2) * wSF;
-        float distPitch = powf((normaliseValue(candidate.getPitch(), maxPitch) - normaliseValue(src.getPitch(), maxPitch)), 2) * wPitch;
+float Traverser::targetDistance(const Grain& src, const Grain& candidate) const {
+    return FeatureSchema::weightedDistance(candidate.getFeatures(), src.getFeatures(), distanceScales.data());
+}
 
-        distance = distLoudness + distSC + distSF + distPitch;
-        distances.emplace_back(distance);
+float Traverser::concatenationCost(const Grain& previous, const Grain& next, int grainLength) const {
+    float cost = discontinuityWeight * targetDistance(previous, next);
+    // Contiguous audio from the same file joins without a seam
+    if(next.continues(previous, grainLength)){
+        cost -= contiguityBonus;
     }
-    // Find index of min distance
-    int minElementIdx = min_element(distances.begin(), distances.end()) - distances.begin();
+    return cost;
+}
 
-    bestMatch = grains.at(minElementIdx);
+void Traverser::prepareTimbreSearch() {
+    TimbreSearch mode = timbreSearch;
+    if(mode == TimbreSearch::pq){
+        // Compressed only: The full precision indexes are not built
+        timbreCodes = dbConnector.getTimbreCodes();
+        activeTimbreSearch = mode;
+        return;
+    }
+    timbreIndex = dbConnector.getTimbreIndex();
+    if(mode == TimbreSearch::automatic){
+        // Exact as long as the predicted time of its searches for this trajectory fits the budget. The prediction comes
+        // from the exact searches so far: The first trajectory is always searched exactly.
+        const double predictedMs = exactTimbreNanosPerRow * timbreIndex->size() * static_cast<double>(source.size()) / 1.0e6;
+        mode = predictedMs <= timbreLatencyBudgetMs ? TimbreSearch::exact : TimbreSearch::hnsw;
+    }
+    if(mode == TimbreSearch::hnsw){
+        timbreGraph = dbConnector.getTimbreGraph();
+    }
+    activeTimbreSearch = mode;
+}
 
-    return bestMatch;
+bool Traverser::generateTargetGrains(float margin){
+    if(searchMode == SearchMode::viterbi){
+        return matchViterbi(source, target, margin, numCandidates, renderGrainLength);
+    }
+    return matchGreedy(source, target, margin, numCandidates);
 }
 
-void Traverser::generateTargetGrains(float margin){
-    target.clear();
+bool Traverser::matchGreedy(const vector<Grain>& src, vector<Grain>& out, float margin, int k){
+    out.clear();
+
+    for(int t = 0; t < static_cast<int>(src.size()); t++){
+        if(isCancelled()){
+            return false;
+        }
+        fetchCandidates(src, t, margin, k);
+
+        // Take the candidate with the lowest target cost
+        if(candidates.empty()){
+            out.emplace_back();
+        } else {
+            const auto best = min_element(candidateCosts.begin(), candidateCosts.end()) - candidateCosts.begin();
+            out.emplace_back(candidates[static_cast<size_t>(best)]);
+        }
+    }
+    return true;
+}
+
+bool Traverser::matchViterbi(const vector<Grain>& src, vector<Grain>& out, float margin, int k, int grainLength){
+    out.clear();
+    const int numPositions = static_cast<int>(src.size());
+    if(numPositions == 0){
+        return true;
+    }
 
-    for(Grain& sourceGrain : source){
-        vector<Grain> found = dbConnector.queryClosestGrain(sourceGrain, margin);
-        Grain bestMatch;
+    // Lattice: Flat arrays with k entries per position, they only grow
+    const auto latticeSize = static_cast<size_t>(numPositions * k);
+    latticeGrains.resize(latticeSize);
+    latticeTargetCosts.resize(latticeSize);
+    latticePathCosts.resize(latticeSize);
+    latticeBackPointers.resize(latticeSize);
+    latticeSizes.assign(static_cast<size_t>(numPositions), 0);
+
+    // Fetch the k best candidates for each position. This is the same number of queries as the greedy search.
+    for(int t = 0; t < numPositions; t++){
+        if(isCancelled()){
+            return false;
+        }
+        fetchCandidates(src, t, margin, k);
+        ranked.clear();
+        for(int j = 0; j < static_cast<int>(candidates.size()); j++){
+            ranked.emplace_back(candidateCosts[static_cast<size_t>(j)], j);
+        }
+        sort(ranked.begin(), ranked.end());
+        const int numFound = jmin(k, static_cast<int>(ranked.size()));
+        for(int j = 0; j < numFound; j++){
+            latticeGrains[t * k + j] = candidates[ranked[j].second];
+            latticeTargetCosts[t * k + j] = ranked[j].first;
+        }
+        latticeSizes[t] = numFound;
+    }
 
-        if(!found.empty()){
-            // Calculate best grain based on weighted euclidean distance
-            bestMatch = findBestGrain(sourceGrain, found);
+    // Forward pass
+    for(int j = 0; j < latticeSizes[0]; j++){
+        latticePathCosts[j] = latticeTargetCosts[j];
+        latticeBackPointers[j] = -1;
+    }
+    for(int t = 1; t < numPositions; t++){
+        if(isCancelled()){
+            return false;
+        }
+        const int previous = (t - 1) * k;
+        const int current = t * k;
+
+        // Beam pruning: Only the cheapest paths into the previous position are extended
+        beam.resize(static_cast<size_t>(latticeSizes[t - 1]));
+        iota(beam.begin(), beam.end(), 0);
+        const int beamSize = jmin(beamWidth, static_cast<int>(beam.size()));
+        const float* previousCosts = latticePathCosts.data() + previous;
+        partial_sort(beam.begin(), beam.begin() + beamSize, beam.end(),
+                     [previousCosts](int a, int b){ return previousCosts[a] < previousCosts[b]; });
+        beam.resize(static_cast<size_t>(beamSize));
+
+        for(int j = 0; j < latticeSizes[t]; j++){
+            // If the previous position has no candidates the path simply restarts here
+            float bestCost = beam.empty() ? 0.0f : numeric_limits<float>::max();
+            latticeBackPointers[current + j] = -1;
+            for(int i : beam){
+                float cost = previousCosts[i] + concatenationCost(latticeGrains[previous + i], latticeGrains[current + j], grainLength);
+                if(cost < bestCost){
+                    bestCost = cost;
+                    latticeBackPointers[current + j] = i;
+                }
+            }
+            latticePathCosts[current + j] = bestCost + latticeTargetCosts[current + j];
         }
+    }
 
-        target.emplace_back(bestMatch);
+    // Backtrack from the cheapest complete path
+    auto cheapest = [this, k](int t){
+        if(latticeSizes[t] == 0){
+            return -1;
+        }
+        const auto first = latticePathCosts.begin() + t * k;
+        return static_cast<int>(min_element(first, first + latticeSizes[t]) - first);
+    };
+    out.assign(static_cast<size_t>(numPositions), Grain());
+    int j = cheapest(numPositions - 1);
+    for(int t = numPositions - 1; t >= 0; t--){
+        if(j < 0){
+            // Path was broken by a position without candidates
+            j = cheapest(t);
+            if(j < 0){
+                continue;
+            }
+        }
+        out[t] = latticeGrains[t * k + j];
+        j = latticeBackPointers[t * k + j];
     }
+    return true;
 }
-void Traverser::generateTargetGrainsAndCreateBuffer(){
+
+bool Traverser::generateTargetGrainsAndCreateBuffer(){
     // Find target grains from database
     float margin = 100;
 
-    generateTargetGrains(margin);
+    if(!generateTargetGrains(margin)){
+        return false;
+    }
 
     // Get sound data
-    int channels = 2;
-    int bufferIdx = 0;
-
-    for(Grain& grain : target){
-        // Check if grain is valid
-        if(!grain.getPath().empty()){
-            // Load audio file if not yet in memory
-            ScopedPointer<AudioFormatReader> reader = formatManager.createReaderFor(File(grain.getPath()));
-            reader->read(&generatedBuffer, bufferIdx, GRAIN_LENGTH, grain.getIdx(), true, true);
+    // Render into the back buffer: The audio thread keeps playing the previous trajectory until we publish
+    AudioBuffer<float>& backBuffer = generatedTrajectory.getBackBuffer();
+    const int grainLength = renderGrainLength;
+    const int numGrains = jmin(static_cast<int>(target.size()), generatedTrajectory.getCapacity() / grainLength);
+    backBuffer.clear(0, numGrains * grainLength);
+    // Every grain is windowed once here, whichever mode plays it: Granular voices play the windowed grains as they are
+    const dsp::WindowingFunction<float>& window = getWindow(grainLength);
+
+    for(int i = 0; i < numGrains; i++){
+        if(isCancelled()){
+            return false;
+        }
+        Grain& grain = target[i];
+        int bufferIdx = i * grainLength;
+        // Check if grain is valid, invalid grains are left silent
+        if(grain.isValid()){
+            // Open audio file if it is not open yet
+            AudioFormatReader* reader = getReader(readerCache, grain.getFileId());
+            if(reader == nullptr){
+                continue;
+            }
+            reader->read(&backBuffer, bufferIdx, grainLength, grain.getIdx(), true, true);
             // Apply window
-            window->multiplyWithWindowingTable(generatedBuffer.getWritePointer(0, bufferIdx), GRAIN_LENGTH);
-            window->multiplyWithWindowingTable(generatedBuffer.getWritePointer(1, bufferIdx), GRAIN_LENGTH);
-            bufferIdx += GRAIN_LENGTH;
+            window.multiplyWithWindowingTable(backBuffer.getWritePointer(0, bufferIdx), grainLength);
+            window.multiplyWithWindowingTable(backBuffer.getWritePointer(1, bufferIdx), grainLength);
         }
     }
+
+    // Hand the complete trajectory over to the audio thread
+    generatedTrajectory.setBackLayout(numGrains, grainLength);
+    generatedTrajectory.publish();
+    return true;
 }
 
 void Traverser::calculateFeatureStatistics() {
     // Get min and max values from database
-    if (dbConnector.isPopulated()){
-        string loudness = "LOUDNESS";
-        string sc = "SPECTRAL_CENTROID";
-        string sf = "SPECTRAL_FLUX";
-        string pitch = "PITCH";
-
-        minLoudness = dbConnector.queryMin(loudness);
-        maxLoudness = dbConnector.queryMax(loudness);
-        meanLoudness = dbConnector.queryMean(loudness);
-        stdLoudness = dbConnector.queryStd(loudness);
-
-        minSC = dbConnector.queryMin(sc);
-        maxSC = dbConnector.queryMax(sc);
-        meanSC = dbConnector.queryMean(sc);
-        stdSC = dbConnector.queryStd(sc);
-
-        minSF = dbConnector.queryMin(sf);
-        maxSF = dbConnector.queryMax(sf);
-        meanSF = dbConnector.queryMean(sf);
-        stdSF = dbConnector.queryStd(sf);
-
-        minPitch = dbConnector.queryMin(pitch);
-        maxPitch = dbConnector.queryMax(pitch);
-        meanPitch = dbConnector.queryMean(pitch);
-        stdPitch = dbConnector.queryStd(pitch);
+    if (!dbConnector.isPopulated()){
+        return;
     }
+    array<float, FeatureSchema::numFeatures> minimum, maximum, mean, deviation, scales;
+    for(int i = 0; i < NUM_FEATURES; i++){
+        const string column = FeatureSchema::descriptors[i].column;
+        minimum[i] = dbConnector.queryMin(column);
+        maximum[i] = dbConnector.queryMax(column);
+        mean[i] = dbConnector.queryMean(column);
+        deviation[i] = dbConnector.queryStd(column);
+        // A feature that is 0 throughout the corpus doesn't tell grains apart
+        scales[i] = maximum[i] != 0.0f ? 1.0f / maximum[i] : 0.0f;
+    }
+
+    // The queries run unlocked. Trajectory generation and streaming read the statistics on their own threads, so they
+    // are swapped in under both locks and never seen half updated.
+    const ScopedLock gl (generationLock);
+    const ScopedLock sl (streamLock);
+    minFeatures = minimum;
+    maxFeatures = maximum;
+    meanFeatures = mean;
+    stdFeatures = deviation;
+    distanceScales = scales;
+    hasStatistics = static_cast<int>(maxFeatures[FeatureSchema::loudness]) > 0;
 }
 
 bool Traverser::isMinMaxInitialised() const {
-    return static_cast<int>(maxLoudness) > 0;
+    return hasStatistics;
 }
 
 bool Traverser::init() {
     // Clear source and target vectors
     source.clear();
     target.clear();
+    sourceTimbre.clear();
 
     if(isMinMaxInitialised()){
         return true;
@@ -167,22 +519,219 @@ bool Traverser::init() {
 
 vector<float> Traverser::convertAudioBufferToRLFormat(AudioBuffer<float> &buffer) {
     // Convert audio into grains
-    vector<Grain> grains = analyser.audioBufferToGrains(buffer);
+    return convertGrainsToRLFormat(analyser.audioBufferToGrains(buffer));
+}
 
+vector<float> Traverser::convertGrainsToRLFormat(const vector<Grain>& grains) const {
     vector<float> data;
     data.reserve(grains.size() * static_cast<unsigned long>(NUM_FEATURES));
 
-    for(auto& grain : grains){
+    for(const auto& grain : grains){
         // Map each property
-        data.emplace_back(mapFloat(grain.getLoudness(), minLoudness, maxLoudness, 0.0f, 1.0f));
-        data.emplace_back(mapFloat(grain.getSpectralCentroid(), minSC, maxSC, 0.0f, 1.0f));
-        data.emplace_back(mapFloat(grain.getSpectralFlux(), minSF, maxSF, 0.0f, 1.0f));
-        data.emplace_back(mapFloat(grain.getPitch(), minPitch, maxPitch, 0.0f, 1.0f));
+        for(int i = 0; i < NUM_FEATURES; i++){
+            data.emplace_back(mapFloat(grain.getFeatures()[i], minFeatures[i], maxFeatures[i], 0.0f, 1.0f));
+        }
     }
 
     return data;
 }
 
-float Traverser::normaliseValue(float in, float ref) {
-    return in / ref;
+const dsp::WindowingFunction<float>& Traverser::getWindow(int grainLength) const {
+    for(int i = 0; i < NUM_SUPPORTED_GRAIN_LENGTHS; i++){
+        if(SUPPORTED_GRAIN_LENGTHS[i] == grainLength){
+            return *windows[i];
+        }
+    }
+    jassertfalse;
+    return *windows[0];
+}
+
+void Traverser::cancelGeneration() {
+    latestGeneration++;
+}
+
+uint64_t Traverser::newGeneration() {
+    return ++latestGeneration;
+}
+
+bool Traverser::isCancelled() const {
+    return latestGeneration.load(memory_order_relaxed) != activeGeneration;
+}
+
+void Traverser::setSearchMode(SearchMode mode) {
+    searchMode = mode;
+}
+
+Traverser::SearchMode Traverser::getSearchMode() const {
+    return searchMode;
+}
+
+void Traverser::setTimbreSearch(TimbreSearch mode, float latencyBudgetMs) {
+    timbreSearch = mode;
+    timbreLatencyBudgetMs = jmax(0.0f, latencyBudgetMs);
+}
+
+Traverser::TimbreSearch Traverser::getTimbreSearch() const {
+    return timbreSearch;
+}
+
+String Traverser::benchmarkSearch(int k, int numRuns) {
+    const ScopedLock sl (generationLock);
+    activeGeneration = latestGeneration;
+
+    if(!isMinMaxInitialised()){
+        return "Benchmark: database statistics not available.";
+    }
+
+    // Counts how many adjacent grains continue the audio of their predecessor
+    auto countContiguousJoins = [](const vector<Grain>& grains){
+        int joins = 0;
+        for(size_t i = 1; i < grains.size(); i++){
+            if(grains[i].continues(grains[i - 1], GRAIN_LENGTH)){
+                joins++;
+            }
+        }
+        return joins;
+    };
+
+    float margin = 100;
+    Random random;
+    vector<Grain> src;
+    vector<Grain> out;
+    double greedyMs = 0.0;
+    double viterbiMs = 0.0;
+    int greedyJoins = 0;
+    int viterbiJoins = 0;
+
+    for(int run = 0; run < numRuns; run++){
+        // Random trajectory within the range of the corpus
+        src.clear();
+        for(int i = 0; i < GRAINS_IN_TRAJECTORY; i++){
+            float features[NUM_FEATURES];
+            for(int feature = 0; feature < NUM_FEATURES; feature++){
+                features[feature] = mapFloat(random.nextFloat(), 0.0f, 1.0f, minFeatures[feature], maxFeatures[feature]);
+            }
+            src.emplace_back(features);
+        }
+
+        double start = Time::getMillisecondCounterHiRes();
+        matchGreedy(src, out, margin, k);
+        greedyMs += Time::getMillisecondCounterHiRes() - start;
+        greedyJoins += countContiguousJoins(out);
+
+        start = Time::getMillisecondCounterHiRes();
+        matchViterbi(src, out, margin, k, GRAIN_LENGTH);
+        viterbiMs += Time::getMillisecondCounterHiRes() - start;
+        viterbiJoins += countContiguousJoins(out);
+    }
+
+    return "Benchmark k=" + String(k) + " (" + String(numRuns) + " runs of " + String(GRAINS_IN_TRAJECTORY) + " grains): "
+           + "greedy " + String(greedyMs / numRuns, 2) + " ms, " + String(greedyJoins) + " contiguous joins / "
+           + "viterbi " + String(viterbiMs / numRuns, 2) + " ms, " + String(viterbiJoins) + " contiguous joins";
+}
+
+String Traverser::benchmarkTimbreSearch(int k, int numQueries) {
+    const ScopedLock sl (generationLock);
+
+    shared_ptr<const TimbreIndex> index = dbConnector.getTimbreIndex();
+    if(index->isEmpty() || numQueries <= 0){
+        return "Timbre benchmark: no timbre vectors in the database.";
+    }
+    shared_ptr<const HNSWIndex> graph = dbConnector.getTimbreGraph();
+
+    // Queries: Timbre vectors of random grains, each value off by up to 10%
+    Random random;
+    vector<float> queries;
+    for(int q = 0; q < numQueries; q++){
+        const float* row = index->getRow(random.nextInt(index->size()));
+        for(int i = 0; i < TIMBRE_DIMENSIONS; i++){
+            queries.push_back(row[i] * (1.0f + 0.1f * (2.0f * random.nextFloat() - 1.0f)));
+        }
+    }
+
+    TimbreIndex::SearchScratch scratch;
+    HNSWIndex::SearchScratch graphScratch;
+    vector<TimbreIndex::Neighbour> found;
+
+    // Ground truth: Exact search
+    vector<vector<Grain>> exact(static_cast<size_t>(numQueries));
+    double start = Time::getMillisecondCounterHiRes();
+    for(int q = 0; q < numQueries; q++){
+        index->search(&queries[static_cast<size_t>(q * TIMBRE_DIMENSIONS)], k, TimbreIndex::Metric::cosine, index->getNumLists(), scratch, found);
+        for(const TimbreIndex::Neighbour& neighbour : found){
+            exact[static_cast<size_t>(q)].push_back(index->getGrain(neighbour.row));
+        }
+    }
+    const double exactMs = (Time::getMillisecondCounterHiRes() - start) / numQueries;
+
+    // Share of the exact neighbours of a query that a search found
+    int hits = 0;
+    int total = 0;
+    auto countHits = [&](int q, const Grain& grain){
+        for(const Grain& expected : exact[static_cast<size_t>(q)]){
+            if(expected.getFileId() == grain.getFileId() && expected.getIdx() == grain.getIdx()){
+                hits++;
+                return;
+            }
+        }
+    };
+    auto resetRecall = [&]{
+        hits = 0;
+        total = 0;
+        for(const auto& neighbours : exact){
+            total += static_cast<int>(neighbours.size());
+        }
+    };
+
+    String summary = "Timbre benchmark k=" + String(k) + " (" + String(numQueries) + " queries, " + String(index->size())
+                     + " grains, " + (VectorKernels::isUsingAVX2() ? "AVX2" : "portable") + " kernels): "
+                     + "exact " + String(exactMs, 3) + " ms";
+
+    // Inverted file
+    resetRecall();
+    start = Time::getMillisecondCounterHiRes();
+    for(int q = 0; q < numQueries; q++){
+        index->search(&queries[static_cast<size_t>(q * TIMBRE_DIMENSIONS)], k, TimbreIndex::Metric::cosine, timbreProbes, scratch, found);
+        for(const TimbreIndex::Neighbour& neighbour : found){
+            countHits(q, index->getGrain(neighbour.row));
+        }
+    }
+    summary += " / ivf (" + String(timbreProbes) + " of " + String(index->getNumLists()) + " clusters) "
+               + String((Time::getMillisecondCounterHiRes() - start) / numQueries, 3) + " ms, recall "
+               + String(static_cast<double>(hits) / jmax(1, total), 3);
+
+    // Graph at increasing efSearch
+    for(int ef : { k, 2 * k, 4 * k, 8 * k }){
+        resetRecall();
+        start = Time::getMillisecondCounterHiRes();
+        for(int q = 0; q < numQueries; q++){
+            graph->search(&queries[static_cast<size_t>(q * TIMBRE_DIMENSIONS)], k, ef, graphScratch, found);
+            for(const TimbreIndex::Neighbour& neighbour : found){
+                countHits(q, graph->getGrain(neighbour.row));
+            }
+        }
+        summary += " / hnsw ef=" + String(ef) + " " + String((Time::getMillisecondCounterHiRes() - start) / numQueries, 3)
+                   + " ms, recall " + String(static_cast<double>(hits) / jmax(1, total), 3);
+    }
+
+    // Compressed codes, re-ranking more and more rows with their exact timbre from the database
+    shared_ptr<const PQIndex> codes = dbConnector.getTimbreCodes();
+    CodeSearchScratch codeScratch;
+    for(int factor : { 1, 4, 16 }){
+        resetRecall();
+        start = Time::getMillisecondCounterHiRes();
+        for(int q = 0; q < numQueries; q++){
+            searchTimbreCodes(*codes, &queries[static_cast<size_t>(q * TIMBRE_DIMENSIONS)], k, factor, codeScratch, found);
+            for(const TimbreIndex::Neighbour& neighbour : found){
+                countHits(q, codeScratch.grains[static_cast<size_t>(neighbour.row)]);
+            }
+        }
+        summary += " / pq rerank " + String(factor) + "x " + String((Time::getMillisecondCounterHiRes() - start) / numQueries, 3)
+                   + " ms, recall " + String(static_cast<double>(hits) / jmax(1, total), 3);
+    }
+
+    summary += " / memory: index " + String(index->getMemoryBytes() / 1024) + " KiB, graph "
+               + String(graph->getMemoryBytes() / 1024) + " KiB, pq " + String(codes->getMemoryBytes() / 1024) + " KiB ("
+               + String(codes->getNumSubspaces()) + " bytes per code)";
+    return summary;
 }
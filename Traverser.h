@@ -6,26 +6,53 @@
 #define DMLAP_BACKEND_TRAVERSER_H
 
 #include <cstdio>
+#include <array>
 #include <vector>
 #include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "sqlite3.h"
 #include "DBConnector.h"
 #include "Grain.h"
+#include "FeatureSchema.h"
 #include "Constants.h"
 #include "Utility.h"
 #include "Analyser.h"
+#include "TrajectoryBuffer.h"
 
 using namespace std;
 using namespace juce;
 
 /**
  * The traverser class is responsible for creating trajectories through the grain space. It can use different modalities to create the trajectories.
+ * All containers used while generating a trajectory (source and target grains, database candidates, the Viterbi
+ * lattice, open audio files) are kept between trajectories, so generating one does not allocate in steady state.
  */
 class Traverser {
 public:
-    Traverser(DBConnector& connector, Analyser& analyser, AudioBuffer<float>& generatedBuffer, vector<Grain>& target);
+    /**
+     * How target grains are matched to the source trajectory.
+     * greedy: Every position independently gets the grain closest to its target.
+     * viterbi: Unit selection - the whole trajectory is chosen at once, trading target distance against the
+     * concatenation cost between adjacent grains (beam-pruned Viterbi search over the k best candidates per position).
+     */
+    enum class SearchMode { greedy, viterbi };
+
+    /**
+     * How candidates are found by timbre (audio-driven trajectories).
+     * exact: Every grain of the corpus is compared (contiguous SIMD scan).
+     * ivf: Only the closest clusters of the inverted file are scanned (see TimbreIndex).
+     * hnsw: Approximate graph search (see HNSWIndex), for corpora too large for a scan.
+     * pq: Scan of compressed codes, re-ranked with the exact timbre from the database (see PQIndex), for hosts with
+     * little memory. Nothing else is loaded, as long as no other mode is used.
+     * automatic: Per trajectory, exact if the measured cost of an exact scan fits the latency budget, hnsw otherwise.
+     */
+    enum class TimbreSearch { exact, ivf, hnsw, pq, automatic };
+
+    Traverser(DBConnector& connector, Analyser& analyser, TrajectoryBuffer& generatedTrajectory, vector<Grain>& target);
 
     /**
      * Generate a random trajectory through the grain space
@@ -33,13 +60,41 @@ public:
     void generateRandomTrajectory();
 
     /**
-     * Generate a trajectory through the grain space using parameters from the python RL agent
+     * Generate a trajectory through the grain space using parameters from the python RL agent.
+     * The trajectory has one grain per NUM_FEATURES parameters, limited to what fits into the trajectory buffers.
      * @param params
+     * @param grainLength Length of the rendered grains in samples, snapped to the closest supported grain length
+     * @param generation Ticket from newGeneration() taken when the request was accepted, 0 to take one now
+     * @return True if the trajectory was published, false if the traverser is not initialised or generation was cancelled
      */
-    void generateTrajectoryFromParams(vector<float> params);
+    bool generateTrajectoryFromParams(const vector<float>& params, int grainLength = GRAIN_LENGTH, uint64_t generation = 0);
 
     /**
-     * Generate a trajectory through the grain space using recorded audio data
+     * Streaming mode: Match a single grain target and render it, without touching the trajectory buffers.
+     * Does not take the generation lock, so a stream never waits for a trajectory: It has its own candidates and reader
+     * cache, guarded by a lock of their own. Only one stream renders at a time (the render thread of GrainStream).
+     * @param params NUM_FEATURES parameters of the target grain, in the same layout and range as "/params"
+     * @param grainLength Length of the rendered grain in samples, one of SUPPORTED_GRAIN_LENGTHS
+     * @param dest Buffer (2 channels, at least grainLength samples) receiving the windowed grain at index 0
+     * @param previous The previously streamed grain, used for the concatenation cost. Updated to the chosen grain.
+     * @return True if a grain was rendered
+     */
+    bool renderStreamGrain(const float* params, int grainLength, AudioBuffer<float>& dest, Grain& previous);
+
+    /**
+     * Batch evaluation: Match RL parameters against the corpus with the current search mode, without rendering any
+     * audio. Does not touch the trajectory buffers.
+     * @param params NUM_FEATURES parameters per grain, in the same layout and range as "/params"
+     * @param numGrains Number of grains
+     * @param grainLength Length the grains would be rendered with, in samples
+     * @param matched Receives one grain per target, an invalid grain where nothing was found
+     * @param distances Receives the target distance of each matched grain, -1 where nothing was found
+     * @return False if the database statistics are not available
+     */
+    bool matchParams(const float* params, int numGrains, int grainLength, vector<Grain>& matched, vector<float>& distances);
+
+    /**
+     * Generate a trajectory through the grain space using recorded audio data, matching features and timbre
      * @param buffer
      */
     void generateTrajectoryFromAudio(AudioBuffer<float>& buffer);
@@ -52,7 +107,26 @@ public:
     vector<float> convertAudioBufferToRLFormat(AudioBuffer<float>& buffer);
 
     /**
-     * Helper method to calculate statistics for all the audio features in the database
+     * Generate a trajectory through the grain space from grains that were already analysed (e.g. while recording).
+     * The first search by timbre builds the timbre index, so this belongs on a background thread (see TrajectoryWorker).
+     * @param grains
+     * @param timbre Optional timbre vectors of the grains (TIMBRE_DIMENSIONS values per grain). With timbre the
+     * candidates are the grains of the corpus with the closest timbre, ranked by features and timbre together.
+     * @param generation Ticket from newGeneration() taken when the request was accepted, 0 to take one now
+     * @return True if the trajectory was published, false if the traverser is not initialised or generation was cancelled
+     */
+    bool generateTrajectoryFromGrains(const vector<Grain>& grains, const vector<float>& timbre = {}, uint64_t generation = 0);
+
+    /**
+     * Helper method for sending grains to the RL agent: Maps analysed grains to RL parameters
+     * @param grains
+     * @return
+     */
+    vector<float> convertGrainsToRLFormat(const vector<Grain>& grains) const;
+
+    /**
+     * Helper method to calculate statistics for all the audio features in the database. Safe to call while trajectories
+     * are generated or streamed on other threads: It waits for the trajectory or stream grain in progress.
      */
     void calculateFeatureStatistics();
 
@@ -62,21 +136,126 @@ public:
      */
     bool isMinMaxInitialised() const;
 
+    /**
+     * Cancel the trajectory generation currently in flight (if any), and every generation whose ticket was taken
+     * before this call but which has not started yet. Safe to call from any thread.
+     * A cancelled generation returns early and does not publish its audio. Every generate method implicitly cancels
+     * the one in flight, since a newer trajectory always supersedes an older one.
+     */
+    void cancelGeneration();
+
+    /**
+     * Take the ticket of a new generation, cancelling every older one. The generation is cancelled by any later call to
+     * cancelGeneration() or newGeneration(), even one made before it acquired the generation lock. Safe to call from
+     * any thread.
+     * @return The ticket, never 0
+     */
+    uint64_t newGeneration();
+
+    /**
+     * Set the search mode used for all subsequently generated trajectories. Safe to call from any thread.
+     * @param mode
+     */
+    void setSearchMode(SearchMode mode);
+
+    SearchMode getSearchMode() const;
+
+    /**
+     * Set how candidates are found by timbre for all subsequently generated trajectories. Safe to call from any thread.
+     * @param mode
+     * @param latencyBudgetMs automatic: Time the timbre searches of one trajectory may take
+     */
+    void setTimbreSearch(TimbreSearch mode, float latencyBudgetMs);
+
+    TimbreSearch getTimbreSearch() const;
+
+    /**
+     * Benchmark greedy against Viterbi matching on random trajectories (database queries and search only, no rendering)
+     * @param k Number of candidates per position
+     * @param numRuns Number of random trajectories to match
+     * @return Human readable summary of average latencies and contiguous grain joins
+     */
+    String benchmarkSearch(int k, int numRuns);
+
+    /**
+     * Benchmark the timbre searches against the exact search: Recall@k and latency of the inverted file, of the
+     * HNSW graph at several efSearch values and of the compressed codes at several re-rank factors (through the same
+     * search as generation)
+     * @param k Number of neighbours
+     * @param numQueries Number of queries (timbre vectors of random grains with some noise)
+     * @return Human readable summary
+     */
+    String benchmarkTimbreSearch(int k, int numQueries);
+
 
 private:
+    // Buffers of a compressed timbre search: Matches of the codes, then the rows being re-ranked
+    struct CodeSearchScratch {
+        PQIndex::SearchScratch codes;
+        vector<PQIndex::Neighbour> matches;
+        vector<Grain> grains;
+        vector<float> timbre;
+    };
+
     // DB connection
     DBConnector& dbConnector;
 
     // The analyser
     Analyser& analyser;
 
-    // Ref to generatedBuffer from MainComponent
-    AudioBuffer<float>& generatedBuffer;
+    // Ref to the double-buffered trajectory audio from MainComponent. Rendering always goes into its back buffer.
+    TrajectoryBuffer& generatedTrajectory;
 
-    // Source and target grain vectors
+    // Source and target grain vectors (reserved for MAX_GRAINS_IN_TRAJECTORY grains)
     vector<Grain> source;
     vector<Grain>& target;
 
+    // Candidates fetched from the database for one position, and their target costs
+    vector<Grain> candidates;
+    vector<float> candidateCosts;
+    // Streaming mode has its own candidates, it runs concurrently with trajectory generation (guarded by streamLock)
+    vector<Grain> streamCandidates;
+    // Guards the state of streaming mode: streamCandidates and streamReaderCache
+    CriticalSection streamLock;
+
+    // Viterbi lattice, up to numCandidates entries per position (position t starts at t * k): Candidates sorted by
+    // target cost, their target costs, the cheapest path cost into each candidate and back pointers
+    vector<Grain> latticeGrains;
+    vector<float> latticeTargetCosts;
+    vector<float> latticePathCosts;
+    vector<int> latticeBackPointers;
+    // Number of candidates per position
+    vector<int> latticeSizes;
+
+    // Timbre vectors of the source grains (empty when matching features only), the index they are searched in (taken
+    // per trajectory, so a rebuild after an import doesn't affect a generation in flight) and the search buffers
+    vector<float> sourceTimbre;
+    shared_ptr<const TimbreIndex> timbreIndex;
+    TimbreIndex::SearchScratch timbreScratch;
+    vector<TimbreIndex::Neighbour> timbreNeighbours;
+    // Graph for approximate timbre search (taken per trajectory like the index) and its search buffers
+    shared_ptr<const HNSWIndex> timbreGraph;
+    HNSWIndex::SearchScratch timbreGraphScratch;
+    // Compressed timbre codes (taken per trajectory like the index) and their search buffers
+    shared_ptr<const PQIndex> timbreCodes;
+    CodeSearchScratch timbreCodeScratch;
+    // Timbre search of the trajectory being generated (never automatic)
+    TimbreSearch activeTimbreSearch = TimbreSearch::exact;
+    // Candidates of one position ranked by target cost, and the beam of the previous position
+    vector<pair<float, int>> ranked;
+    vector<int> beam;
+
+    // Open source audio files: Direct mapped by file id, a file shares its slot with the files whose id has the same
+    // remainder. Trajectory generation and streaming each have their own cache, under their own lock.
+    struct CachedReader {
+        int fileId = -1;
+        unique_ptr<AudioFormatReader> reader;
+    };
+    static constexpr size_t numCachedReaders = 32;
+    using ReaderCache = array<CachedReader, numCachedReaders>;
+    ReaderCache readerCache;
+    ReaderCache streamReaderCache;
+
     // Format manager for dealing with ".wav" files
     AudioFormatManager formatManager;
 
@@ -87,60 +266,172 @@ private:
     bool init();
 
     /**
-     * Find the best single grain for a given input grain.
-     * This singles out the best grain from a vector of possible best grains (coming from the db) using a higher-dimensional euclidean distance measure.
+     * Map NUM_FEATURES RL parameters (in [0..1]) to a grain with audio feature values in the range of the database
+     * @param params Pointer to the parameters of one grain
+     * @return The source grain
+     */
+    Grain paramsToGrain(const float* params) const;
+
+    /**
+     * Fetch the candidates for one position of a source trajectory into "candidates", with their target costs in
+     * "candidateCosts". Source grains with a timbre vector get the grains closest in timbre (cosine distance in the
+     * timbre index), costed by feature distance plus weighted timbre distance. Otherwise the database is queried by
+     * features.
+     * @param src The source grains
+     * @param position Index of the source grain
+     * @param margin The margin to apply to audio features
+     * @param k Number of candidates
+     */
+    void fetchCandidates(const vector<Grain>& src, int position, float margin, int k);
+
+    /**
+     * Fetch the candidates closest in timbre with the timbre search of the trajectory (see fetchCandidates)
+     * @param query Timbre vector of the source grain
+     * @param sourceGrain
+     * @param k Number of candidates
+     * @return False if the timbre search has no index or found nothing
+     */
+    bool fetchTimbreCandidates(const float* query, const Grain& sourceGrain, int k);
+
+    /**
+     * Search the compressed codes, then re-rank the best k * rerankFactor matches with their exact timbre from the
+     * database. Both generation and benchmarkTimbreSearch search the codes through here.
+     * @param codes
+     * @param query Timbre vector
+     * @param k Number of neighbours
+     * @param rerankFactor Matches re-ranked per neighbour
+     * @param scratch Buffers of the search, scratch.grains holds the re-ranked grains afterwards
+     * @param found Receives up to k neighbours by exact cosine distance (row = index into scratch.grains), closest first
+     */
+    void searchTimbreCodes(const PQIndex& codes, const float* query, int k, int rerankFactor, CodeSearchScratch& scratch,
+                           vector<TimbreIndex::Neighbour>& found);
+
+    /**
+     * Take the timbre index for the source trajectory and choose the timbre search for it
+     */
+    void prepareTimbreSearch();
+
+    /**
+     * Get a reader for a source audio file, opened on first use and kept open in the cache
+     * @param cache readerCache or streamReaderCache
+     * @param fileId
+     * @return The reader, nullptr if the file cannot be read
+     */
+    AudioFormatReader* getReader(ReaderCache& cache, int fileId);
+
+    /**
+     * Weighted euclidean distance between two grains (on normalised audio features, weights from FeatureSchema.h)
      * @param src The input grain
-     * @param grains The possible candidates
-     * @return The best found candidate
+     * @param candidate The candidate grain
+     * @return The squared, weighted distance
      */
-    Grain findBestGrain(Grain& src, vector<Grain>& grains) const;
+    float targetDistance(const Grain& src, const Grain& candidate) const;
 
     /**
-     * Helper function to convert a value to [0..1]
-     * @param in input value
-     * @param ref max reference value
-     * @return The normalised value
+     * Cost of playing "next" directly after "previous": A penalty for feature discontinuities, minus a bonus if
+     * "next" continues the audio of "previous" in the same file.
+     * @param previous
+     * @param next
+     * @param grainLength Length of the rendered grains in samples, the hop between contiguous grains
+     * @return The concatenation cost
+     */
+    float concatenationCost(const Grain& previous, const Grain& next, int grainLength) const;
+
+    /**
+     * Match every source grain independently with its closest grain in the database
+     * @param src The source grains
+     * @param out Receives one target grain per source grain
+     * @param margin The margin to apply to audio features
+     * @param k Number of candidates to fetch from the database per grain
+     * @return False if generation was cancelled
      */
-    static float normaliseValue(float in, float ref);
+    bool matchGreedy(const vector<Grain>& src, vector<Grain>& out, float margin, int k);
+
+    /**
+     * Match the source trajectory as a whole using a beam-pruned Viterbi search over the k best candidates per
+     * position, minimising the sum of target and concatenation costs.
+     * @param src The source grains
+     * @param out Receives one target grain per source grain
+     * @param margin The margin to apply to audio features
+     * @param k Number of candidates per position
+     * @param grainLength Length of the rendered grains in samples (for the contiguity bonus)
+     * @return False if generation was cancelled
+     */
+    bool matchViterbi(const vector<Grain>& src, vector<Grain>& out, float margin, int k, int grainLength);
 
     /**
      * Goes through the "source" grain vector and finds the best grains using the "margin" for audio features
      * @param margin The margin to apply to audio features
+     * @return False if generation was cancelled
      */
-    void generateTargetGrains(float margin);
+    bool generateTargetGrains(float margin);
 
     /**
-     * Does the same as above but also fills the "generatedBuffer" field with the resulting audio data.
+     * Does the same as above but also renders the resulting audio data into the back buffer of "generatedTrajectory"
+     * and publishes it to the audio thread once it is complete.
+     * @return False if generation was cancelled, in which case nothing is published
      */
-    void generateTargetGrainsAndCreateBuffer();
+    bool generateTargetGrainsAndCreateBuffer();
 
-    // Fields for statistics
-    // Loudness
-    float minLoudness = 0.0f;
-    float maxLoudness = 0.0f;
-    float meanLoudness = 0.0f;
-    float stdLoudness = 0.0f;
+    // Serialises trajectory generation: Trajectories are generated on the trajectory worker as well as on the message thread
+    CriticalSection generationLock;
+    // Ticket of the newest generation: Any generation with an older ticket is cancelled
+    atomic<uint64_t> latestGeneration { 0 };
+    // Ticket of the generation holding the lock
+    uint64_t activeGeneration = 0;
 
-    // Spectral centroid
-    float minSC = 0.0f;
-    float maxSC = 0.0f;
-    float meanSC = 0.0f;
-    float stdSC = 0.0f;
+    /**
+     * Check whether the generation holding the lock was cancelled
+     * @return True if a newer generation was started or cancelGeneration() was called since its ticket was taken
+     */
+    bool isCancelled() const;
+
+    // Search
+    atomic<SearchMode> searchMode { SearchMode::greedy };
+    // Number of candidates fetched from the database per target grain
+    int numCandidates = 20;
+    // Viterbi: Number of cheapest partial paths extended at each position
+    int beamWidth = 16;
+    // Viterbi: Weight of the feature distance between adjacent grains
+    float discontinuityWeight = 0.5f;
+    // Viterbi: Cost reduction for a grain that continues the audio of its predecessor in the same file
+    float contiguityBonus = 0.1f;
+    // Weight of the timbre (cosine) distance in the target cost
+    float timbreWeight = 1.0f;
+    // Clusters of the timbre index scanned per candidate search
+    int timbreProbes = TimbreIndex::defaultNumProbes;
+    // Size of the candidate list of the timbre graph search
+    int timbreEfSearch = HNSWIndex::defaultEfSearch;
+    // Compressed timbre search: Matches re-ranked with their exact timbre, per candidate
+    int timbreRerankFactor = 4;
+    // Timbre search mode and the latency budget of automatic mode (milliseconds per trajectory)
+    atomic<TimbreSearch> timbreSearch { TimbreSearch::automatic };
+    atomic<float> timbreLatencyBudgetMs { 5.0f };
+    // Measured cost of the exact search per grain in the corpus (running average, 0 until the first exact search)
+    double exactTimbreNanosPerRow = 0.0;
 
-    // Spectral flux
-    float minSF = 0.0f;
-    float maxSF = 0.0f;
-    float meanSF = 0.0f;
-    float stdSF = 0.0f;
+    // Fields for statistics: Per feature of the schema, indexed by FeatureSchema::Feature. Written under generationLock
+    // and streamLock, so readers holding either see a consistent set.
+    array<float, FeatureSchema::numFeatures> minFeatures {};
+    array<float, FeatureSchema::numFeatures> maxFeatures {};
+    array<float, FeatureSchema::numFeatures> meanFeatures {};
+    array<float, FeatureSchema::numFeatures> stdFeatures {};
+    // Normalisation of feature differences in the target distance (1 / max)
+    array<float, FeatureSchema::numFeatures> distanceScales {};
+    // Whether statistics of a corpus with audible grains are available, read without a lock
+    atomic<bool> hasStatistics { false };
 
-    // Pitch
-    float minPitch = 0.0f;
-    float maxPitch = 0.0f;
-    float meanPitch = 0.0f;
-    float stdPitch = 0.0f;
+    // Window functions that are applied to each grain to avoid clicking, one per supported grain length
+    vector<unique_ptr<dsp::WindowingFunction<float>>> windows;
+    // Grain length of the trajectory currently being generated
+    int renderGrainLength = GRAIN_LENGTH;
 
-    // Window function that's applied to each grain to avoid clicking
-    unique_ptr<dsp::WindowingFunction<float>> window;
+    /**
+     * Get the precomputed window for a grain length
+     * @param grainLength One of SUPPORTED_GRAIN_LENGTHS
+     * @return The window
+     */
+    const dsp::WindowingFunction<float>& getWindow(int grainLength) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Traverser)
 };
@@ -4,8 +4,22 @@
 
 #ifndef DMLAP_BACKEND_UTILITY_H
 #define DMLAP_BACKEND_UTILITY_H
+#include <cstdlib>
+#include "Constants.h"
+
 static float mapFloat(float val, float inLow, float inHigh, float outLow, float outHigh){
     float x = (val - inLow) / (inHigh - inLow);
     return outLow + (outHigh - outLow) * x;
 }
+
+// Snap a requested grain length to the closest supported one
+static int nearestSupportedGrainLength(int length){
+    int nearest = SUPPORTED_GRAIN_LENGTHS[0];
+    for(int supported : SUPPORTED_GRAIN_LENGTHS){
+        if(std::abs(supported - length) < std::abs(nearest - length)){
+            nearest = supported;
+        }
+    }
+    return nearest;
+}
 #endif //DMLAP_BACKEND_UTILITY_H
@@ -0,0 +1,175 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include "VectorKernels.h"
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+ #define DMLAP_AVX2_DISPATCH 1
+ #include <immintrin.h>
+#else
+ #define DMLAP_AVX2_DISPATCH 0
+#endif
+
+namespace {
+
+float squaredL2Portable(const float* a, const float* b, int dimensions) {
+    float sum = 0.0f;
+    for(int i = 0; i < dimensions; i++){
+        const float difference = a[i] - b[i];
+        sum += difference * difference;
+    }
+    return sum;
+}
+
+float dotPortable(const float* a, const float* b, int dimensions) {
+    float sum = 0.0f;
+    for(int i = 0; i < dimensions; i++){
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void squaredL2RowsPortable(const float* query, const float* rows, int numRows, int stride, int dimensions, float* distances) {
+    for(int row = 0; row < numRows; row++){
+        distances[row] = squaredL2Portable(query, rows + static_cast<long>(row) * stride, dimensions);
+    }
+}
+
+void dotRowsPortable(const float* query, const float* rows, int numRows, int stride, int dimensions, float* products) {
+    for(int row = 0; row < numRows; row++){
+        products[row] = dotPortable(query, rows + static_cast<long>(row) * stride, dimensions);
+    }
+}
+
+#if DMLAP_AVX2_DISPATCH
+
+__attribute__((target("avx2,fma")))
+inline float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+inline float squaredL2AVX2(const float* a, const float* b, int dimensions) {
+    // Two accumulators hide the latency of the fused multiply-adds
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for(; i + 16 <= dimensions; i += 16){
+        const __m256 difference0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        const __m256 difference1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        sum0 = _mm256_fmadd_ps(difference0, difference0, sum0);
+        sum1 = _mm256_fmadd_ps(difference1, difference1, sum1);
+    }
+    for(; i + 8 <= dimensions; i += 8){
+        const __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        sum0 = _mm256_fmadd_ps(difference, difference, sum0);
+    }
+    float sum = horizontalSum(_mm256_add_ps(sum0, sum1));
+    for(; i < dimensions; i++){
+        const float difference = a[i] - b[i];
+        sum += difference * difference;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline float dotAVX2(const float* a, const float* b, int dimensions) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for(; i + 16 <= dimensions; i += 16){
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for(; i + 8 <= dimensions; i += 8){
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    float sum = horizontalSum(_mm256_add_ps(sum0, sum1));
+    for(; i < dimensions; i++){
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float squaredL2AVX2Single(const float* a, const float* b, int dimensions) {
+    return squaredL2AVX2(a, b, dimensions);
+}
+
+__attribute__((target("avx2,fma")))
+float dotAVX2Single(const float* a, const float* b, int dimensions) {
+    return dotAVX2(a, b, dimensions);
+}
+
+__attribute__((target("avx2,fma")))
+void squaredL2RowsAVX2(const float* query, const float* rows, int numRows, int stride, int dimensions, float* distances) {
+    for(int row = 0; row < numRows; row++){
+        distances[row] = squaredL2AVX2(query, rows + static_cast<long>(row) * stride, dimensions);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void dotRowsAVX2(const float* query, const float* rows, int numRows, int stride, int dimensions, float* products) {
+    for(int row = 0; row < numRows; row++){
+        products[row] = dotAVX2(query, rows + static_cast<long>(row) * stride, dimensions);
+    }
+}
+
+#endif
+
+// The kernels for this machine, chosen on first use
+struct Kernels {
+    float (*squaredL2)(const float*, const float*, int);
+    float (*dot)(const float*, const float*, int);
+    void (*squaredL2Rows)(const float*, const float*, int, int, int, float*);
+    void (*dotRows)(const float*, const float*, int, int, int, float*);
+    bool isAVX2;
+};
+
+const Kernels& getKernels() {
+    static const Kernels kernels = [] {
+#if DMLAP_AVX2_DISPATCH
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+            return Kernels { squaredL2AVX2Single, dotAVX2Single, squaredL2RowsAVX2, dotRowsAVX2, true };
+        }
+#endif
+        return Kernels { squaredL2Portable, dotPortable, squaredL2RowsPortable, dotRowsPortable, false };
+    }();
+    return kernels;
+}
+
+}
+
+float VectorKernels::squaredL2(const float* a, const float* b, int dimensions) {
+    return getKernels().squaredL2(a, b, dimensions);
+}
+
+float VectorKernels::dot(const float* a, const float* b, int dimensions) {
+    return getKernels().dot(a, b, dimensions);
+}
+
+float VectorKernels::cosineDistance(const float* a, const float* b, int dimensions) {
+    const Kernels& kernels = getKernels();
+    const float norms = kernels.dot(a, a, dimensions) * kernels.dot(b, b, dimensions);
+    if(norms <= 0.0f){
+        return 1.0f;
+    }
+    return 1.0f - kernels.dot(a, b, dimensions) / std::sqrt(norms);
+}
+
+void VectorKernels::squaredL2Rows(const float* query, const float* rows, int numRows, int stride, int dimensions, float* distances) {
+    getKernels().squaredL2Rows(query, rows, numRows, stride, dimensions, distances);
+}
+
+void VectorKernels::dotRows(const float* query, const float* rows, int numRows, int stride, int dimensions, float* products) {
+    getKernels().dotRows(query, rows, numRows, stride, dimensions, products);
+}
+
+bool VectorKernels::isUsingAVX2() {
+    return getKernels().isAVX2;
+}
@@ -0,0 +1,73 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#ifndef DMLAP_BACKEND_VECTORKERNELS_H
+#define DMLAP_BACKEND_VECTORKERNELS_H
+
+/**
+ * Distance kernels for high-dimensional feature vectors (e.g. the MFCC timbre vectors of the grains).
+ * On x86 CPUs with AVX2 and FMA the kernels process 16 floats per iteration, chosen once at runtime so the binary still
+ * runs on older CPUs. Everywhere else they fall back to plain loops, which the compiler vectorises for the target.
+ * Matrices are row-major with a row stride of at least the number of dimensions.
+ */
+namespace VectorKernels {
+
+/**
+ * Squared euclidean distance between two vectors
+ * @param a
+ * @param b
+ * @param dimensions
+ * @return The sum of (a - b)^2
+ */
+float squaredL2(const float* a, const float* b, int dimensions);
+
+/**
+ * Dot product of two vectors
+ * @param a
+ * @param b
+ * @param dimensions
+ * @return The sum of a * b
+ */
+float dot(const float* a, const float* b, int dimensions);
+
+/**
+ * Cosine distance between two vectors
+ * @param a
+ * @param b
+ * @param dimensions
+ * @return 1 - cosine similarity, 1 if either vector is zero
+ */
+float cosineDistance(const float* a, const float* b, int dimensions);
+
+/**
+ * Squared euclidean distances from a query to every row of a matrix
+ * @param query
+ * @param rows First row of the matrix
+ * @param numRows
+ * @param stride Floats from one row to the next
+ * @param dimensions
+ * @param distances Receives numRows distances
+ */
+void squaredL2Rows(const float* query, const float* rows, int numRows, int stride, int dimensions, float* distances);
+
+/**
+ * Dot products of a query with every row of a matrix
+ * @param query
+ * @param rows First row of the matrix
+ * @param numRows
+ * @param stride Floats from one row to the next
+ * @param dimensions
+ * @param products Receives numRows dot products
+ */
+void dotRows(const float* query, const float* rows, int numRows, int stride, int dimensions, float* products);
+
+/**
+ * Whether the AVX2 kernels are used on this machine
+ * @return True for AVX2, false for the portable kernels
+ */
+bool isUsingAVX2();
+
+}
+
+#endif //DMLAP_BACKEND_VECTORKERNELS_H
@@ -0,0 +1,88 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <juce_core/juce_core.h>
+#include "FeatureSchema.h"
+#include "Grain.h"
+
+/**
+ * The feature schema: The unrolled distance kernel against a plain loop over the descriptors, and the grain record in
+ * schema order.
+ */
+class FeatureSchemaTests : public juce::UnitTest {
+public:
+    FeatureSchemaTests() : juce::UnitTest("FeatureSchema", "DMLAP") {}
+
+    void runTest() override {
+        beginTest("Every feature has a distinct, weighted column");
+        {
+            set<string> columns;
+            for(const auto& descriptor : FeatureSchema::descriptors){
+                expect(string(descriptor.column).length() > 0);
+                expectGreaterThan(descriptor.weight, 0.0f);
+                expectGreaterThan(descriptor.parameterMax, 0.0f);
+                columns.insert(descriptor.column);
+            }
+            expectEquals(static_cast<int>(columns.size()), FeatureSchema::numFeatures);
+            expect(FeatureSchema::sortFeature >= 0 && FeatureSchema::sortFeature < FeatureSchema::numFeatures);
+        }
+
+        beginTest("The weighted distance is the weighted sum of squared scaled differences");
+        {
+            juce::Random random = getRandom();
+            for(int i = 0; i < 100; i++){
+                float a[FeatureSchema::numFeatures], b[FeatureSchema::numFeatures], scale[FeatureSchema::numFeatures];
+                for(int f = 0; f < FeatureSchema::numFeatures; f++){
+                    a[f] = random.nextFloat() * 1000.0f;
+                    b[f] = random.nextFloat() * 1000.0f;
+                    scale[f] = 1.0f / (1.0f + random.nextFloat() * 1000.0f);
+                }
+                double expected = 0.0;
+                for(int f = 0; f < FeatureSchema::numFeatures; f++){
+                    const double difference = (static_cast<double>(a[f]) - b[f]) * scale[f];
+                    expected += FeatureSchema::descriptors[f].weight * difference * difference;
+                }
+                const float distance = FeatureSchema::weightedDistance(a, b, scale);
+                expectWithinAbsoluteError(distance, static_cast<float>(expected), 1.0e-4f * static_cast<float>(expected) + 1.0e-6f);
+                // Symmetric, and zero for the grain itself
+                expectEquals(FeatureSchema::weightedDistance(b, a, scale), distance);
+                expectEquals(FeatureSchema::weightedDistance(a, a, scale), 0.0f);
+            }
+        }
+
+        beginTest("Each feature counts with its weight");
+        {
+            const float zeros[FeatureSchema::numFeatures] = {};
+            float ones[FeatureSchema::numFeatures];
+            fill(ones, ones + FeatureSchema::numFeatures, 1.0f);
+            for(int f = 0; f < FeatureSchema::numFeatures; f++){
+                float unit[FeatureSchema::numFeatures] = {};
+                unit[f] = 1.0f;
+                expectEquals(FeatureSchema::weightedDistance(unit, zeros, ones), FeatureSchema::descriptors[f].weight);
+            }
+        }
+
+        beginTest("A grain stores its features in schema order");
+        {
+            float features[FeatureSchema::numFeatures];
+            for(int f = 0; f < FeatureSchema::numFeatures; f++){
+                features[f] = static_cast<float>(f + 1) * 10.0f;
+            }
+            Grain grain (3, 4096, features);
+            expect(grain.isValid());
+            for(int f = 0; f < FeatureSchema::numFeatures; f++){
+                expectEquals(grain.getFeature(static_cast<FeatureSchema::Feature>(f)), features[f]);
+                expectEquals(grain.getFeatures()[f], features[f]);
+            }
+            grain.setFeature(FeatureSchema::pitch, 440.0f);
+            expectEquals(grain.getFeatures()[FeatureSchema::pitch], 440.0f);
+            expect(!Grain(features).isValid());
+        }
+    }
+};
+
+static FeatureSchemaTests featureSchemaTests;
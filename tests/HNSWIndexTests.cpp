@@ -0,0 +1,221 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <algorithm>
+#include <map>
+#include <juce_core/juce_core.h>
+#include "HNSWIndex.h"
+#include "VectorKernels.h"
+
+/**
+ * The HNSW graph: Recall against a brute-force scan, the save/load round trip with its corpus stamp, and that damaged
+ * graph files are rejected instead of producing a graph with links out of range.
+ */
+class HNSWIndexTests : public UnitTest {
+public:
+    HNSWIndexTests() : UnitTest("HNSWIndex", "DMLAP") {}
+
+    void runTest() override {
+        Random random = getRandom();
+        constexpr int numNodes = 2000, k = 10;
+        const vector<float> vectors = makeCorpus(random, numNodes);
+
+        for(auto metric : { HNSWIndex::Metric::cosine, HNSWIndex::Metric::l2 }){
+            beginTest(String("Searches find most true neighbours (") + (metric == HNSWIndex::Metric::l2 ? "l2" : "cosine") + ")");
+            HNSWIndex index (dimensions, metric);
+            fill(index, vectors, numNodes);
+            expectEquals(index.size(), numNodes);
+            expectGreaterThan(recall(index, vectors, random, k), 0.9f);
+        }
+
+        beginTest("An empty graph finds nothing");
+        {
+            HNSWIndex index (dimensions);
+            HNSWIndex::SearchScratch scratch;
+            vector<HNSWIndex::Neighbour> found;
+            const vector<float> query (dimensions, 1.0f);
+            index.search(query.data(), k, HNSWIndex::defaultEfSearch, scratch, found);
+            expect(index.isEmpty());
+            expect(found.empty());
+        }
+
+        HNSWIndex index (dimensions);
+        fill(index, vectors, numNodes);
+        const HNSWIndex::CorpusStamp stamp { 123456789012LL, numNodes };
+        TemporaryFile temporary (".graph");
+        const File& file = temporary.getFile();
+
+        beginTest("A saved graph loads with its stamp, grains and results");
+        {
+            expect(index.save(file, getFilePath, stamp));
+            HNSWIndex::CorpusStamp loadedStamp;
+            map<string, int> registered;
+            unique_ptr<HNSWIndex> loaded = HNSWIndex::load(file, dimensions, [&registered] (const string& path) {
+                return registered.emplace(path, 100 + static_cast<int>(registered.size())).first->second;
+            }, loadedStamp);
+            expect(loaded != nullptr);
+            if(loaded != nullptr){
+                expect(loadedStamp == stamp);
+                expectEquals(loaded->size(), index.size());
+                expect(loaded->getMetric() == index.getMetric());
+                expectEquals(static_cast<int>(registered.size()), numFiles);
+                for(int node = 0; node < index.size(); node++){
+                    // File ids are remapped through the path
+                    expectEquals(String(pathOf(*loaded, node, registered)), String(getFilePath(index.getGrain(node).getFileId())));
+                    expectEquals(loaded->getGrain(node).getIdx(), index.getGrain(node).getIdx());
+                }
+                HNSWIndex::SearchScratch scratch;
+                vector<HNSWIndex::Neighbour> found, foundLoaded;
+                for(int q = 0; q < 20; q++){
+                    const float* query = vectors.data() + random.nextInt(numNodes) * dimensions;
+                    index.search(query, k, HNSWIndex::defaultEfSearch, scratch, found);
+                    loaded->search(query, k, HNSWIndex::defaultEfSearch, scratch, foundLoaded);
+                    expectEquals(static_cast<int>(foundLoaded.size()), static_cast<int>(found.size()));
+                    for(size_t i = 0; i < min(found.size(), foundLoaded.size()); i++){
+                        expectEquals(foundLoaded[i].row, found[i].row);
+                    }
+                }
+            }
+        }
+
+        beginTest("Graphs of other dimensions are not loaded");
+        {
+            HNSWIndex::CorpusStamp loadedStamp;
+            expect(HNSWIndex::load(file, dimensions + 1, registerFile, loadedStamp) == nullptr);
+        }
+
+        MemoryBlock saved;
+        expect(file.loadFileAsData(saved));
+
+        beginTest("Truncated graph files are rejected");
+        {
+            for(size_t size : { saved.getSize() - 1, saved.getSize() - 4, saved.getSize() / 2, static_cast<size_t>(60), static_cast<size_t>(8) }){
+                file.replaceWithData(saved.getData(), size);
+                HNSWIndex::CorpusStamp loadedStamp;
+                expect(HNSWIndex::load(file, dimensions, registerFile, loadedStamp) == nullptr);
+            }
+        }
+
+        beginTest("Counts out of range in the header are rejected");
+        {
+            // Offsets of the header fields after magic, version, dimensions, features, stamp, metric, M, efConstruction
+            constexpr size_t numNodesOffset = 44, entryPointOffset = 48, maxLevelOffset = 52;
+            const pair<size_t, int> damages[] = {
+                { numNodesOffset, 0x7fffffff }, { numNodesOffset, -1 }, { entryPointOffset, numNodes },
+                { entryPointOffset, -1 }, { maxLevelOffset, 1000 }, { maxLevelOffset, -1 }
+            };
+            for(const auto& damage : damages){
+                MemoryBlock damaged (saved.getData(), saved.getSize());
+                writeInt(damaged, damage.first, damage.second);
+                file.replaceWithData(damaged.getData(), damaged.getSize());
+                HNSWIndex::CorpusStamp loadedStamp;
+                expect(HNSWIndex::load(file, dimensions, registerFile, loadedStamp) == nullptr);
+            }
+        }
+
+        beginTest("Randomly damaged graph files are rejected or stay searchable");
+        {
+            HNSWIndex::SearchScratch scratch;
+            vector<HNSWIndex::Neighbour> found;
+            for(int i = 0; i < 100; i++){
+                MemoryBlock damaged (saved.getData(), saved.getSize());
+                for(int j = 0; j < 8; j++){
+                    writeInt(damaged, static_cast<size_t>(random.nextInt(static_cast<int>(saved.getSize() / 4))) * 4, random.nextInt());
+                }
+                file.replaceWithData(damaged.getData(), damaged.getSize());
+                HNSWIndex::CorpusStamp loadedStamp;
+                unique_ptr<HNSWIndex> loaded = HNSWIndex::load(file, dimensions, registerFile, loadedStamp);
+                if(loaded != nullptr){
+                    loaded->search(vectors.data(), k, HNSWIndex::defaultEfSearch, scratch, found);
+                    for(const auto& neighbour : found){
+                        expect(neighbour.row >= 0 && neighbour.row < loaded->size());
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr int dimensions = 20;
+    static constexpr int numFiles = 3;
+
+    static string getFilePath(int fileId) {
+        return "/corpus/file" + to_string(fileId) + ".wav";
+    }
+
+    static int registerFile(const string&) {
+        return 0;
+    }
+
+    static string pathOf(const HNSWIndex& index, int node, const map<string, int>& registered) {
+        for(const auto& entry : registered){
+            if(entry.second == index.getGrain(node).getFileId()){
+                return entry.first;
+            }
+        }
+        return "";
+    }
+
+    static void writeInt(MemoryBlock& data, size_t offset, int value) {
+        memcpy(static_cast<char*>(data.getData()) + offset, &value, sizeof(value));
+    }
+
+    // Vectors in a few dozen blobs, like the timbres of related sounds
+    static vector<float> makeCorpus(Random& random, int numNodes) {
+        constexpr int numBlobs = 40;
+        vector<float> centres (static_cast<size_t>(numBlobs * dimensions));
+        for(float& value : centres){
+            value = random.nextFloat() * 2.0f - 1.0f;
+        }
+        vector<float> vectors;
+        for(int node = 0; node < numNodes; node++){
+            const float* centre = centres.data() + random.nextInt(numBlobs) * dimensions;
+            for(int i = 0; i < dimensions; i++){
+                vectors.push_back(centre[i] + (random.nextFloat() - 0.5f) * 0.2f);
+            }
+        }
+        return vectors;
+    }
+
+    // The grain of node i has idx i, spread over a few source files
+    static void fill(HNSWIndex& index, const vector<float>& vectors, int numNodes) {
+        const float features[FeatureSchema::numFeatures] = {};
+        for(int node = 0; node < numNodes; node++){
+            index.add(Grain(node % numFiles, node, features), vectors.data() + node * dimensions);
+        }
+    }
+
+    float recall(const HNSWIndex& index, const vector<float>& vectors, Random& random, int k) {
+        HNSWIndex::SearchScratch scratch;
+        vector<HNSWIndex::Neighbour> found;
+        int numFound = 0;
+        constexpr int numQueries = 50;
+        for(int q = 0; q < numQueries; q++){
+            // Near a node of the corpus, like the timbre of a target grain
+            const int source = random.nextInt(index.size());
+            vector<float> query (vectors.begin() + source * dimensions, vectors.begin() + (source + 1) * dimensions);
+            for(float& value : query){
+                value += (random.nextFloat() - 0.5f) * 0.1f;
+            }
+            index.search(query.data(), k, HNSWIndex::defaultEfSearch, scratch, found);
+
+            // Brute force over the original vectors, node i holds vector i
+            vector<pair<float, int>> all;
+            for(int node = 0; node < index.size(); node++){
+                const float* values = vectors.data() + node * dimensions;
+                all.emplace_back(index.getMetric() == HNSWIndex::Metric::l2 ? VectorKernels::squaredL2(query.data(), values, dimensions)
+                                                                             : VectorKernels::cosineDistance(query.data(), values, dimensions), node);
+            }
+            partial_sort(all.begin(), all.begin() + k, all.end());
+            for(const auto& neighbour : found){
+                for(int i = 0; i < k; i++){
+                    numFound += all[static_cast<size_t>(i)].second == index.getGrain(neighbour.row).getIdx() ? 1 : 0;
+                }
+            }
+        }
+        return static_cast<float>(numFound) / (numQueries * k);
+    }
+};
+
+static HNSWIndexTests hnswIndexTests;
@@ -0,0 +1,142 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <algorithm>
+#include <juce_core/juce_core.h>
+#include "PQIndex.h"
+#include "VectorKernels.h"
+
+/**
+ * The product-quantised timbre codes: Training on empty and small samples, 64-bit row ids, and recall once the
+ * candidates are re-ranked by their exact distance, as the traverser does.
+ */
+class PQIndexTests : public UnitTest {
+public:
+    PQIndexTests() : UnitTest("PQIndex", "DMLAP") {}
+
+    void runTest() override {
+        Random random = getRandom();
+        PQIndex::SearchScratch scratch;
+        vector<PQIndex::Neighbour> found;
+
+        beginTest("An empty sample leaves the index untrained");
+        {
+            PQIndex index (dimensions);
+            index.train({});
+            expect(!index.isTrained());
+            expectEquals(index.getNumTrainingVectors(), 0);
+            const vector<float> query (dimensions, 1.0f);
+            index.search(query.data(), 10, scratch, found);
+            expect(found.empty());
+        }
+
+        beginTest("A sample smaller than the codebooks is coded exactly");
+        {
+            constexpr int numVectors = 100;
+            const vector<float> sample = makeCorpus(random, numVectors);
+            for(auto metric : { PQIndex::Metric::l2, PQIndex::Metric::cosine }){
+                PQIndex index (dimensions, metric);
+                index.train(sample);
+                expect(index.isTrained());
+                expectEquals(index.getNumTrainingVectors(), numVectors);
+                for(int v = 0; v < numVectors; v++){
+                    index.add(v, sample.data() + v * dimensions);
+                }
+                expectEquals(index.size(), numVectors);
+                for(int v = 0; v < numVectors; v++){
+                    index.search(sample.data() + v * dimensions, 1, scratch, found);
+                    expectEquals(static_cast<int>(found.size()), 1);
+                    if(!found.empty()){
+                        expectEquals(found[0].rowId, static_cast<int64>(v));
+                        expectWithinAbsoluteError(found[0].distance, 0.0f, 1.0e-5f);
+                    }
+                }
+            }
+        }
+
+        constexpr int numVectors = 2000, k = 10;
+        const vector<float> vectors = makeCorpus(random, numVectors);
+        PQIndex index (dimensions, PQIndex::Metric::l2);
+        index.train(vectors);
+        // Database rows beyond 32 bits, spaced out
+        const int64 firstRowId = (static_cast<int64>(1) << 40) + 7;
+        for(int v = 0; v < numVectors; v++){
+            index.add(firstRowId + 3 * static_cast<int64>(v), vectors.data() + v * dimensions);
+        }
+
+        beginTest("Row ids beyond 32 bits come back unchanged");
+        {
+            for(int q = 0; q < 20; q++){
+                const int v = random.nextInt(numVectors);
+                index.search(vectors.data() + v * dimensions, k, scratch, found);
+                expectEquals(static_cast<int>(found.size()), k);
+                for(const auto& neighbour : found){
+                    const int64 offset = neighbour.rowId - firstRowId;
+                    expect(offset >= 0 && offset % 3 == 0 && offset / 3 < numVectors, "Row id out of range");
+                }
+            }
+        }
+
+        beginTest("Re-ranked codes find the true neighbours");
+        {
+            for(int rerankFactor : { 1, 4, 16 }){
+                int numFound = 0;
+                constexpr int numQueries = 50;
+                for(int q = 0; q < numQueries; q++){
+                    // Near a vector of the corpus, like the timbre of a target grain
+                    const int source = random.nextInt(numVectors);
+                    vector<float> query (vectors.begin() + source * dimensions, vectors.begin() + (source + 1) * dimensions);
+                    for(float& value : query){
+                        value += (random.nextFloat() - 0.5f) * 0.1f;
+                    }
+
+                    // Candidates by code, then the k closest by exact distance
+                    index.search(query.data(), k * rerankFactor, scratch, found);
+                    vector<pair<float, int>> reranked;
+                    for(const auto& neighbour : found){
+                        const int v = static_cast<int>((neighbour.rowId - firstRowId) / 3);
+                        reranked.emplace_back(VectorKernels::squaredL2(query.data(), vectors.data() + v * dimensions, dimensions), v);
+                    }
+                    sort(reranked.begin(), reranked.end());
+                    reranked.resize(min(reranked.size(), static_cast<size_t>(k)));
+
+                    vector<pair<float, int>> all;
+                    for(int v = 0; v < numVectors; v++){
+                        all.emplace_back(VectorKernels::squaredL2(query.data(), vectors.data() + v * dimensions, dimensions), v);
+                    }
+                    partial_sort(all.begin(), all.begin() + k, all.end());
+                    for(const auto& neighbour : reranked){
+                        for(int i = 0; i < k; i++){
+                            numFound += all[static_cast<size_t>(i)].second == neighbour.second ? 1 : 0;
+                        }
+                    }
+                }
+                // Codes alone rank the close neighbours roughly, a few times more candidates recover them
+                expectGreaterThan(static_cast<float>(numFound) / (numQueries * k), rerankFactor == 1 ? 0.5f : 0.9f);
+            }
+        }
+    }
+
+private:
+    static constexpr int dimensions = 20;
+
+    // Vectors in a few dozen blobs, like the timbres of related sounds
+    static vector<float> makeCorpus(Random& random, int numVectors) {
+        constexpr int numBlobs = 40;
+        vector<float> centres (static_cast<size_t>(numBlobs * dimensions));
+        for(float& value : centres){
+            value = random.nextFloat() * 2.0f - 1.0f;
+        }
+        vector<float> vectors;
+        for(int v = 0; v < numVectors; v++){
+            const float* centre = centres.data() + random.nextInt(numBlobs) * dimensions;
+            for(int i = 0; i < dimensions; i++){
+                vectors.push_back(centre[i] + (random.nextFloat() - 0.5f) * 0.2f);
+            }
+        }
+        return vectors;
+    }
+};
+
+static PQIndexTests pqIndexTests;
@@ -0,0 +1,191 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <juce_core/juce_core.h>
+#include "SharedMemoryTransport.h"
+#if JUCE_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * The shared-memory rings, checked from the agent's side: The test maps the segment by itself and reads and writes
+ * slots with the layout of SharedMemoryProtocol.h, like the Python agent does with numpy.
+ */
+class SharedMemoryTransportTests : public UnitTest {
+public:
+    SharedMemoryTransportTests() : UnitTest("SharedMemoryTransport", "DMLAP") {}
+
+    void runTest() override {
+        const String name = "dmlap_test_" + String(static_cast<int>(getpid()));
+
+        beginTest("The segment header describes the layout");
+        {
+            SharedMemoryTransport transport;
+            expect(transport.open(name));
+            dmlap_shm_segment* segment = mapSegment(name);
+            expect(segment != nullptr);
+            if(segment != nullptr){
+                expectEquals(segment->magic, static_cast<uint32_t>(DMLAP_SHM_MAGIC));
+                expectEquals(segment->version, static_cast<uint32_t>(DMLAP_SHM_VERSION));
+                expectEquals(segment->numSlots, static_cast<uint32_t>(DMLAP_SHM_NUM_SLOTS));
+                expectEquals(segment->slotSize, static_cast<uint32_t>(DMLAP_SHM_SLOT_SIZE));
+                unmapSegment(segment);
+            }
+        }
+
+        beginTest("Messages to the agent keep their arguments");
+        {
+            SharedMemoryTransport transport;
+            expect(transport.open(name));
+            dmlap_shm_segment* segment = mapSegment(name);
+            if(segment != nullptr){
+                OSCMessage message ("/batch_error");
+                message.addInt32(-7);
+                message.addFloat32(0.25f);
+                const uint8_t bytes[] = { 1, 2, 3 };
+                message.addBlob(MemoryBlock(bytes, sizeof(bytes)));
+                message.addString("too large");
+                expect(transport.send(message));
+
+                dmlap_shm_ring& ring = segment->toAgent;
+                expectEquals(__atomic_load_n(&ring.writeCount, __ATOMIC_ACQUIRE), 1u);
+                const dmlap_shm_message& slot = ring.slots[0];
+                expectEquals(String(slot.address), String("/batch_error"));
+                expectEquals(String(slot.typeTags), String("ifbs"));
+                // Two words, then a blob and a string padded to a multiple of 4
+                expectEquals(slot.payloadSize, 4u + 4u + (4u + 4u) + (4u + 12u));
+                expectEquals(static_cast<int32>(ByteOrder::littleEndianInt(slot.payload)), -7);
+                expectEquals(ByteOrder::littleEndianInt(slot.payload + 8), 3u);
+                expect(memcmp(slot.payload + 12, bytes, sizeof(bytes)) == 0);
+                expectEquals(ByteOrder::littleEndianInt(slot.payload + 16), 9u);
+                expect(memcmp(slot.payload + 20, "too large", 9) == 0);
+                unmapSegment(segment);
+            }
+        }
+
+        beginTest("Messages from the agent arrive in order");
+        {
+            SharedMemoryTransport transport;
+            CriticalSection receivedLock;
+            vector<int> received;
+            WaitableEvent allReceived;
+            constexpr int numMessages = 2000;
+            transport.onMessage = [&] (const OSCMessage& message) {
+                if(message.getAddressPattern().toString() == "/params" && message.size() == 2
+                   && message[0].isInt32() && message[1].isString() && message[1].getString() == "hi"){
+                    const ScopedLock sl (receivedLock);
+                    received.push_back(message[0].getInt32());
+                    if(static_cast<int>(received.size()) == numMessages){
+                        allReceived.signal();
+                    }
+                }
+            };
+            expect(transport.open(name));
+            dmlap_shm_segment* segment = mapSegment(name);
+            if(segment != nullptr){
+                // Faster than the reader at times, so the ring fills up and the reader sleeps and wakes up in between
+                for(int i = 0; i < numMessages; i++){
+                    while(!writeToBackend(segment->toBackend, i)){
+                        Thread::yield();
+                    }
+                }
+                expect(allReceived.wait(10000), "Messages were lost or a wake-up was missed");
+                unmapSegment(segment);
+            }
+            transport.close();
+
+            int numOutOfOrder = 0;
+            for(size_t i = 0; i < received.size(); i++){
+                numOutOfOrder += received[i] != static_cast<int>(i) ? 1 : 0;
+            }
+            expectEquals(static_cast<int>(received.size()), numMessages);
+            expectEquals(numOutOfOrder, 0);
+        }
+
+        beginTest("A full ring drops the message and counts it");
+        {
+            SharedMemoryTransport transport;
+            expect(transport.open(name));
+            OSCMessage message ("/juce_ready_for_next");
+            for(int i = 0; i < DMLAP_SHM_NUM_SLOTS; i++){
+                expect(transport.send(message));
+            }
+            expect(!transport.send(message));
+            expectEquals(transport.getNumDroppedMessages(), static_cast<uint32>(1));
+        }
+
+        beginTest("Messages larger than a slot are rejected up front");
+        {
+            // A blob takes its size word plus its padded bytes
+            OSCMessage fitting ("/batch_result");
+            fitting.addBlob(MemoryBlock(static_cast<size_t>(DMLAP_SHM_PAYLOAD_SIZE - 4), true));
+            expect(SharedMemoryTransport::fits(fitting));
+            OSCMessage tooLarge ("/batch_result");
+            tooLarge.addBlob(MemoryBlock(static_cast<size_t>(DMLAP_SHM_PAYLOAD_SIZE - 3), true));
+            expect(!SharedMemoryTransport::fits(tooLarge));
+            // Larger than a UDP datagram could carry as well
+            expect(DMLAP_SHM_PAYLOAD_SIZE < 65507);
+
+            SharedMemoryTransport transport;
+            expect(transport.open(name));
+            dmlap_shm_segment* segment = mapSegment(name);
+            if(segment != nullptr){
+                expect(!transport.send(tooLarge));
+                // Not written, not counted as dropped by a full ring
+                expectEquals(__atomic_load_n(&segment->toAgent.writeCount, __ATOMIC_ACQUIRE), 0u);
+                expectEquals(transport.getNumDroppedMessages(), static_cast<uint32>(0));
+                expect(transport.send(fitting));
+                unmapSegment(segment);
+            }
+        }
+    }
+
+private:
+    static dmlap_shm_segment* mapSegment(const String& name) {
+        const int fd = shm_open(("/" + name).toRawUTF8(), O_RDWR, 0600);
+        if(fd < 0){
+            return nullptr;
+        }
+        void* memory = mmap(nullptr, sizeof(dmlap_shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        return memory == MAP_FAILED ? nullptr : static_cast<dmlap_shm_segment*>(memory);
+    }
+
+    static void unmapSegment(dmlap_shm_segment* segment) {
+        munmap(segment, sizeof(dmlap_shm_segment));
+    }
+
+    // The agent as a producer: "/params" int32 value, string "hi". Follows the ring protocol step by step.
+    static bool writeToBackend(dmlap_shm_ring& ring, int value) {
+        const uint32_t writeCount = ring.writeCount;
+        if(writeCount - __atomic_load_n(&ring.readCount, __ATOMIC_ACQUIRE) >= DMLAP_SHM_NUM_SLOTS){
+            return false;
+        }
+        dmlap_shm_message& slot = ring.slots[writeCount % DMLAP_SHM_NUM_SLOTS];
+        memset(slot.address, 0, sizeof(slot.address));
+        memset(slot.typeTags, 0, sizeof(slot.typeTags));
+        strcpy(slot.address, "/params");
+        strcpy(slot.typeTags, "is");
+        const uint32_t words[] = { ByteOrder::swapIfBigEndian(static_cast<uint32_t>(value)), ByteOrder::swapIfBigEndian(2u) };
+        memcpy(slot.payload, words, sizeof(words));
+        memcpy(slot.payload + 8, "hi\0\0", 4);
+        slot.payloadSize = 12;
+
+        __atomic_store_n(&ring.writeCount, writeCount + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#if JUCE_LINUX
+        if(__atomic_load_n(&ring.consumerWaiting, __ATOMIC_ACQUIRE) != 0){
+            syscall(SYS_futex, &ring.writeCount, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+#endif
+        return true;
+    }
+};
+
+static SharedMemoryTransportTests sharedMemoryTransportTests;
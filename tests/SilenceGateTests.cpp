@@ -0,0 +1,75 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "SilenceGate.h"
+
+/**
+ * The silence gate of the corpus: The level threshold, the range in which the noise gate applies, and that the spectral
+ * flatness is only computed when the noise gate decides.
+ */
+class SilenceGateTests : public juce::UnitTest {
+public:
+    SilenceGateTests() : juce::UnitTest("SilenceGate", "DMLAP") {}
+
+    void runTest() override {
+        beginTest("Grains below the threshold are left out");
+        {
+            const float threshold = SilenceGate::defaultThresholdDb;
+            expect(!SilenceGate::passes(0.0f, threshold, 0.0f, flatnessOf(0.0f)));
+            expect(!SilenceGate::passes(gainAt(threshold - 1.0f), threshold, 0.0f, flatnessOf(0.0f)));
+            expect(SilenceGate::passes(gainAt(threshold + 1.0f), threshold, 0.0f, flatnessOf(0.0f)));
+            expect(SilenceGate::passes(1.0f, threshold, 0.0f, flatnessOf(0.0f)));
+            // Digital silence only passes a gate that keeps every grain
+            expect(SilenceGate::passes(0.0f, -100.0f, 0.0f, flatnessOf(0.0f)));
+        }
+
+        beginTest("The noise gate leaves out quiet grains with a flat spectrum");
+        {
+            const float threshold = -60.0f, noiseFlatness = 0.5f;
+            const float quiet = gainAt(threshold + SilenceGate::noiseGateRangeDb / 2.0f);
+            expect(!SilenceGate::passes(quiet, threshold, noiseFlatness, flatnessOf(0.9f)));
+            expect(!SilenceGate::passes(quiet, threshold, noiseFlatness, flatnessOf(noiseFlatness)));
+            expect(SilenceGate::passes(quiet, threshold, noiseFlatness, flatnessOf(0.1f)));
+            // Off
+            expect(SilenceGate::passes(quiet, threshold, 0.0f, flatnessOf(1.0f)));
+        }
+
+        beginTest("Grains above the noise gate range keep their noise");
+        {
+            const float threshold = -60.0f;
+            const float loud = gainAt(threshold + SilenceGate::noiseGateRangeDb + 1.0f);
+            expect(SilenceGate::passes(loud, threshold, 0.5f, flatnessOf(1.0f)));
+        }
+
+        beginTest("The flatness is only computed when the noise gate decides");
+        {
+            const float threshold = -60.0f;
+            int numComputed = 0;
+            auto countingFlatness = [&numComputed] {
+                numComputed++;
+                return 1.0f;
+            };
+            // Silent, noise gate off, and too loud for the noise gate
+            SilenceGate::passes(gainAt(threshold - 10.0f), threshold, 0.5f, countingFlatness);
+            SilenceGate::passes(gainAt(threshold + 10.0f), threshold, 0.0f, countingFlatness);
+            SilenceGate::passes(gainAt(threshold + 30.0f), threshold, 0.5f, countingFlatness);
+            expectEquals(numComputed, 0);
+            SilenceGate::passes(gainAt(threshold + 10.0f), threshold, 0.5f, countingFlatness);
+            expectEquals(numComputed, 1);
+        }
+    }
+
+private:
+    static float gainAt(float db) {
+        return juce::Decibels::decibelsToGain(db);
+    }
+
+    static std::function<float()> flatnessOf(float flatness) {
+        return [flatness] { return flatness; };
+    }
+};
+
+static SilenceGateTests silenceGateTests;
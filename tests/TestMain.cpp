@@ -0,0 +1,23 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <juce_core/juce_core.h>
+
+/**
+ * Runs the unit tests of the backend (every juce::UnitTest in the "DMLAP" category). The exit code is the number of
+ * tests with failures, so ctest reports them.
+ */
+int main() {
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("DMLAP");
+
+    int numFailedTests = 0;
+    for(int i = 0; i < runner.getNumResults(); i++){
+        if(runner.getResult(i)->failures > 0){
+            numFailedTests++;
+        }
+    }
+    return numFailedTests;
+}
@@ -0,0 +1,171 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <juce_core/juce_core.h>
+#include "TimbreIndex.h"
+#include "VectorKernels.h"
+
+/**
+ * The timbre search: The distance kernels (AVX2 or portable, whichever this machine uses) against plain double loops,
+ * and the inverted file index against a brute-force scan.
+ */
+class TimbreIndexTests : public juce::UnitTest {
+public:
+    TimbreIndexTests() : juce::UnitTest("TimbreIndex", "DMLAP") {}
+
+    void runTest() override {
+        juce::Random random = getRandom();
+
+        beginTest("The distance kernels agree with plain loops at any length");
+        {
+            for(int dimensions = 1; dimensions <= 41; dimensions++){
+                vector<float> a = randomVector(random, dimensions), b = randomVector(random, dimensions);
+                double l2 = 0.0, dot = 0.0, normA = 0.0, normB = 0.0;
+                for(int i = 0; i < dimensions; i++){
+                    l2 += (static_cast<double>(a[i]) - b[i]) * (static_cast<double>(a[i]) - b[i]);
+                    dot += static_cast<double>(a[i]) * b[i];
+                    normA += static_cast<double>(a[i]) * a[i];
+                    normB += static_cast<double>(b[i]) * b[i];
+                }
+                const double cosine = 1.0 - dot / std::sqrt(normA * normB);
+                expectWithinAbsoluteError(VectorKernels::squaredL2(a.data(), b.data(), dimensions), static_cast<float>(l2), tolerance);
+                expectWithinAbsoluteError(VectorKernels::dot(a.data(), b.data(), dimensions), static_cast<float>(dot), tolerance);
+                expectWithinAbsoluteError(VectorKernels::cosineDistance(a.data(), b.data(), dimensions), static_cast<float>(cosine), tolerance);
+            }
+            const vector<float> zeros (16, 0.0f), ones (16, 1.0f);
+            expectEquals(VectorKernels::cosineDistance(zeros.data(), ones.data(), 16), 1.0f);
+        }
+
+        beginTest("The row kernels honour the stride");
+        {
+            constexpr int dimensions = 13, stride = 16, numRows = 37;
+            const vector<float> query = randomVector(random, dimensions);
+            const vector<float> rows = randomVector(random, numRows * stride);
+            vector<float> distances (numRows), products (numRows);
+            VectorKernels::squaredL2Rows(query.data(), rows.data(), numRows, stride, dimensions, distances.data());
+            VectorKernels::dotRows(query.data(), rows.data(), numRows, stride, dimensions, products.data());
+            for(int row = 0; row < numRows; row++){
+                const float* values = rows.data() + row * stride;
+                expectWithinAbsoluteError(distances[static_cast<size_t>(row)], VectorKernels::squaredL2(query.data(), values, dimensions), tolerance);
+                expectWithinAbsoluteError(products[static_cast<size_t>(row)], VectorKernels::dot(query.data(), values, dimensions), tolerance);
+            }
+        }
+
+        constexpr int dimensions = 20, numGrains = 2000, k = 10;
+        vector<Grain> grains;
+        vector<float> timbre;
+        makeCorpus(random, dimensions, numGrains, grains, timbre);
+        TimbreIndex index;
+        index.build(grains, timbre, dimensions);
+        TimbreIndex::SearchScratch scratch;
+        vector<TimbreIndex::Neighbour> found;
+
+        beginTest("The index holds every grain with its vector");
+        {
+            expectEquals(index.size(), numGrains);
+            expectEquals(index.getDimensions(), dimensions);
+            expectGreaterThan(index.getNumLists(), 1);
+            for(int row = 0; row < index.size(); row++){
+                // Rows are grouped by cluster, the grain's idx is its position in the input
+                const float* original = timbre.data() + index.getGrain(row).getIdx() * dimensions;
+                expectEquals(VectorKernels::squaredL2(index.getRow(row), original, dimensions), 0.0f);
+            }
+        }
+
+        beginTest("Probing every cluster is an exact search");
+        {
+            for(auto metric : { TimbreIndex::Metric::l2, TimbreIndex::Metric::cosine }){
+                for(int q = 0; q < 20; q++){
+                    const vector<float> query = randomVector(random, dimensions);
+                    index.search(query.data(), k, metric, index.getNumLists(), scratch, found);
+                    const vector<TimbreIndex::Neighbour> expected = bruteForce(index, query.data(), k, metric);
+                    expectEquals(static_cast<int>(found.size()), k);
+                    for(int i = 0; i < k; i++){
+                        expectWithinAbsoluteError(found[static_cast<size_t>(i)].distance, expected[static_cast<size_t>(i)].distance, tolerance);
+                        expectWithinAbsoluteError(found[static_cast<size_t>(i)].distance,
+                                                  index.distance(query.data(), found[static_cast<size_t>(i)].row, metric), tolerance);
+                    }
+                }
+            }
+        }
+
+        beginTest("The default number of probes finds most true neighbours");
+        {
+            int numFound = 0;
+            constexpr int numQueries = 50;
+            for(int q = 0; q < numQueries; q++){
+                // Queries near the corpus, like the timbre of a target grain
+                const vector<float> query = nearbyVector(random, timbre, random.nextInt(numGrains), dimensions);
+                index.search(query.data(), k, TimbreIndex::Metric::l2, TimbreIndex::defaultNumProbes, scratch, found);
+                numFound += countCommon(found, bruteForce(index, query.data(), k, TimbreIndex::Metric::l2));
+            }
+            expectGreaterThan(static_cast<float>(numFound) / (numQueries * k), 0.8f);
+        }
+
+        beginTest("An empty index finds nothing");
+        {
+            TimbreIndex empty;
+            empty.build({}, {}, dimensions);
+            const vector<float> query = randomVector(random, dimensions);
+            empty.search(query.data(), k, TimbreIndex::Metric::l2, TimbreIndex::defaultNumProbes, scratch, found);
+            expect(empty.isEmpty());
+            expect(found.empty());
+        }
+    }
+
+private:
+    static constexpr float tolerance = 1.0e-3f;
+
+    static vector<float> randomVector(juce::Random& random, int size) {
+        vector<float> values (static_cast<size_t>(size));
+        for(float& value : values){
+            value = random.nextFloat() * 2.0f - 1.0f;
+        }
+        return values;
+    }
+
+    static vector<float> nearbyVector(juce::Random& random, const vector<float>& timbre, int grain, int dimensions) {
+        vector<float> values (timbre.begin() + grain * dimensions, timbre.begin() + (grain + 1) * dimensions);
+        for(float& value : values){
+            value += (random.nextFloat() - 0.5f) * 0.1f;
+        }
+        return values;
+    }
+
+    // Grains in a few dozen blobs, like timbres of related sounds. The idx of a grain is its position.
+    static void makeCorpus(juce::Random& random, int dimensions, int numGrains, vector<Grain>& grains, vector<float>& timbre) {
+        constexpr int numBlobs = 40;
+        vector<float> centres = randomVector(random, numBlobs * dimensions);
+        const float features[FeatureSchema::numFeatures] = {};
+        for(int grain = 0; grain < numGrains; grain++){
+            grains.emplace_back(0, grain, features);
+            const vector<float> values = nearbyVector(random, centres, random.nextInt(numBlobs), dimensions);
+            timbre.insert(timbre.end(), values.begin(), values.end());
+        }
+    }
+
+    static vector<TimbreIndex::Neighbour> bruteForce(const TimbreIndex& index, const float* query, int k, TimbreIndex::Metric metric) {
+        vector<TimbreIndex::Neighbour> all;
+        for(int row = 0; row < index.size(); row++){
+            all.push_back({ index.distance(query, row, metric), row });
+        }
+        sort(all.begin(), all.end(), [] (const TimbreIndex::Neighbour& a, const TimbreIndex::Neighbour& b) { return a.distance < b.distance; });
+        all.resize(static_cast<size_t>(k));
+        return all;
+    }
+
+    static int countCommon(const vector<TimbreIndex::Neighbour>& found, const vector<TimbreIndex::Neighbour>& expected) {
+        int count = 0;
+        for(const auto& neighbour : found){
+            for(const auto& other : expected){
+                count += neighbour.row == other.row ? 1 : 0;
+            }
+        }
+        return count;
+    }
+};
+
+static TimbreIndexTests timbreIndexTests;
@@ -0,0 +1,127 @@
+//
+// Created by Max on 19/10/2026.
+//
+
+#include <atomic>
+#include <thread>
+#include <juce_core/juce_core.h>
+#include "TrajectoryBuffer.h"
+
+/**
+ * The triple buffer between the trajectory writer and the audio thread: What the reader swaps in, what the writer gets
+ * back, and that a reader racing a writer only ever sees whole trajectories.
+ */
+class TrajectoryBufferTests : public UnitTest {
+public:
+    TrajectoryBufferTests() : UnitTest("TrajectoryBuffer", "DMLAP") {}
+
+    void runTest() override {
+        beginTest("A published trajectory is swapped in once, with its layout");
+        {
+            TrajectoryBuffer buffer (2, capacity);
+            expect(!buffer.hasLatest());
+            expect(!buffer.swapInLatest());
+
+            render(buffer, 1.0f, 4, 8);
+            buffer.publish();
+            expectEquals(buffer.getPublishedLayout().numGrains, 4);
+            expectEquals(buffer.getPublishedLayout().grainLength, 8);
+            expect(buffer.hasLatest());
+
+            expect(buffer.swapInLatest());
+            expectEquals(buffer.getFrontBuffer().getSample(1, capacity - 1), 1.0f);
+            expectEquals(buffer.getFrontLayout().numGrains, 4);
+            expectEquals(buffer.getFrontLayout().getNumSamples(), 32);
+            expect(!buffer.hasLatest());
+            expect(!buffer.swapInLatest());
+        }
+
+        beginTest("A trajectory the reader never picked up is replaced and handed back to the writer");
+        {
+            TrajectoryBuffer buffer (2, capacity);
+            render(buffer, 1.0f, 1, 8);
+            buffer.publish();
+            render(buffer, 2.0f, 2, 8);
+            buffer.publish();
+            // The first trajectory is the writer's again
+            expectEquals(buffer.getBackBuffer().getSample(0, 0), 1.0f);
+
+            expect(buffer.swapInLatest());
+            expectEquals(buffer.getFrontBuffer().getSample(0, 0), 2.0f);
+            expectEquals(buffer.getFrontLayout().numGrains, 2);
+        }
+
+        beginTest("Writer and reader never share a buffer");
+        {
+            TrajectoryBuffer buffer (2, capacity);
+            Random random = getRandom();
+            for(int i = 0; i < 1000; i++){
+                if(random.nextBool()){
+                    render(buffer, static_cast<float>(i), 1, 8);
+                    buffer.publish();
+                } else {
+                    buffer.swapInLatest();
+                }
+                expect(&buffer.getBackBuffer() != &buffer.getFrontBuffer());
+            }
+        }
+
+        beginTest("A reader racing the writer only sees whole trajectories, in order");
+        {
+            // Single producer, single consumer: Every trajectory is filled with its number, and its layout carries the
+            // number too (modulo the capacity), so a torn buffer or a layout of another buffer shows up as a mismatch
+            TrajectoryBuffer buffer (2, capacity);
+            constexpr int numTrajectories = 20000;
+            std::atomic<bool> isWriting { true };
+            std::thread writer ([&buffer, &isWriting] {
+                for(int i = 1; i <= numTrajectories; i++){
+                    render(buffer, static_cast<float>(i), i % capacity, 1);
+                    buffer.publish();
+                }
+                isWriting = false;
+            });
+
+            int numTorn = 0;
+            int numOutOfOrder = 0;
+            int numSwaps = 0;
+            float last = 0.0f;
+            while(isWriting || buffer.hasLatest()){
+                if(!buffer.swapInLatest()){
+                    continue;
+                }
+                numSwaps++;
+                const AudioBuffer<float>& front = buffer.getFrontBuffer();
+                const float value = front.getSample(0, 0);
+                for(int channel = 0; channel < front.getNumChannels(); channel++){
+                    for(int i = 0; i < capacity; i++){
+                        numTorn += front.getSample(channel, i) != value ? 1 : 0;
+                    }
+                }
+                numTorn += buffer.getFrontLayout().numGrains != static_cast<int>(value) % capacity ? 1 : 0;
+                numOutOfOrder += value <= last ? 1 : 0;
+                last = value;
+            }
+            writer.join();
+
+            expect(numSwaps > 0);
+            expectEquals(numTorn, 0);
+            expectEquals(numOutOfOrder, 0);
+            // The last trajectory is never lost
+            expectEquals(last, static_cast<float>(numTrajectories));
+        }
+    }
+
+private:
+    static constexpr int capacity = 256;
+
+    // Writer side: Fill the back buffer with one value and set its layout
+    static void render(TrajectoryBuffer& buffer, float value, int numGrains, int grainLength) {
+        AudioBuffer<float>& back = buffer.getBackBuffer();
+        for(int channel = 0; channel < back.getNumChannels(); channel++){
+            FloatVectorOperations::fill(back.getWritePointer(channel), value, back.getNumSamples());
+        }
+        buffer.setBackLayout(numGrains, grainLength);
+    }
+};
+
+static TrajectoryBufferTests trajectoryBufferTests;